@@ -33,6 +33,7 @@
 */
 
 #include <string>
+#include <mutex>
 
 
 #include "version.h"
@@ -421,6 +422,9 @@ int PrintString (int iprintlevel, const char *outline)
 	{
 		return 0;
 	}
+	// Startup tasks may run on worker threads, so keep their output from interleaving with the main thread's.
+	static std::recursive_mutex printLock;
+	std::lock_guard<std::recursive_mutex> guard(printLock);
 	if (printlevel != PRINT_LOG || Logfile != nullptr)
 	{
 		// Convert everything coming through here to UTF-8 so that all console text is in a consistent format
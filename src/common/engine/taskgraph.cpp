@@ -0,0 +1,243 @@
+/*
+** taskgraph.cpp
+** Dependency-aware task graph for running independent startup phases
+** concurrently.
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 GZDoom Maintainers and Contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+** The main thread keeps executing every task that is ready and flagged
+** TF_MainThread while the remaining ready tasks are handed to a worker pool.
+** Since a task may only depend on tasks that were added before it, running
+** the graph without workers executes everything in the original order.
+**
+*/
+
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include "taskgraph.h"
+#include "ctpl.h"
+#include "i_time.h"
+#include "printf.h"
+#include "engineerrors.h"
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+int FTaskGraph::AddTask(const char *name, std::function<void()> func, std::initializer_list<int> deps, int flags)
+{
+	int index = int(Tasks.size());
+	auto &task = Tasks.emplace_back();
+	task.Name = name;
+	task.Func = std::move(func);
+	task.Flags = flags;
+	for (int dep : deps)
+	{
+		if (dep < 0 || dep >= index)
+		{
+			I_FatalError("Task '%s' has an invalid dependency", name);
+		}
+		Tasks[dep].Dependents.Push(index);
+		task.NumDeps++;
+	}
+	return index;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+void FTaskGraph::Execute(FTask &task, int thread)
+{
+	task.Thread = thread;
+	task.StartTime = I_nsTime();
+	task.Func();
+	task.EndTime = I_nsTime();
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+void FTaskGraph::Run(int numworkers)
+{
+	std::mutex lock;
+	std::condition_variable finishedCondition;
+	std::exception_ptr error;
+	std::unique_ptr<ctpl::thread_pool> pool;
+	TArray<int> remaining(Tasks.size(), true);
+	TArray<int> readyMain, readyWorker;
+	unsigned finished = 0;
+	int inflight = 0;
+
+	if (numworkers > 0) pool.reset(new ctpl::thread_pool(numworkers));
+
+	auto makeReady = [&](int index)
+	{
+		if (pool == nullptr || (Tasks[index].Flags & TF_MainThread)) readyMain.Push(index);
+		else readyWorker.Push(index);
+	};
+
+	// Must be called with the lock held.
+	auto complete = [&](int index)
+	{
+		finished++;
+		for (int dependent : Tasks[index].Dependents)
+		{
+			if (--remaining[dependent] == 0) makeReady(dependent);
+		}
+	};
+
+	// Always pick the oldest ready task so that the execution order stays as close as possible to the order the tasks were added.
+	auto takeFirst = [](TArray<int> &list)
+	{
+		unsigned best = 0;
+		for (unsigned i = 1; i < list.Size(); i++)
+		{
+			if (list[i] < list[best]) best = i;
+		}
+		int index = list[best];
+		list.Delete(best);
+		return index;
+	};
+
+	for (unsigned i = 0; i < Tasks.size(); i++)
+	{
+		remaining[i] = Tasks[i].NumDeps;
+		if (remaining[i] == 0) makeReady(i);
+	}
+
+	RunStart = I_nsTime();
+
+	// Must be called with the lock held. Workers call this as well so that tasks which only depend
+	// on other worker tasks do not need to wait until the main thread is done with its current task.
+	std::function<void()> dispatch = [&]()
+	{
+		while (error == nullptr && readyWorker.Size() > 0)
+		{
+			int index = takeFirst(readyWorker);
+			inflight++;
+			pool->push([&, index](int id)
+			{
+				std::exception_ptr taskerror;
+				try
+				{
+					Execute(Tasks[index], id);
+				}
+				catch (...)
+				{
+					taskerror = std::current_exception();
+				}
+				std::unique_lock<std::mutex> workerguard(lock);
+				inflight--;
+				if (taskerror != nullptr)
+				{
+					if (error == nullptr) error = taskerror;
+				}
+				else
+				{
+					complete(index);
+					dispatch();
+				}
+				finishedCondition.notify_all();
+			});
+		}
+	};
+
+	std::unique_lock<std::mutex> guard(lock);
+	while (finished < Tasks.size())
+	{
+		if (error != nullptr)
+		{
+			// Don't start anything new, just let the running tasks finish.
+			if (inflight == 0) break;
+			finishedCondition.wait(guard);
+			continue;
+		}
+
+		dispatch();
+
+		if (readyMain.Size() > 0)
+		{
+			int index = takeFirst(readyMain);
+			guard.unlock();
+			try
+			{
+				Execute(Tasks[index], -1);
+			}
+			catch (...)
+			{
+				guard.lock();
+				error = std::current_exception();
+				continue;
+			}
+			guard.lock();
+			complete(index);
+			continue;
+		}
+
+		finishedCondition.wait(guard);
+	}
+	guard.unlock();
+
+	pool.reset();
+	RunEnd = I_nsTime();
+
+	if (error != nullptr) std::rethrow_exception(error);
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+void FTaskGraph::PrintTimings() const
+{
+	uint64_t sum = 0;
+	Printf("Startup phase timings:\n");
+	for (auto &task : Tasks)
+	{
+		uint64_t duration = task.EndTime - task.StartTime;
+		sum += duration;
+		FString where;
+		if (task.Thread < 0) where = "main";
+		else where.Format("worker %d", task.Thread);
+		Printf("  %-24s %9.2f ms  start %9.2f ms  (%s)\n", task.Name.GetChars(), duration / 1e6, (task.StartTime - RunStart) / 1e6, where.GetChars());
+	}
+	Printf("  %d phases: %.2f ms elapsed, %.2f ms of work\n", int(Tasks.size()), (RunEnd - RunStart) / 1e6, sum / 1e6);
+}
@@ -0,0 +1,81 @@
+/*
+** taskgraph.h
+** Dependency-aware task graph for running independent startup phases
+** concurrently.
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 GZDoom Maintainers and Contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+*/
+
+#pragma once
+
+#include <functional>
+#include <initializer_list>
+#include <vector>
+#include "tarray.h"
+#include "zstring.h"
+
+class FTaskGraph
+{
+public:
+	enum
+	{
+		TF_MainThread = 1,	// must run on the thread that calls Run(), e.g. because it updates the startup screen.
+	};
+
+	// Dependencies must refer to tasks that were added earlier, so the graph can never contain a cycle.
+	// Returns the handle to be used in other tasks' dependency lists.
+	int AddTask(const char *name, std::function<void()> func, std::initializer_list<int> deps = {}, int flags = 0);
+
+	// With numworkers == 0 all tasks run on the calling thread in the order they were added.
+	// Exceptions thrown by a task are rethrown here once all running tasks have finished.
+	void Run(int numworkers);
+
+	void PrintTimings() const;
+
+private:
+	struct FTask
+	{
+		FString Name;
+		std::function<void()> Func;
+		TArray<int> Dependents;
+		int NumDeps = 0;
+		int Flags = 0;
+		int Thread = -1;	// -1 is the main thread
+		uint64_t StartTime = 0;
+		uint64_t EndTime = 0;
+	};
+
+	void Execute(FTask &task, int thread);
+
+	// Not a TArray, which moves its elements with memcpy when it grows. That does not work for std::function.
+	std::vector<FTask> Tasks;
+	uint64_t RunStart = 0;
+	uint64_t RunEnd = 0;
+};
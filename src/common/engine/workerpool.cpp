@@ -0,0 +1,194 @@
+/*
+** workerpool.cpp
+** Engine-owned pool of worker threads
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 GZDoom Maintainers and Contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+**
+** The pool is shared by all subsystems that want to spread CPU work across
+** cores. The parallel_for wrapper only maps to real threads on platforms
+** with a native implementation, this works everywhere.
+**
+*/
+
+#include <atomic>
+#include <mutex>
+#include <exception>
+#include <condition_variable>
+#include <thread>
+#include <algorithm>
+#include "workerpool.h"
+#include "ctpl.h"
+
+FWorkerPool WorkerPool;
+
+static thread_local bool isPoolWorker;
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+FWorkerPool::~FWorkerPool()
+{
+	// The destructor of the pool waits for all queued jobs.
+	Pool.reset();
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+void FWorkerPool::Start()
+{
+	static std::once_flag started;
+	std::call_once(started, [this]()
+	{
+		int count = std::max<int>(std::thread::hardware_concurrency(), 2) - 1;
+		Pool.reset(new ctpl::thread_pool(count));
+	});
+}
+
+void FWorkerPool::Shutdown()
+{
+	if (Pool) Pool->stop(false);
+}
+
+int FWorkerPool::NumThreads()
+{
+	Start();
+	return Pool->size();
+}
+
+bool FWorkerPool::IsWorkerThread()
+{
+	return isPoolWorker;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+void FWorkerPool::Run(std::function<void()> func)
+{
+	Start();
+	Pool->push([func = std::move(func)](int)
+	{
+		isPoolWorker = true;
+		func();
+	});
+}
+
+//==========================================================================
+//
+// Shared between the caller and the helper jobs. Helpers that only get to
+// run after the caller has finished must not touch the caller's function
+// anymore, so they only hold a reference to this state and check whether
+// the loop has been closed.
+//
+//==========================================================================
+
+struct FParallelForState
+{
+	std::atomic<int> Next = { 0 };
+	int Count = 0;
+	const std::function<void(int)> *Func = nullptr;
+
+	std::mutex Lock;
+	std::condition_variable Finished;
+	int Running = 0;
+	bool Closed = false;
+	std::exception_ptr Error;
+
+	// Items are handed out one by one so that a few expensive items cannot leave the other threads idle.
+	void Work()
+	{
+		int i;
+		while ((i = Next.fetch_add(1)) < Count)
+		{
+			try
+			{
+				(*Func)(i);
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> guard(Lock);
+				if (!Error) Error = std::current_exception();
+				Next = Count;
+			}
+		}
+	}
+};
+
+void FWorkerPool::ParallelFor(int count, const std::function<void(int)> &func)
+{
+	if (count <= 0) return;
+	if (count == 1 || isPoolWorker)
+	{
+		for (int i = 0; i < count; i++) func(i);
+		return;
+	}
+
+	Start();
+
+	auto state = std::make_shared<FParallelForState>();
+	state->Count = count;
+	state->Func = &func;
+
+	int helpers = std::min(Pool->size(), count - 1);
+	for (int i = 0; i < helpers; i++)
+	{
+		Pool->push([state](int)
+		{
+			isPoolWorker = true;
+			{
+				std::lock_guard<std::mutex> guard(state->Lock);
+				if (state->Closed) return;
+				state->Running++;
+			}
+			state->Work();
+			std::lock_guard<std::mutex> guard(state->Lock);
+			if (--state->Running == 0) state->Finished.notify_all();
+		});
+	}
+
+	state->Work();
+
+	// Don't wait for helpers which are still stuck behind other jobs in the queue, only for those that are running.
+	std::unique_lock<std::mutex> guard(state->Lock);
+	state->Closed = true;
+	state->Finished.wait(guard, [&]() { return state->Running == 0; });
+
+	if (state->Error) std::rethrow_exception(state->Error);
+}
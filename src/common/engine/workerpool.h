@@ -0,0 +1,70 @@
+/*
+** workerpool.h
+** Engine-owned pool of worker threads
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 GZDoom Maintainers and Contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+*/
+
+#pragma once
+
+#include <functional>
+#include <memory>
+
+namespace ctpl { class thread_pool; }
+
+class FWorkerPool
+{
+public:
+	~FWorkerPool();
+
+	// Number of worker threads, not counting the calling thread. The pool gets started on first use.
+	int NumThreads();
+
+	// Calls func(i) for every i in [0, count). The calling thread takes part in the work, so this also makes
+	// progress when all workers are busy. Returns once all calls have finished and rethrows the first
+	// exception thrown by any of them. Nested calls from a worker thread run serially.
+	void ParallelFor(int count, const std::function<void(int)> &func);
+
+	// Queues a job for a worker thread and returns immediately.
+	void Run(std::function<void()> func);
+
+	// Discards the queued jobs and waits for the running ones. Must be called at engine shutdown, before the
+	// static objects that jobs may still use are destroyed. Jobs queued afterward never run.
+	void Shutdown();
+
+	static bool IsWorkerThread();
+
+private:
+	void Start();
+
+	std::unique_ptr<ctpl::thread_pool> Pool;
+};
+
+extern FWorkerPool WorkerPool;
@@ -107,6 +107,7 @@ struct FResourceEntry
 	int16_t Namespace;
 };
 
+extern thread_local bool mainThread;
 void SetMainThread();
 
 class FResourceFile
@@ -35,6 +35,8 @@
 
 #include <time.h>
 #include <stdexcept>
+#include <mutex>
+#include <string.h>
 #include <cstdint>
 #include "w_zip.h"
 #include "ancientzip.h"
@@ -363,8 +365,28 @@ void FZipFile::SetEntryAddress(uint32_t entry)
 	FZipLocalFileHeader localHeader;
 	int skiplen;
 
-	Reader.Seek(Entries[entry].Position, FileReader::SeekSet);
-	Reader.Read(&localHeader, sizeof(localHeader));
+	// Images may get decoded on worker threads during precaching, so this must neither race with itself
+	// nor move the shared reader's file position under the main thread's feet.
+	static std::mutex addressLock;
+	std::lock_guard<std::mutex> guard(addressLock);
+	if (!(Entries[entry].Flags & RESFF_NEEDFILESTART)) return;
+
+	auto buf = Reader.GetBuffer();
+	if (buf != nullptr)
+	{
+		memcpy(&localHeader, buf + Entries[entry].Position, sizeof(localHeader));
+	}
+	else if (!mainThread)
+	{
+		FileReader fr;
+		fr.OpenFile(FileName, Entries[entry].Position, sizeof(localHeader));
+		fr.Read(&localHeader, sizeof(localHeader));
+	}
+	else
+	{
+		Reader.Seek(Entries[entry].Position, FileReader::SeekSet);
+		Reader.Read(&localHeader, sizeof(localHeader));
+	}
 	skiplen = LittleShort(localHeader.NameLength) + LittleShort(localHeader.ExtraLength);
 	Entries[entry].Position += sizeof(localHeader) + skiplen;
 	Entries[entry].Flags &= ~RESFF_NEEDFILESTART;
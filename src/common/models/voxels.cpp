@@ -285,6 +285,7 @@ FVoxel *R_LoadKVX(int lumpnum)
 			delete voxel;
 			return NULL;
 		}
+		voxel->Mips[i].FindColumnRanges();
 	}
 
 	voxel->LumpNum = lumpnum;
@@ -356,6 +357,27 @@ FVoxelMipLevel::~FVoxelMipLevel()
 	}
 }
 
+//==========================================================================
+//
+// FVoxelMipLevel :: FindColumnRanges
+//
+//==========================================================================
+
+void FVoxelMipLevel::FindColumnRanges()
+{
+	ColumnsY1.Resize(SizeX);
+	ColumnsY2.Resize(SizeX);
+	for (int x = 0; x < SizeX; x++)
+	{
+		const short *xyoffs = &OffsetXY[x * (SizeY + 1)];
+		int y1 = 0, y2 = SizeY;
+		while (y1 < y2 && xyoffs[y1] >= xyoffs[y1 + 1]) y1++;
+		while (y2 > y1 && xyoffs[y2 - 1] >= xyoffs[y2]) y2--;
+		ColumnsY1[x] = y1;
+		ColumnsY2[x] = y2;
+	}
+}
+
 //==========================================================================
 //
 // FVoxelMipLevel :: GetSlabData
@@ -38,6 +38,11 @@ struct FVoxelMipLevel
 	DVector3	Pivot;
 	int			*OffsetX;
 	short		*OffsetXY;
+	// For each x, the first and one past the last y whose column holds any slabs, so that
+	// the software renderer does not have to visit the empty parts of the bounding box.
+	TArray<uint16_t> ColumnsY1, ColumnsY2;
+
+	void FindColumnRanges();
 private:
 	uint8_t	*SlabData;
 	TArray<uint8_t> SlabDataRemapped;
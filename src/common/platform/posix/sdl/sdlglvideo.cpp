@@ -53,6 +53,7 @@
 #ifdef HAVE_GLES2
 #include "gles_framebuffer.h"
 #endif
+#include "null_renderer.h"
 
 #ifdef HAVE_VULKAN
 #include "vulkan/system/vk_renderdevice.h"
@@ -381,6 +382,12 @@ void SDLVideo::DumpAdapters()
 
 DFrameBuffer *SDLVideo::CreateFrameBuffer ()
 {
+	// The null backend needs neither a window nor a graphics context.
+	if (V_GetBackend() == 4)
+	{
+		return new NullRenderer::NullFrameBuffer(vid_defwidth, vid_defheight);
+	}
+
 	SystemBaseFrameBuffer *fb = nullptr;
 
 	// first try Vulkan, if that fails OpenGL
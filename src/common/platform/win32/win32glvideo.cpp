@@ -56,6 +56,7 @@
 #ifdef HAVE_GLES2
 #include "gles_framebuffer.h"
 #endif
+#include "null_renderer.h"
 
 extern "C" {
 HGLRC zd_wglCreateContext(HDC Arg1);
@@ -66,6 +67,8 @@ PROC zd_wglGetProcAddress(LPCSTR name);
 
 EXTERN_CVAR(Int, vid_adapter)
 EXTERN_CVAR(Bool, vid_hdr)
+EXTERN_CVAR(Int, vid_defwidth)
+EXTERN_CVAR(Int, vid_defheight)
 
 CUSTOM_CVAR(Bool, gl_debug, false, CVAR_ARCHIVE | CVAR_GLOBALCONFIG | CVAR_NOINITCALL)
 {
@@ -106,6 +109,12 @@ Win32GLVideo::Win32GLVideo()
 
 DFrameBuffer *Win32GLVideo::CreateFrameBuffer()
 {
+	// The null backend needs neither a window nor a graphics context.
+	if (V_GetBackend() == 4)
+	{
+		return new NullRenderer::NullFrameBuffer(vid_defwidth, vid_defheight);
+	}
+
 	SystemGLFrameBuffer *fb;
 
 #ifdef HAVE_GLES2
@@ -107,6 +107,8 @@ unsigned int FHardwareTexture::CreateTexture(unsigned char * buffer, int w, int
 	rh = GetTexDimension(h);
 	if (glBufferID > 0)
 	{
+		// MapBuffer does not leave the buffer bound, other uploads may have happened in between.
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, glBufferID);
 		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
 		buffer = nullptr;
 	}
@@ -198,7 +200,11 @@ void FHardwareTexture::AllocateBuffer(int w, int h, int texelsize)
 uint8_t *FHardwareTexture::MapBuffer()
 {
 	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, glBufferID);
-	return (uint8_t*)glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+	auto map = (uint8_t*)glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+	// The buffer stays mapped until CreateTexture, which can be a frame later with r_pipelineframes.
+	// Leaving it bound would turn every other texture upload in between into an invalid PBO upload.
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	return map;
 }
 
 //===========================================================================
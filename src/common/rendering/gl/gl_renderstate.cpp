@@ -334,6 +334,7 @@ void FGLRenderState::ApplyMaterial(FMaterial *mat, int clampmode, int translatio
 	lastMaterial = mat;
 	lastClamp = clampmode;
 	lastTranslation = translation;
+	render_materialswitches++;
 
 	int maxbound = 0;
 
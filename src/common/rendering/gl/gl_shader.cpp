@@ -47,6 +47,7 @@
 #include "gl_debug.h"
 #include "matrix.h"
 #include "gl_renderer.h"
+#include "hw_clock.h"
 #include <map>
 #include <memory>
 
@@ -237,6 +238,13 @@ bool FShader::Load(const char * name, const char * vert_prog_lump, const char *
 			int uShadowmapFilter;
 			
 			int uLightBlendMode;
+
+			int uLightGridIndex;	// clustered light grid
+			int uLightGridWidth;
+			int uLightGridHeight;
+			int uLightGridSlices;
+			float uLightGridNear;
+			float uLightGridScale;
 		};
 
 		uniform int uTextureMode;
@@ -747,6 +755,7 @@ void FShaderManager::SetActiveShader(FShader *sh)
 	{
 		glUseProgram(sh!= NULL? sh->GetHandle() : 0);
 		mActiveShader = sh;
+		render_shaderswitches++;
 	}
 }
 
@@ -44,6 +44,7 @@
 
 #include "matrix.h"
 #include "gles_renderer.h"
+#include "hw_clock.h"
 #include <map>
 #include <memory>
 
@@ -776,6 +777,7 @@ void FShaderManager::SetActiveShader(FShader::ShaderVariantData *sh)
 	{
 		glUseProgram(sh!= NULL? sh->GetHandle() : 0);
 		mActiveShader = sh;
+		render_shaderswitches++;
 	}
 }
 
@@ -21,36 +21,384 @@
 //
 
 #include <algorithm>
+#include <functional>
+#include <float.h>
 #include "hw_aabbtree.h"
+#include "workerpool.h"
 
 namespace hwrenderer
 {
 
-TArray<int> LevelAABBTree::FindNodePath(unsigned int line, unsigned int node)
+// RayTest and the shadowmap shader walk the tree with a stack of 32 nodes.
+static const int MaxTreeDepth = 30;
+
+// Number of buckets per axis the line centers get sorted into when searching for a split.
+static const int SAHBins = 16;
+
+// Subtrees with fewer lines than this are built by a single thread.
+static const int ParallelMinLines = 4096;
+
+static inline float HalfPerimeter(const FVector2 &aabb_min, const FVector2 &aabb_max)
 {
-	const AABBTreeNode &n = nodes[node];
+	return (aabb_max.X - aabb_min.X) + (aabb_max.Y - aabb_min.Y);
+}
+
+//==========================================================================
+//
+// Finds the bounding box of the lines and sorts them into two groups.
+// Returns the number of lines in the left group.
+//
+// The split comes from the surface area heuristic, evaluated at the
+// borders of the buckets the line centers get sorted into. Once the
+// depth limit gets close the lines get split in half instead so that
+// the tree cannot become too deep for RayTest's stack.
+//
+//==========================================================================
+
+static int SplitLines(AABBTreeBuildLine *lines, int num_lines, int depth, FVector2 &aabb_min, FVector2 &aabb_max)
+{
+	aabb_min = lines[0].aabb_min;
+	aabb_max = lines[0].aabb_max;
+	FVector2 center_min = lines[0].center, center_max = lines[0].center;
+	for (int i = 1; i < num_lines; i++)
+	{
+		const auto &line = lines[i];
+		aabb_min.X = std::min(aabb_min.X, line.aabb_min.X);
+		aabb_min.Y = std::min(aabb_min.Y, line.aabb_min.Y);
+		aabb_max.X = std::max(aabb_max.X, line.aabb_max.X);
+		aabb_max.Y = std::max(aabb_max.Y, line.aabb_max.Y);
+		center_min.X = std::min(center_min.X, line.center.X);
+		center_min.Y = std::min(center_min.Y, line.center.Y);
+		center_max.X = std::max(center_max.X, line.center.X);
+		center_max.Y = std::max(center_max.Y, line.center.Y);
+	}
+
+	int balanced_depth = 0;
+	while ((1 << balanced_depth) < num_lines) balanced_depth++;
+
+	if (depth + balanced_depth < MaxTreeDepth)
+	{
+		float best_cost = FLT_MAX;
+		int best_axis = -1, best_split = 0;
+		float best_scale = 0.0f;
+
+		for (int axis = 0; axis < 2; axis++)
+		{
+			float extent = center_max[axis] - center_min[axis];
+			if (extent <= 0.0f)
+				continue;
+
+			int counts[SAHBins] = {};
+			FVector2 bin_min[SAHBins], bin_max[SAHBins];
+			float scale = SAHBins * 0.9999f / extent;
+			for (int i = 0; i < num_lines; i++)
+			{
+				const auto &line = lines[i];
+				int bin = std::min(int((line.center[axis] - center_min[axis]) * scale), SAHBins - 1);
+				if (counts[bin]++ == 0)
+				{
+					bin_min[bin] = line.aabb_min;
+					bin_max[bin] = line.aabb_max;
+				}
+				else
+				{
+					bin_min[bin].X = std::min(bin_min[bin].X, line.aabb_min.X);
+					bin_min[bin].Y = std::min(bin_min[bin].Y, line.aabb_min.Y);
+					bin_max[bin].X = std::max(bin_max[bin].X, line.aabb_max.X);
+					bin_max[bin].Y = std::max(bin_max[bin].Y, line.aabb_max.Y);
+				}
+			}
+
+			// Cost of everything right of each split, then sweep from the left.
+			float right_cost[SAHBins];
+			int right_count = 0;
+			FVector2 right_min(FLT_MAX, FLT_MAX), right_max(-FLT_MAX, -FLT_MAX);
+			for (int bin = SAHBins - 1; bin > 0; bin--)
+			{
+				if (counts[bin] > 0)
+				{
+					right_count += counts[bin];
+					right_min.X = std::min(right_min.X, bin_min[bin].X);
+					right_min.Y = std::min(right_min.Y, bin_min[bin].Y);
+					right_max.X = std::max(right_max.X, bin_max[bin].X);
+					right_max.Y = std::max(right_max.Y, bin_max[bin].Y);
+				}
+				right_cost[bin] = right_count > 0 ? right_count * HalfPerimeter(right_min, right_max) : -1.0f;
+			}
+
+			int left_count = 0;
+			FVector2 left_min(FLT_MAX, FLT_MAX), left_max(-FLT_MAX, -FLT_MAX);
+			for (int bin = 0; bin < SAHBins - 1; bin++)
+			{
+				if (counts[bin] > 0)
+				{
+					left_count += counts[bin];
+					left_min.X = std::min(left_min.X, bin_min[bin].X);
+					left_min.Y = std::min(left_min.Y, bin_min[bin].Y);
+					left_max.X = std::max(left_max.X, bin_max[bin].X);
+					left_max.Y = std::max(left_max.Y, bin_max[bin].Y);
+				}
+				if (left_count == 0 || right_cost[bin + 1] < 0.0f)
+					continue;
+
+				float cost = left_count * HalfPerimeter(left_min, left_max) + right_cost[bin + 1];
+				if (cost < best_cost)
+				{
+					best_cost = cost;
+					best_axis = axis;
+					best_split = bin;
+					best_scale = scale;
+				}
+			}
+		}
+
+		if (best_axis != -1)
+		{
+			float start = center_min[best_axis];
+			auto middle = std::partition(lines, lines + num_lines, [=](const AABBTreeBuildLine &line)
+			{
+				return std::min(int((line.center[best_axis] - start) * best_scale), SAHBins - 1) <= best_split;
+			});
+			return int(middle - lines);
+		}
+	}
 
-	if (n.aabb_left > treelines[line].x || n.aabb_right < treelines[line].x ||
-		n.aabb_top > treelines[line].y || n.aabb_bottom < treelines[line].y)
+	// All centers are in the same place or the tree is getting too deep.
+	int axis = (center_max.X - center_min.X) >= (center_max.Y - center_min.Y) ? 0 : 1;
+	int half = num_lines / 2;
+	std::nth_element(lines, lines + half, lines + num_lines, [=](const AABBTreeBuildLine &a, const AABBTreeBuildLine &b)
 	{
-		return {};
+		return a.center[axis] < b.center[axis];
+	});
+	return half;
+}
+
+//==========================================================================
+//
+// Nodes are stored children first so the root of a subtree is always its
+// last node.
+//
+//==========================================================================
+
+static int GenerateSAHNode(TArray<AABBTreeNode> &nodes, AABBTreeBuildLine *lines, int num_lines, int depth)
+{
+	if (num_lines == 1) // Leaf node
+	{
+		nodes.Push(AABBTreeNode(lines[0].aabb_min, lines[0].aabb_max, lines[0].line_index));
+		return (int)nodes.Size() - 1;
 	}
 
-	TArray<int> path;
-	if (n.line_index == -1)
+	FVector2 aabb_min, aabb_max;
+	int left_count = SplitLines(lines, num_lines, depth, aabb_min, aabb_max);
+	int left_index = GenerateSAHNode(nodes, lines, left_count, depth + 1);
+	int right_index = GenerateSAHNode(nodes, lines + left_count, num_lines - left_count, depth + 1);
+	nodes.Push(AABBTreeNode(aabb_min, aabb_max, left_index, right_index));
+	return (int)nodes.Size() - 1;
+}
+
+//==========================================================================
+//
+// For a parallel build the upper levels get split on the calling thread
+// until the remaining subtrees are small enough. Those get built by the
+// worker pool and are then stitched together in the same order a serial
+// build would have produced, so the result does not depend on timing.
+//
+//==========================================================================
+
+struct SAHSubtree
+{
+	AABBTreeBuildLine *lines;
+	int num_lines;
+	int depth;
+	int root;
+	TArray<AABBTreeNode> nodes;
+};
+
+struct SAHTopNode
+{
+	FVector2 aabb_min, aabb_max;
+	int left, right;
+	int subtree;
+};
+
+static int SplitTopNodes(TArray<SAHTopNode> &top, TArray<SAHSubtree> &subtrees, AABBTreeBuildLine *lines, int num_lines, int depth)
+{
+	SAHTopNode node = {};
+	if (num_lines < ParallelMinLines)
+	{
+		node.subtree = subtrees.Reserve(1);
+		subtrees[node.subtree].lines = lines;
+		subtrees[node.subtree].num_lines = num_lines;
+		subtrees[node.subtree].depth = depth;
+	}
+	else
 	{
-		path = FindNodePath(line, n.left_node);
-		if (path.Size() == 0)
-			path = FindNodePath(line, n.right_node);
+		int left_count = SplitLines(lines, num_lines, depth, node.aabb_min, node.aabb_max);
+		node.left = SplitTopNodes(top, subtrees, lines, left_count, depth + 1);
+		node.right = SplitTopNodes(top, subtrees, lines + left_count, num_lines - left_count, depth + 1);
+		node.subtree = -1;
+	}
+	return top.Push(node);
+}
 
-		if (path.Size())
-			path.Push(node);
+int LevelAABBTree::GenerateSAHTree(AABBTreeBuildLine *lines, int num_lines, bool parallel)
+{
+	if (!parallel || num_lines < ParallelMinLines * 2)
+	{
+		return GenerateSAHNode(nodes, lines, num_lines, 0);
 	}
-	else if (n.line_index == (int)line)
+
+	TArray<SAHTopNode> top;
+	TArray<SAHSubtree> subtrees;
+	int toproot = SplitTopNodes(top, subtrees, lines, num_lines, 0);
+
+	WorkerPool.ParallelFor(subtrees.Size(), [&](int i)
+	{
+		auto &subtree = subtrees[i];
+		subtree.root = GenerateSAHNode(subtree.nodes, subtree.lines, subtree.num_lines, subtree.depth);
+	});
+
+	std::function<int(int)> emit = [&](int index) -> int
+	{
+		const auto &node = top[index];
+		if (node.subtree >= 0)
+		{
+			auto &subtree = subtrees[node.subtree];
+			int offset = nodes.Size();
+			for (auto n : subtree.nodes)
+			{
+				if (n.line_index == -1)
+				{
+					n.left_node += offset;
+					n.right_node += offset;
+				}
+				nodes.Push(n);
+			}
+			subtree.nodes.Reset();
+			return offset + subtree.root;
+		}
+		int left_index = emit(node.left);
+		int right_index = emit(node.right);
+		nodes.Push(AABBTreeNode(node.aabb_min, node.aabb_max, left_index, right_index));
+		return (int)nodes.Size() - 1;
+	};
+	return emit(toproot);
+}
+
+//==========================================================================
+//
+// Moving lines only need the boxes above them to be adjusted. The walk
+// up stops at the first node whose box stays the same.
+//
+//==========================================================================
+
+void LevelAABBTree::InitRefit()
+{
+	parentNodes.Resize(nodes.Size());
+	lineNodes.Resize(treelines.Size());
+	for (unsigned int i = 0; i < nodes.Size(); i++)
+	{
+		parentNodes[i] = -1;
+	}
+	for (unsigned int i = 0; i < nodes.Size(); i++)
+	{
+		const auto &node = nodes[i];
+		if (node.line_index != -1)
+		{
+			lineNodes[node.line_index] = i;
+		}
+		else
+		{
+			parentNodes[node.left_node] = i;
+			parentNodes[node.right_node] = i;
+		}
+	}
+}
+
+void LevelAABBTree::BeginRefit()
+{
+	dirtyStartNode = nodes.Size();
+	dirtyStartLine = treelines.Size();
+	dirtyEndLine = 0;
+}
+
+void LevelAABBTree::RefitLine(int line, const AABBTreeLine &treeline)
+{
+	treelines[line] = treeline;
+	dirtyStartLine = std::min(dirtyStartLine, line);
+	dirtyEndLine = std::max(dirtyEndLine, line + 1);
+
+	int nodeIndex = lineNodes[line];
+	auto &leaf = nodes[nodeIndex];
+	leaf.aabb_left = std::min(treeline.x, treeline.x + treeline.dx);
+	leaf.aabb_right = std::max(treeline.x, treeline.x + treeline.dx);
+	leaf.aabb_top = std::min(treeline.y, treeline.y + treeline.dy);
+	leaf.aabb_bottom = std::max(treeline.y, treeline.y + treeline.dy);
+	dirtyStartNode = std::min(dirtyStartNode, nodeIndex);
+
+	for (int parent = parentNodes[nodeIndex]; parent != -1; parent = parentNodes[parent])
+	{
+		auto &cur = nodes[parent];
+		const auto &left = nodes[cur.left_node];
+		const auto &right = nodes[cur.right_node];
+		float aabb_left = std::min(left.aabb_left, right.aabb_left);
+		float aabb_top = std::min(left.aabb_top, right.aabb_top);
+		float aabb_right = std::max(left.aabb_right, right.aabb_right);
+		float aabb_bottom = std::max(left.aabb_bottom, right.aabb_bottom);
+		if (aabb_left == cur.aabb_left && aabb_top == cur.aabb_top && aabb_right == cur.aabb_right && aabb_bottom == cur.aabb_bottom)
+			break;
+
+		cur.aabb_left = aabb_left;
+		cur.aabb_top = aabb_top;
+		cur.aabb_right = aabb_right;
+		cur.aabb_bottom = aabb_bottom;
+	}
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+int LevelAABBTree::GetDepth() const
+{
+	if (nodes.Size() == 0)
+		return 0;
+
+	// Children always come before their parents.
+	TArray<int> depths;
+	depths.Resize(nodes.Size());
+	int maxdepth = 0;
+	for (int i = nodes.Size() - 1; i >= 0; i--)
+	{
+		if (i == (int)nodes.Size() - 1) depths[i] = 1;
+		maxdepth = std::max(maxdepth, depths[i]);
+		if (nodes[i].line_index == -1)
+		{
+			depths[nodes[i].left_node] = depths[i] + 1;
+			depths[nodes[i].right_node] = depths[i] + 1;
+		}
+	}
+	return maxdepth;
+}
+
+double LevelAABBTree::GetSAHCost() const
+{
+	if (nodes.Size() == 0)
+		return 0;
+
+	const auto &root = nodes.Last();
+	double rootarea = (root.aabb_right - root.aabb_left) + (root.aabb_bottom - root.aabb_top);
+	if (rootarea <= 0.0)
+		return 0;
+
+	double cost = 0;
+	for (const auto &node : nodes)
 	{
-		path.Push(node);
+		cost += ((node.aabb_right - node.aabb_left) + (node.aabb_bottom - node.aabb_top)) / rootarea;
 	}
-	return path;
+	return cost;
 }
 
 double LevelAABBTree::RayTest(const DVector3 &ray_start, const DVector3 &ray_end)
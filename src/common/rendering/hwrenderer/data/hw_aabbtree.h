@@ -35,6 +35,16 @@ struct AABBTreeLine
 	float dx, dy;
 };
 
+// Bounds of a line segment while building an AABB tree
+struct AABBTreeBuildLine
+{
+	FVector2 aabb_min, aabb_max;
+	FVector2 center;
+
+	// Index of the leaf node's AABBTreeLine
+	int line_index;
+};
+
 class LevelAABBTree
 {
 protected:
@@ -47,6 +57,15 @@ protected:
 	int dynamicStartNode = 0;
 	int dynamicStartLine = 0;
 
+	// Parent of each node (-1 for the root) and leaf node of each line, for refitting moved lines.
+	TArray<int> parentNodes;
+	TArray<int> lineNodes;
+
+	// Nodes and lines changed by the last Update call.
+	int dirtyStartNode = 0;
+	int dirtyStartLine = 0;
+	int dirtyEndLine = 0;
+
 public:
 	// Shoot a ray from ray_start to ray_end and return the closest hit as a fractional value between 0 and 1. Returns 1 if no line was hit.
 	double RayTest(const DVector3 &ray_start, const DVector3 &ray_end);
@@ -64,13 +83,38 @@ public:
 	size_t DynamicNodesOffset() const { return dynamicStartNode * sizeof(AABBTreeNode); }
 	size_t DynamicLinesOffset() const { return dynamicStartLine * sizeof(AABBTreeLine); }
 
+	const void *DirtyNodes() const { return nodes.Data() + dirtyStartNode; }
+	const void *DirtyLines() const { return treelines.Data() + dirtyStartLine; }
+	size_t DirtyNodesSize() const { return (nodes.Size() - dirtyStartNode) * sizeof(AABBTreeNode); }
+	size_t DirtyLinesSize() const { return (dirtyEndLine - dirtyStartLine) * sizeof(AABBTreeLine); }
+	size_t DirtyNodesOffset() const { return dirtyStartNode * sizeof(AABBTreeNode); }
+	size_t DirtyLinesOffset() const { return dirtyStartLine * sizeof(AABBTreeLine); }
+
+	// Number of nodes on the longest path from the root to a leaf
+	int GetDepth() const;
+
+	// Expected cost of a ray test relative to testing the root node only
+	double GetSAHCost() const;
+
 	virtual bool Update() = 0;
 
 	virtual ~LevelAABBTree() = default;
 
 protected:
 
-	TArray<int> FindNodePath(unsigned int line, unsigned int node);
+	// Builds a subtree with a binned surface area heuristic and appends its nodes. Returns the index of its root node.
+	// The lines get reordered.
+	int GenerateSAHTree(AABBTreeBuildLine *lines, int num_lines, bool parallel);
+
+	// Sets up the parent and line lookups once all nodes and lines are in place.
+	void InitRefit();
+
+	// Updates the refit bookkeeping for a new Update call.
+	void BeginRefit();
+
+	// Replaces a line and grows or shrinks the boxes of the nodes above it.
+	void RefitLine(int line, const AABBTreeLine &treeline);
+
 	// Test if a ray overlaps an AABB node or not
 	bool OverlapRayAABB(const DVector2 &ray_start2d, const DVector2 &ray_end2d, const AABBTreeNode &node);
 
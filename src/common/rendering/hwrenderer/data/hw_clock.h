@@ -17,6 +17,7 @@ extern glcycle_t MTWait, WTTotal;
 extern int iter_dlightf, iter_dlight, draw_dlight, draw_dlightf;
 extern int rendered_lines,rendered_flats,rendered_sprites,rendered_decals,render_vertexsplit,render_texsplit;
 extern int rendered_portals;
+extern int render_materialswitches, render_shaderswitches;
 
 extern int vertexcount, flatvertices, flatprimitives;
 
@@ -132,6 +132,29 @@ int FLightBuffer::UploadLights(FDynLightData &data)
 	}
 }
 
+// The light grid is one block that gets addressed relative to its start, so it needs the whole buffer to be visible to the shader.
+int FLightBuffer::UploadLightGrid(const TArray<float> &data)
+{
+	int totalsize = data.Size() / 4;
+
+	if (!mBufferType || totalsize == 0) return -1;
+
+	float *mBufferPointer = (float*)mBuffer->Memory();
+	assert(mBufferPointer != nullptr);
+	if (mBufferPointer == nullptr) return -1;
+
+	unsigned thisindex = mIndex.fetch_add(totalsize);
+	if (thisindex + totalsize <= mBufferSize)
+	{
+		memcpy(mBufferPointer + thisindex*4, data.Data(), totalsize * ELEMENT_SIZE);
+		return thisindex;
+	}
+	else
+	{
+		return -1;	// Buffer is full.
+	}
+}
+
 int FLightBuffer::GetBinding(unsigned int index, size_t* pOffset, size_t* pSize)
 {
 	// this function will only get called if a uniform buffer is used. For a shader storage buffer we only need to bind the buffer once at the start.
@@ -32,6 +32,7 @@ public:
 	~FLightBuffer();
 	void Clear();
 	int UploadLights(FDynLightData &data);
+	int UploadLightGrid(const TArray<float> &data);
 	void Map() { mBuffer->Map(); }
 	void Unmap() { mBuffer->Unmap(); }
 	unsigned int GetBlockSize() const { return mBlockSize; }
@@ -0,0 +1,263 @@
+/*
+** hw_meshbvh.cpp
+** Triangle BVH over the level mesh for CPU ray queries
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 GZDoom Maintainers and Contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+*/
+
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+#ifndef NO_SSE
+#include <immintrin.h>
+#endif
+#include "hw_levelmesh.h"
+#include "hw_meshbvh.h"
+
+namespace hwrenderer
+{
+
+// Leaves hold a single block of triangles.
+static const int LeafTriangles = 4;
+
+// Enough for a tree built by median splits over 2^60 triangles.
+static const int TraceStackSize = 64;
+
+LevelMeshBVH::LevelMeshBVH(const LevelMesh &mesh)
+{
+	TArray<BuildTriangle> tris;
+	tris.Resize(mesh.MeshElements.Size() / 3);
+	for (unsigned int i = 0; i < tris.Size(); i++)
+	{
+		BuildTriangle &tri = tris[i];
+		for (int j = 0; j < 3; j++)
+			tri.v[j] = mesh.MeshVertices[mesh.MeshElements[i * 3 + j]];
+
+		tri.aabb_min.X = std::min({ tri.v[0].X, tri.v[1].X, tri.v[2].X });
+		tri.aabb_min.Y = std::min({ tri.v[0].Y, tri.v[1].Y, tri.v[2].Y });
+		tri.aabb_min.Z = std::min({ tri.v[0].Z, tri.v[1].Z, tri.v[2].Z });
+		tri.aabb_max.X = std::max({ tri.v[0].X, tri.v[1].X, tri.v[2].X });
+		tri.aabb_max.Y = std::max({ tri.v[0].Y, tri.v[1].Y, tri.v[2].Y });
+		tri.aabb_max.Z = std::max({ tri.v[0].Z, tri.v[1].Z, tri.v[2].Z });
+		tri.center = (tri.aabb_min + tri.aabb_max) * 0.5f;
+	}
+	numTriangles = tris.Size();
+
+	if (numTriangles > 0)
+	{
+		nodes.Reserve(1);
+		Subdivide(0, tris.Data(), tris.Size());
+	}
+}
+
+void LevelMeshBVH::Subdivide(int node, BuildTriangle *tris, int count)
+{
+	FVector3 aabb_min = tris[0].aabb_min, aabb_max = tris[0].aabb_max;
+	FVector3 center_min = tris[0].center, center_max = tris[0].center;
+	for (int i = 1; i < count; i++)
+	{
+		aabb_min.X = std::min(aabb_min.X, tris[i].aabb_min.X);
+		aabb_min.Y = std::min(aabb_min.Y, tris[i].aabb_min.Y);
+		aabb_min.Z = std::min(aabb_min.Z, tris[i].aabb_min.Z);
+		aabb_max.X = std::max(aabb_max.X, tris[i].aabb_max.X);
+		aabb_max.Y = std::max(aabb_max.Y, tris[i].aabb_max.Y);
+		aabb_max.Z = std::max(aabb_max.Z, tris[i].aabb_max.Z);
+		center_min.X = std::min(center_min.X, tris[i].center.X);
+		center_min.Y = std::min(center_min.Y, tris[i].center.Y);
+		center_min.Z = std::min(center_min.Z, tris[i].center.Z);
+		center_max.X = std::max(center_max.X, tris[i].center.X);
+		center_max.Y = std::max(center_max.Y, tris[i].center.Y);
+		center_max.Z = std::max(center_max.Z, tris[i].center.Z);
+	}
+	nodes[node].aabb_min = aabb_min;
+	nodes[node].aabb_max = aabb_max;
+
+	if (count <= LeafTriangles)
+	{
+		CreateLeaf(node, tris, count);
+		return;
+	}
+
+	// Split at the median of the axis the triangle centers spread the most along
+	FVector3 extent = center_max - center_min;
+	int axis = (extent.X >= extent.Y && extent.X >= extent.Z) ? 0 : (extent.Y >= extent.Z) ? 1 : 2;
+	int mid = count / 2;
+	std::nth_element(tris, tris + mid, tris + count, [=](const BuildTriangle &a, const BuildTriangle &b) { return a.center[axis] < b.center[axis]; });
+
+	int child = nodes.Reserve(2);
+	nodes[node].first = child;
+	nodes[node].count = 0;
+	Subdivide(child, tris, mid);
+	Subdivide(child + 1, tris + mid, count - mid);
+}
+
+void LevelMeshBVH::CreateLeaf(int node, const BuildTriangle *tris, int count)
+{
+	MeshBVHTriangleBlock block;
+	for (int i = 0; i < 4; i++)
+	{
+		FVector3 v0, e1, e2;
+		if (i < count)
+		{
+			v0 = tris[i].v[0];
+			e1 = tris[i].v[1] - tris[i].v[0];
+			e2 = tris[i].v[2] - tris[i].v[0];
+		}
+		else
+		{
+			v0 = tris[0].v[0];
+			e1 = e2 = FVector3(0.0f, 0.0f, 0.0f);
+		}
+		block.v0x[i] = v0.X; block.v0y[i] = v0.Y; block.v0z[i] = v0.Z;
+		block.e1x[i] = e1.X; block.e1y[i] = e1.Y; block.e1z[i] = e1.Z;
+		block.e2x[i] = e2.X; block.e2y[i] = e2.Y; block.e2z[i] = e2.Z;
+	}
+	nodes[node].first = blocks.Push(block);
+	nodes[node].count = 1;
+}
+
+bool LevelMeshBVH::IsOccluded(const FVector3 &from, const FVector3 &to) const
+{
+	if (nodes.Size() == 0)
+		return false;
+
+	FVector3 dir = to - from;
+	FVector3 invdir;
+	for (int i = 0; i < 3; i++)
+		invdir[i] = (fabs(dir[i]) > 1e-9f) ? 1.0f / dir[i] : (dir[i] < 0.0f ? -1e9f : 1e9f);
+
+	int stack[TraceStackSize];
+	int stackPos = 0;
+	stack[stackPos++] = 0;
+	while (stackPos > 0)
+	{
+		const MeshBVHNode &node = nodes[stack[--stackPos]];
+		if (!OverlapRayAABB(from, invdir, node))
+			continue;
+
+		if (node.count > 0)
+		{
+			for (int i = 0; i < node.count; i++)
+			{
+				if (BlockHit(blocks[node.first + i], from, dir))
+					return true;
+			}
+		}
+		else
+		{
+			stack[stackPos++] = node.first;
+			stack[stackPos++] = node.first + 1;
+		}
+	}
+	return false;
+}
+
+bool LevelMeshBVH::OverlapRayAABB(const FVector3 &origin, const FVector3 &invdir, const MeshBVHNode &node)
+{
+	float tmin = 0.0f, tmax = 1.0f;
+	for (int i = 0; i < 3; i++)
+	{
+		float t1 = (node.aabb_min[i] - origin[i]) * invdir[i];
+		float t2 = (node.aabb_max[i] - origin[i]) * invdir[i];
+		tmin = std::max(tmin, std::min(t1, t2));
+		tmax = std::min(tmax, std::max(t1, t2));
+	}
+	return tmin <= tmax;
+}
+
+// Moller-Trumbore against the four triangles of a block. Only hits strictly between the segment end points count.
+bool LevelMeshBVH::BlockHit(const MeshBVHTriangleBlock &block, const FVector3 &origin, const FVector3 &dir)
+{
+#ifndef NO_SSE
+	__m128 dirx = _mm_set1_ps(dir.X), diry = _mm_set1_ps(dir.Y), dirz = _mm_set1_ps(dir.Z);
+	__m128 e1x = _mm_loadu_ps(block.e1x), e1y = _mm_loadu_ps(block.e1y), e1z = _mm_loadu_ps(block.e1z);
+	__m128 e2x = _mm_loadu_ps(block.e2x), e2y = _mm_loadu_ps(block.e2y), e2z = _mm_loadu_ps(block.e2z);
+
+	// pvec = dir x e2
+	__m128 px = _mm_sub_ps(_mm_mul_ps(diry, e2z), _mm_mul_ps(dirz, e2y));
+	__m128 py = _mm_sub_ps(_mm_mul_ps(dirz, e2x), _mm_mul_ps(dirx, e2z));
+	__m128 pz = _mm_sub_ps(_mm_mul_ps(dirx, e2y), _mm_mul_ps(diry, e2x));
+	__m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+	__m128 absdet = _mm_andnot_ps(_mm_set1_ps(-0.0f), det);
+	__m128 mask = _mm_cmpgt_ps(absdet, _mm_set1_ps(1e-8f));
+	if (_mm_movemask_ps(mask) == 0)
+		return false;
+	__m128 invdet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+
+	// tvec = origin - v0
+	__m128 tx = _mm_sub_ps(_mm_set1_ps(origin.X), _mm_loadu_ps(block.v0x));
+	__m128 ty = _mm_sub_ps(_mm_set1_ps(origin.Y), _mm_loadu_ps(block.v0y));
+	__m128 tz = _mm_sub_ps(_mm_set1_ps(origin.Z), _mm_loadu_ps(block.v0z));
+	__m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, px), _mm_mul_ps(ty, py)), _mm_mul_ps(tz, pz)), invdet);
+
+	// qvec = tvec x e1
+	__m128 qx = _mm_sub_ps(_mm_mul_ps(ty, e1z), _mm_mul_ps(tz, e1y));
+	__m128 qy = _mm_sub_ps(_mm_mul_ps(tz, e1x), _mm_mul_ps(tx, e1z));
+	__m128 qz = _mm_sub_ps(_mm_mul_ps(tx, e1y), _mm_mul_ps(ty, e1x));
+	__m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dirx, qx), _mm_mul_ps(diry, qy)), _mm_mul_ps(dirz, qz)), invdet);
+	__m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), invdet);
+
+	__m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+	mask = _mm_and_ps(mask, _mm_cmpge_ps(u, zero));
+	mask = _mm_and_ps(mask, _mm_cmpge_ps(v, zero));
+	mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_add_ps(u, v), one));
+	mask = _mm_and_ps(mask, _mm_cmpgt_ps(t, zero));
+	mask = _mm_and_ps(mask, _mm_cmplt_ps(t, one));
+	return _mm_movemask_ps(mask) != 0;
+#else
+	for (int i = 0; i < 4; i++)
+	{
+		FVector3 e1(block.e1x[i], block.e1y[i], block.e1z[i]);
+		FVector3 e2(block.e2x[i], block.e2y[i], block.e2z[i]);
+		FVector3 pvec = dir ^ e2;
+		float det = e1 | pvec;
+		if (fabs(det) <= 1e-8f)
+			continue;
+		float invdet = 1.0f / det;
+
+		FVector3 tvec = origin - FVector3(block.v0x[i], block.v0y[i], block.v0z[i]);
+		float u = (tvec | pvec) * invdet;
+		if (u < 0.0f || u > 1.0f)
+			continue;
+
+		FVector3 qvec = tvec ^ e1;
+		float v = (dir | qvec) * invdet;
+		if (v < 0.0f || u + v > 1.0f)
+			continue;
+
+		float t = (e2 | qvec) * invdet;
+		if (t > 0.0f && t < 1.0f)
+			return true;
+	}
+	return false;
+#endif
+}
+
+} // namespace
@@ -0,0 +1,98 @@
+/*
+** hw_meshbvh.h
+** Triangle BVH over the level mesh for CPU ray queries
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 GZDoom Maintainers and Contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+*/
+#pragma once
+
+#include "tarray.h"
+#include "vectors.h"
+
+namespace hwrenderer
+{
+
+class LevelMesh;
+
+// Node in a mesh BVH
+struct MeshBVHNode
+{
+	FVector3 aabb_min;
+
+	// Index of the first child for inner nodes (the second one follows it), or first triangle block for leaves
+	int first;
+
+	FVector3 aabb_max;
+
+	// Number of triangle blocks in a leaf, 0 for inner nodes
+	int count;
+};
+
+// Four triangles stored side by side, so that a ray can be tested against all of them at once.
+// Unused lanes hold degenerate triangles which never report a hit.
+struct MeshBVHTriangleBlock
+{
+	float v0x[4], v0y[4], v0z[4];
+	float e1x[4], e1y[4], e1z[4];
+	float e2x[4], e2y[4], e2z[4];
+};
+
+class LevelMeshBVH
+{
+public:
+	LevelMeshBVH(const LevelMesh &mesh);
+
+	// Returns true if any triangle blocks the line segment between the two points
+	bool IsOccluded(const FVector3 &from, const FVector3 &to) const;
+
+	unsigned NodesCount() const { return nodes.Size(); }
+	unsigned TrianglesCount() const { return numTriangles; }
+
+private:
+	// Triangle and its bounds while building the tree
+	struct BuildTriangle
+	{
+		FVector3 v[3];
+		FVector3 aabb_min, aabb_max;
+		FVector3 center;
+	};
+
+	void Subdivide(int node, BuildTriangle *tris, int count);
+	void CreateLeaf(int node, const BuildTriangle *tris, int count);
+	static bool OverlapRayAABB(const FVector3 &origin, const FVector3 &invdir, const MeshBVHNode &node);
+	static bool BlockHit(const MeshBVHTriangleBlock &block, const FVector3 &origin, const FVector3 &dir);
+
+	// Nodes in the tree. The first node is the root node.
+	TArray<MeshBVHNode> nodes;
+	TArray<MeshBVHTriangleBlock> blocks;
+	unsigned int numTriangles = 0;
+};
+
+} // namespace
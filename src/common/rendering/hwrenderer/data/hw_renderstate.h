@@ -6,6 +6,7 @@
 #include "texmanip.h"
 #include "version.h"
 #include "i_interface.h"
+#include "asyncupscale.h"
 
 struct FColormap;
 class IVertexBuffer;
@@ -632,6 +633,11 @@ public:
 		}
 		auto mat = FMaterial::ValidateTexture(tex, scaleflags);
 		assert(mat);
+		// Show the unscaled texture until the upscaled one is ready.
+		if ((scaleflags & CTF_Upscale) && !AsyncUpscaler.Ready(mat, translation))
+		{
+			mat = FMaterial::ValidateTexture(tex, scaleflags & ~CTF_Upscale);
+		}
 		SetMaterial(mat, clampmode, translation, overrideshader);
 	}
 
@@ -137,8 +137,8 @@ void IShadowMap::UploadAABBTree()
 	}
 	else if (mAABBTree->Update())
 	{
-		mNodesBuffer->SetSubData(mAABBTree->DynamicNodesOffset(), mAABBTree->DynamicNodesSize(), mAABBTree->DynamicNodes());
-		mLinesBuffer->SetSubData(mAABBTree->DynamicLinesOffset(), mAABBTree->DynamicLinesSize(), mAABBTree->DynamicLines());
+		mNodesBuffer->SetSubData(mAABBTree->DirtyNodesOffset(), mAABBTree->DirtyNodesSize(), mAABBTree->DirtyNodes());
+		mLinesBuffer->SetSubData(mAABBTree->DirtyLinesOffset(), mAABBTree->DirtyLinesSize(), mAABBTree->DirtyLines());
 	}
 }
 
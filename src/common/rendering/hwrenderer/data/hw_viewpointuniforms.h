@@ -30,6 +30,13 @@ struct HWViewpointUniforms
 
 	int mLightBlendMode = 0;
 
+	int mLightGridIndex = -1;	// light buffer index of the clustered light grid, -1 if there is none.
+	int mLightGridWidth = 0;
+	int mLightGridHeight = 0;
+	int mLightGridSlices = 0;
+	float mLightGridNear = 0.f;
+	float mLightGridScale = 0.f;
+
 	void CalcDependencies()
 	{
 		mNormalViewMatrix.computeNormalMatrix(mViewMatrix);
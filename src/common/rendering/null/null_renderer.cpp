@@ -0,0 +1,279 @@
+/*
+** null_renderer.cpp
+** Rendering backend that records draw calls and uploads without a GPU
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 GZDoom Maintainers and Contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+*/
+
+#include "null_renderer.h"
+#include "v_draw.h"
+#include "textures.h"
+#include "hw_clock.h"
+#include "hw_cvars.h"
+#include "hw_skydome.h"
+#include "hw_viewpointbuffer.h"
+#include "hw_lightbuffer.h"
+#include "hw_bonebuffer.h"
+#include "flatvertices.h"
+#include "stats.h"
+
+namespace NullRenderer
+{
+
+FNullRenderStats NullStats;
+static FNullRenderStats LastFrameStats, TotalStats;
+
+void FNullRenderStats::Add(const FNullRenderStats &other)
+{
+	Frames += other.Frames;
+	DrawCalls += other.DrawCalls;
+	IndexedDrawCalls += other.IndexedDrawCalls;
+	Vertices += other.Vertices;
+	Indices += other.Indices;
+	MaterialChanges += other.MaterialChanges;
+	BufferUploads += other.BufferUploads;
+	BufferBytes += other.BufferBytes;
+	TextureUploads += other.TextureUploads;
+	TextureBytes += other.TextureBytes;
+}
+
+//==========================================================================
+//
+// Buffers only keep a copy in system memory so that everything that
+// writes to mapped buffer memory behaves the same as with a real backend.
+//
+//==========================================================================
+
+void NullBuffer::SetData(size_t size, const void *data, BufferUsageType usage)
+{
+	if (size != buffersize || mData == nullptr)
+	{
+		mData.reset(new uint8_t[size > 0 ? size : 1]);
+		buffersize = size;
+		map = mData.get();
+	}
+	if (data != nullptr)
+	{
+		memcpy(mData.get(), data, size);
+		NullStats.BufferUploads++;
+		NullStats.BufferBytes += size;
+	}
+}
+
+void NullBuffer::SetSubData(size_t offset, size_t size, const void *data)
+{
+	memcpy(mData.get() + offset, data, size);
+	NullStats.BufferUploads++;
+	NullStats.BufferBytes += size;
+}
+
+void NullBuffer::Resize(size_t newsize)
+{
+	std::unique_ptr<uint8_t[]> newdata(new uint8_t[newsize > 0 ? newsize : 1]);
+	if (mData != nullptr) memcpy(newdata.get(), mData.get(), min(buffersize, newsize));
+	mData = std::move(newdata);
+	buffersize = newsize;
+	map = mData.get();
+}
+
+void *NullBuffer::Lock(unsigned int size)
+{
+	SetData(size, nullptr, BufferUsageType::Stream);
+	return map;
+}
+
+void NullBuffer::Unlock()
+{
+	NullStats.BufferUploads++;
+	NullStats.BufferBytes += buffersize;
+}
+
+void NullBuffer::Upload(size_t start, size_t size)
+{
+	NullStats.BufferUploads++;
+	NullStats.BufferBytes += size;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+void NullHardwareTexture::AllocateBuffer(int w, int h, int texelsize)
+{
+	if (texelsize < 1 || texelsize > 4) texelsize = 4;
+	mTexelSize = texelsize;
+	bufferpitch = w;
+	mBuffer.Resize(w * h * texelsize);
+}
+
+unsigned int NullHardwareTexture::CreateTexture(unsigned char *buffer, int w, int h, int texunit, bool mipmap, const char *name)
+{
+	NullStats.TextureUploads++;
+	NullStats.TextureBytes += uint64_t(w) * h * mTexelSize;
+	return 1;
+}
+
+//==========================================================================
+//
+// Only material changes are tracked here because they are what a real
+// backend has to do the most work for.
+//
+//==========================================================================
+
+void NullRenderState::Apply()
+{
+	if (mMaterial.mChanged)
+	{
+		if (mMaterial.mMaterial != mLastMaterial || mMaterial.mTranslation != mLastTranslation)
+		{
+			mLastMaterial = mMaterial.mMaterial;
+			mLastTranslation = mMaterial.mTranslation;
+			NullStats.MaterialChanges++;
+			render_materialswitches++;
+		}
+		mMaterial.mChanged = false;
+	}
+	mBias.mChanged = false;
+}
+
+void NullRenderState::Draw(int dt, int index, int count, bool apply)
+{
+	if (apply) Apply();
+	NullStats.DrawCalls++;
+	NullStats.Vertices += count;
+}
+
+void NullRenderState::DrawIndexed(int dt, int index, int count, bool apply)
+{
+	if (apply) Apply();
+	NullStats.DrawCalls++;
+	NullStats.IndexedDrawCalls++;
+	NullStats.Indices += count;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+NullFrameBuffer::NullFrameBuffer(int width, int height)
+	: DFrameBuffer(width, height), mClientWidth(width), mClientHeight(height)
+{
+	mRenderState.Reset();
+}
+
+NullFrameBuffer::~NullFrameBuffer()
+{
+	if (mVertexData != nullptr) delete mVertexData;
+	if (mSkyData != nullptr) delete mSkyData;
+	if (mViewpoints != nullptr) delete mViewpoints;
+	if (mLights != nullptr) delete mLights;
+	if (mBones != nullptr) delete mBones;
+	mShadowMap.Reset();
+}
+
+void NullFrameBuffer::InitializeState()
+{
+	// Pretend to be a modern desktop GPU so that the renderer takes the same paths it takes with OpenGL and Vulkan.
+	hwcaps = RFL_SHADER_STORAGE_BUFFER | RFL_BUFFER_STORAGE;
+	glslversion = 4.50f;
+	vendorstring = "Null";
+
+	SetViewportRects(nullptr);
+
+	mVertexData = new FFlatVertexBuffer(GetWidth(), GetHeight(), mPipelineNbr);
+	mSkyData = new FSkyVertexBuffer;
+	mViewpoints = new HWViewpointBuffer(mPipelineNbr);
+	mLights = new FLightBuffer(mPipelineNbr);
+	mBones = new BoneBuffer(mPipelineNbr);
+}
+
+void NullFrameBuffer::Update()
+{
+	twoD.Reset();
+	Flush3D.Reset();
+
+	Flush3D.Clock();
+	Draw2D();
+	Flush3D.Unclock();
+
+	FPSLimit();
+	mVertexData->NextPipelineBuffer();
+	mRenderState.SetVertexBuffer(mVertexData);
+	mRenderState.ClearLastMaterial();
+
+	NullStats.Frames++;
+	LastFrameStats = NullStats;
+	TotalStats.Add(NullStats);
+	NullStats = {};
+
+	Super::Update();
+}
+
+void NullFrameBuffer::RenderTextureView(FCanvasTexture *tex, std::function<void(IntRect &)> renderFunc)
+{
+	IntRect bounds;
+	bounds.left = bounds.top = 0;
+	bounds.width = tex->GetWidth();
+	bounds.height = tex->GetHeight();
+	renderFunc(bounds);
+	tex->SetUpdated(true);
+}
+
+void NullFrameBuffer::Draw2D()
+{
+	::Draw2D(twod, mRenderState);
+}
+
+}
+
+using namespace NullRenderer;
+
+ADD_STAT(nullrender)
+{
+	FString out;
+	auto &f = LastFrameStats;
+	out.Format("Draws: %llu (%llu indexed), %llu vertices, %llu indices, %llu material changes\n"
+		"Uploads: %llu buffers (%llu KB), %llu textures (%llu KB)\n",
+		(unsigned long long)f.DrawCalls, (unsigned long long)f.IndexedDrawCalls, (unsigned long long)f.Vertices, (unsigned long long)f.Indices,
+		(unsigned long long)f.MaterialChanges, (unsigned long long)f.BufferUploads, (unsigned long long)(f.BufferBytes >> 10),
+		(unsigned long long)f.TextureUploads, (unsigned long long)(f.TextureBytes >> 10));
+	if (TotalStats.Frames > 0)
+	{
+		double frames = double(TotalStats.Frames);
+		out.AppendFormat("Average of %llu frames: %.1f draws, %.1f material changes, %.1f KB uploaded",
+			(unsigned long long)TotalStats.Frames, TotalStats.DrawCalls / frames, TotalStats.MaterialChanges / frames,
+			(TotalStats.BufferBytes + TotalStats.TextureBytes) / frames / 1024.);
+	}
+	return out;
+}
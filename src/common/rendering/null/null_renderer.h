@@ -0,0 +1,177 @@
+/*
+** null_renderer.h
+** Rendering backend that records draw calls and uploads without a GPU
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 GZDoom Maintainers and Contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+** Everything the hardware renderer hands to the backend is accepted and
+** counted, but no GPU work is ever issued. This allows measuring the CPU
+** side of the hardware renderer on machines without any graphics device.
+**
+*/
+
+#pragma once
+
+#include <memory>
+#include "v_video.h"
+#include "buffers.h"
+#include "hw_ihwtexture.h"
+#include "hw_renderstate.h"
+
+#ifdef _MSC_VER
+// silence bogus warning C4250: 'NullVertexBuffer': inherits 'NullBuffer::NullBuffer::SetData' via dominance
+#pragma warning(disable:4250) 
+#endif
+
+namespace NullRenderer
+{
+
+struct FNullRenderStats
+{
+	uint64_t Frames = 0;
+	uint64_t DrawCalls = 0;
+	uint64_t IndexedDrawCalls = 0;
+	uint64_t Vertices = 0;
+	uint64_t Indices = 0;
+	uint64_t MaterialChanges = 0;
+	uint64_t BufferUploads = 0;
+	uint64_t BufferBytes = 0;
+	uint64_t TextureUploads = 0;
+	uint64_t TextureBytes = 0;
+
+	void Add(const FNullRenderStats &other);
+};
+
+// Counters for the frame in progress. They get moved to the totals by NullFrameBuffer::Update.
+extern FNullRenderStats NullStats;
+
+class NullBuffer : virtual public IBuffer
+{
+protected:
+	std::unique_ptr<uint8_t[]> mData;
+
+	void SetData(size_t size, const void *data, BufferUsageType usage) override;
+	void SetSubData(size_t offset, size_t size, const void *data) override;
+	void Resize(size_t newsize) override;
+	void *Lock(unsigned int size) override;
+	void Unlock() override;
+	void Upload(size_t start, size_t size) override;
+};
+
+class NullVertexBuffer : public IVertexBuffer, public NullBuffer
+{
+public:
+	void SetFormat(int numBindingPoints, int numAttributes, size_t stride, const FVertexBufferAttribute *attrs) override {}
+};
+
+class NullIndexBuffer : public IIndexBuffer, public NullBuffer
+{
+};
+
+class NullDataBuffer : public IDataBuffer, public NullBuffer
+{
+public:
+	void BindRange(FRenderState *state, size_t start, size_t length) override {}
+};
+
+class NullHardwareTexture : public IHardwareTexture
+{
+	TArray<uint8_t> mBuffer;
+	int mTexelSize;
+
+public:
+	NullHardwareTexture(int numchannels) : mTexelSize(numchannels) {}
+
+	void AllocateBuffer(int w, int h, int texelsize) override;
+	uint8_t *MapBuffer() override { return mBuffer.Data(); }
+	unsigned int CreateTexture(unsigned char *buffer, int w, int h, int texunit, bool mipmap, const char *name) override;
+};
+
+class NullRenderState final : public FRenderState
+{
+	FMaterial *mLastMaterial = nullptr;
+	int mLastTranslation = 0;
+
+	void Apply();
+
+public:
+	void ClearLastMaterial() { mLastMaterial = nullptr; }
+
+	void ClearScreen() override { Apply(); NullStats.DrawCalls++; }
+	void Draw(int dt, int index, int count, bool apply = true) override;
+	void DrawIndexed(int dt, int index, int count, bool apply = true) override;
+
+	bool SetDepthClamp(bool on) override { return true; }
+	void SetDepthMask(bool on) override {}
+	void SetDepthFunc(int func) override {}
+	void SetDepthRange(float min, float max) override {}
+	void SetColorMask(bool r, bool g, bool b, bool a) override {}
+	void SetStencil(int offs, int op, int flags = -1) override {}
+	void SetCulling(int mode) override {}
+	void EnableClipDistance(int num, bool state) override {}
+	void Clear(int targets) override {}
+	void EnableStencil(bool on) override {}
+	void SetScissor(int x, int y, int w, int h) override {}
+	void SetViewport(int x, int y, int w, int h) override {}
+	void EnableDepthTest(bool on) override {}
+	void EnableMultisampling(bool on) override {}
+	void EnableLineSmooth(bool on) override {}
+	void EnableDrawBuffers(int count, bool apply = false) override {}
+};
+
+class NullFrameBuffer : public DFrameBuffer
+{
+	typedef DFrameBuffer Super;
+
+	NullRenderState mRenderState;
+	int mClientWidth, mClientHeight;
+
+public:
+	NullFrameBuffer(int width, int height);
+	~NullFrameBuffer();
+
+	void InitializeState() override;
+	void Update() override;
+	bool IsFullscreen() override { return false; }
+	int GetClientWidth() override { return mClientWidth; }
+	int GetClientHeight() override { return mClientHeight; }
+	int Backend() override { return 4; }	// same as the vid_preferbackend value that selects it
+	const char *DeviceName() const override { return "Null device"; }
+
+	FRenderState *RenderState() override { return &mRenderState; }
+	IHardwareTexture *CreateHardwareTexture(int numchannels) override { return new NullHardwareTexture(numchannels); }
+	IVertexBuffer *CreateVertexBuffer() override { return new NullVertexBuffer; }
+	IIndexBuffer *CreateIndexBuffer() override { return new NullIndexBuffer; }
+	IDataBuffer *CreateDataBuffer(int bindingpoint, bool ssbo, bool needsresize) override { return new NullDataBuffer; }
+
+	void RenderTextureView(FCanvasTexture *tex, std::function<void(IntRect &)> renderFunc) override;
+	void Draw2D() override;
+};
+
+}
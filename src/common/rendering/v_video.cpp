@@ -114,6 +114,9 @@ CUSTOM_CVAR(Int, vid_preferbackend, 1, CVAR_ARCHIVE | CVAR_GLOBALCONFIG | CVAR_N
 		Printf("Selecting Vulkan backend...\n");
 		break;
 #endif
+	case 4:
+		Printf("Selecting null backend, nothing will be displayed...\n");
+		break;
 	default:
 		Printf("Selecting OpenGL backend...\n");
 	}
@@ -125,7 +128,7 @@ int V_GetBackend()
 {
 	int v = vid_preferbackend;
 	if (v == 3) vid_preferbackend = v = 2;
-	else if (v < 0 || v > 3) v = 0;
+	else if (v < 0 || v > 4) v = 0;
 	return v;
 }
 
@@ -265,6 +265,8 @@ void VkRenderState::ApplyRenderPass(int dt)
 
 	if (changingPipeline)
 	{
+		if (pipelineKey.SpecialEffect != mPipelineKey.SpecialEffect || pipelineKey.EffectState != mPipelineKey.EffectState || pipelineKey.AlphaTest != mPipelineKey.AlphaTest)
+			render_shaderswitches++;
 		mCommandBuffer->bindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, mPassSetup->GetPipeline(pipelineKey));
 		mPipelineKey = pipelineKey;
 	}
@@ -442,6 +444,7 @@ void VkRenderState::ApplyMaterial()
 		mCommandBuffer->bindDescriptorSet(VK_PIPELINE_BIND_POINT_GRAPHICS, fb->GetRenderPassManager()->GetPipelineLayout(mPipelineKey.NumTextureLayers), 0, fb->GetDescriptorSetManager()->GetFixedDescriptorSet());
 		mCommandBuffer->bindDescriptorSet(VK_PIPELINE_BIND_POINT_GRAPHICS, passManager->GetPipelineLayout(mPipelineKey.NumTextureLayers), 2, descriptorset);
 		mMaterial.mChanged = false;
+		render_materialswitches++;
 	}
 }
 
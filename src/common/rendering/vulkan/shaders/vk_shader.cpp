@@ -178,6 +178,13 @@ static const char *shaderBindings = R"(
 		int uShadowmapFilter;
 		
 		int uLightBlendMode;
+
+		int uLightGridIndex;	// clustered light grid
+		int uLightGridWidth;
+		int uLightGridHeight;
+		int uLightGridSlices;
+		float uLightGridNear;
+		float uLightGridScale;
 	};
 
 	layout(set = 1, binding = 1, std140) uniform MatricesUBO {
@@ -165,6 +165,7 @@ public:
 	FDDSTexture (FileReader &lump, int lumpnum, void *surfdesc);
 
 	PalettedPixels CreatePalettedPixels(int conversion, int frame = 0) override;
+	bool SupportsThreadedDecoding() override { return true; }
 
 protected:
 	uint32_t Format;
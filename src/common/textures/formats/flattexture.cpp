@@ -49,6 +49,7 @@ class FFlatTexture : public FImageSource
 public:
 	FFlatTexture (int lumpnum);
 	PalettedPixels CreatePalettedPixels(int conversion, int frame = 0) override;
+	bool SupportsThreadedDecoding() override { return true; }
 };
 
 
@@ -67,6 +67,7 @@ class FIMGZTexture : public FImageSource
 public:
 	FIMGZTexture (int lumpnum, uint16_t w, uint16_t h, int16_t l, int16_t t, bool isalpha);
 	PalettedPixels CreatePalettedPixels(int conversion, int frame = 0) override;
+	bool SupportsThreadedDecoding() override { return true; }
 	int CopyPixels(FBitmap *bmp, int conversion, int frame = 0) override;
 };
 
@@ -74,6 +74,7 @@ class FPatchTexture : public FImageSource
 public:
 	FPatchTexture (int lumpnum, int w, int h, int lo, int to, bool isalphatex);
 	PalettedPixels CreatePalettedPixels(int conversion, int frame = 0) override;
+	bool SupportsThreadedDecoding() override { return true; }
 	int CopyPixels(FBitmap *bmp, int conversion, int frame = 0) override;
 	bool SupportRemap0() override { return !badflag; }
 	void DetectBadPatches();
@@ -93,6 +93,7 @@ protected:
 	void ReadPCX24bits (uint8_t *dst, FileReader & lump, PCXHeader *hdr, int planes);
 
 	PalettedPixels CreatePalettedPixels(int conversion, int frame = 0) override;
+	bool SupportsThreadedDecoding() override { return true; }
 };
 
 
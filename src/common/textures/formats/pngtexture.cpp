@@ -34,6 +34,7 @@
 **
 */
 
+#include <mutex>
 #include "files.h"
 
 #include "m_png.h"
@@ -58,6 +59,7 @@ public:
 
 	int CopyPixels(FBitmap *bmp, int conversion, int frame = 0) override;
 	PalettedPixels CreatePalettedPixels(int conversion, int frame = 0) override;
+	bool SupportsThreadedDecoding() override { return true; }
 
 protected:
 	void ReadAlphaRemap(FileReader *lump, uint8_t *alpharemap);
@@ -356,6 +358,10 @@ void FPNGTexture::SetupPalette(FileReader &lump)
 	}
 	StartOfIDAT = (uint32_t)lump.Tell() - 8;
 
+	// PNGs may be decoded on worker threads during precaching and the arena is shared by all images.
+	static std::mutex arenaLock;
+	std::lock_guard<std::mutex> guard(arenaLock);
+
 	switch (ColorType)
 	{
 	case 0:		// Grayscale
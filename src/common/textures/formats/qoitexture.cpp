@@ -52,6 +52,7 @@ class FQOITexture : public FImageSource
 public:
 	FQOITexture(int lumpnum, QOIHeader& header);
 	PalettedPixels CreatePalettedPixels(int conversion, int frame = 0) override;
+	bool SupportsThreadedDecoding() override { return true; }
 	int CopyPixels(FBitmap *bmp, int conversion, int frame = 0) override;
 };
 
@@ -63,6 +63,7 @@ class FRawPageTexture : public FImageSource
 public:
 	FRawPageTexture (int lumpnum);
 	PalettedPixels CreatePalettedPixels(int conversion, int frame = 0) override;
+	bool SupportsThreadedDecoding() override { return true; }
 	int CopyPixels(FBitmap *bmp, int conversion, int frame = 0) override;
 };
 
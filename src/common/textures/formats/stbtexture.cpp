@@ -67,6 +67,7 @@ class FStbTexture : public FImageSource
 public:
 	FStbTexture (int lumpnum, int w, int h);
 	PalettedPixels CreatePalettedPixels(int conversion, int frame = 0) override;
+	bool SupportsThreadedDecoding() override { return true; }
 	int CopyPixels(FBitmap *bmp, int conversion, int frame = 0) override;
 };
 
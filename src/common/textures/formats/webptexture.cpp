@@ -48,6 +48,7 @@ class FWebPTexture : public FImageSource
 public:
 	FWebPTexture(int lumpnum, int w, int h, int xoff, int yoff);
 	PalettedPixels CreatePalettedPixels(int conversion, int frame = 0) override;
+	bool SupportsThreadedDecoding() override { return true; }
 	int CopyPixels(FBitmap *bmp, int conversion, int frame = 0) override;
 };
 
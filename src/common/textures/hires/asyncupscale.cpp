@@ -0,0 +1,183 @@
+/*
+** asyncupscale.cpp
+** Runs texture upscaling in the background
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 GZDoom Maintainers and Contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+** The job list is only ever accessed by the render thread. Each worker
+** only writes to its own job and then sets the job's Done flag.
+**
+** Jobs normally end when the hardware texture gets created. Those whose
+** texture has not been asked for in a while are dropped, so that the
+** upscaled buffers of textures that went out of view do not pile up.
+**
+*/
+
+#include <atomic>
+#include "asyncupscale.h"
+#include "c_cvars.h"
+#include "i_time.h"
+#include "textures.h"
+#include "hw_material.h"
+#include "image.h"
+#include "workerpool.h"
+
+CVAR(Bool, gl_texture_hqresize_async, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+
+FAsyncUpscaler AsyncUpscaler;
+
+struct FAsyncUpscaler::FJob
+{
+	FTexture *Texture;
+	int Translation;
+	int Flags;
+	int ImageID;
+	uint64_t LastRequest;
+	FTextureBuffer Buffer;
+	std::atomic<bool> Done = { false };
+	bool Failed = false;
+};
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+bool FAsyncUpscaler::Ready(FMaterial *mat, int translation)
+{
+	if (!gl_texture_hqresize_async) return true;
+
+	uint64_t now = I_msTime();
+	DiscardOldJobs(now);
+
+	bool ready = true;
+	auto &layers = mat->GetLayerArray();
+	for (unsigned i = 0; i < layers.Size(); i++)
+	{
+		auto &layer = layers[i];
+		// Only the base layer is translated.
+		if (layer.layerTexture && (layer.scaleFlags & CTF_Upscale) && !CheckLayer(layer.layerTexture, i == 0 ? translation : 0, layer.scaleFlags, now))
+		{
+			ready = false;
+		}
+	}
+	return ready;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+bool FAsyncUpscaler::CheckLayer(FTexture *tex, int translation, int flags, uint64_t now)
+{
+	if (tex->HasHardwareTexture(translation, flags) || tex->GetImage() == nullptr) return true;
+
+	flags &= CTF_CreateMask;
+	auto it = Jobs.find({ tex, translation, flags });
+	if (it != Jobs.end())
+	{
+		it->second->LastRequest = now;
+		return it->second->Done.load(std::memory_order_acquire);
+	}
+
+	bool hasAlpha;
+	auto job = std::make_shared<FJob>();
+	job->Texture = tex;
+	job->Translation = translation;
+	job->Flags = flags;
+	job->ImageID = tex->GetImage()->GetId();
+	job->LastRequest = now;
+	job->Buffer = tex->CreateUpscaleSource(translation, flags, hasAlpha);
+	Jobs.emplace(FJobKey{ tex, translation, flags }, job);
+
+	// The job only holds on to its own data, so it does not matter if it gets discarded before it finishes.
+	WorkerPool.Run([job, hasAlpha]()
+	{
+		try
+		{
+			FTexture::CreateUpsampledTextureBuffer(job->Buffer, hasAlpha, false);
+		}
+		catch (...)
+		{
+			job->Failed = true;
+		}
+		job->Done.store(true, std::memory_order_release);
+	});
+	return false;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+bool FAsyncUpscaler::Take(FTexture *tex, int translation, int flags, FTextureBuffer &result)
+{
+	flags &= CTF_CreateMask;
+	auto it = Jobs.find({ tex, translation, flags });
+	if (it == Jobs.end()) return false;
+
+	// Whatever state the job is in, the hardware texture is about to be created so it is not needed anymore.
+	auto job = std::move(it->second);
+	Jobs.erase(it);
+
+	// The image ID guards against the texture having been replaced by a new one at the same address.
+	if (!job->Done.load(std::memory_order_acquire) || job->Failed || tex->GetImage() == nullptr || tex->GetImage()->GetId() != job->ImageID) return false;
+	result = std::move(job->Buffer);
+	return true;
+}
+
+//==========================================================================
+//
+// Drops the jobs whose texture has not been asked for in a while, finished
+// or not. If the texture comes back into view it simply gets a new job.
+//
+//==========================================================================
+
+void FAsyncUpscaler::DiscardOldJobs(uint64_t now)
+{
+	const uint64_t MaxAge = 5000;
+	if (now - LastDiscard < 1000) return;
+	LastDiscard = now;
+
+	for (auto it = Jobs.begin(); it != Jobs.end();)
+	{
+		if (now - it->second->LastRequest > MaxAge) it = Jobs.erase(it);
+		else ++it;
+	}
+}
+
+void FAsyncUpscaler::Clear()
+{
+	Jobs.clear();
+}
@@ -0,0 +1,88 @@
+/*
+** asyncupscale.h
+** Runs texture upscaling in the background
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 GZDoom Maintainers and Contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <unordered_map>
+
+class FTexture;
+class FMaterial;
+struct FTextureBuffer;
+
+class FAsyncUpscaler
+{
+public:
+	// Returns true if the upscaled layers of the material can be used right away. Otherwise the missing
+	// upscaling jobs get started and the caller should use the unscaled material until they are done.
+	bool Ready(FMaterial *mat, int translation);
+
+	// Hands over the finished upscaled buffer, if there is one. Called when the hardware texture is created.
+	bool Take(FTexture *tex, int translation, int flags, FTextureBuffer &result);
+
+	// Discards all jobs, e.g. because the upscaling settings have changed.
+	void Clear();
+
+private:
+	struct FJob;
+
+	struct FJobKey
+	{
+		FTexture *Texture;
+		int Translation;
+		int Flags;
+
+		bool operator==(const FJobKey &other) const
+		{
+			return Texture == other.Texture && Translation == other.Translation && Flags == other.Flags;
+		}
+	};
+
+	struct FJobKeyHash
+	{
+		size_t operator()(const FJobKey &key) const
+		{
+			return std::hash<void *>()(key.Texture) ^ (size_t(key.Translation) * 0x9e3779b9u) ^ (size_t(key.Flags) << 24);
+		}
+	};
+
+	bool CheckLayer(FTexture *tex, int translation, int flags, uint64_t now);
+	void DiscardOldJobs(uint64_t now);
+
+	std::unordered_map<FJobKey, std::shared_ptr<FJob>, FJobKeyHash> Jobs;
+	uint64_t LastDiscard = 0;
+};
+
+extern FAsyncUpscaler AsyncUpscaler;
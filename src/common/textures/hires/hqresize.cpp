@@ -46,10 +46,12 @@
 #include "textures.h"
 #include "texturemanager.h"
 #include "printf.h"
+#include "upscalecache.h"
 
 int upscalemask;
 
 EXTERN_CVAR(Int, gl_texture_hqresizemult)
+EXTERN_CVAR(Int, gl_texture_hqresize_diskcache)
 CUSTOM_CVAR(Int, gl_texture_hqresizemode, 0, CVAR_ARCHIVE | CVAR_GLOBALCONFIG | CVAR_NOINITCALL)
 {
 	if (self < 0 || self > 6)
@@ -297,13 +299,8 @@ static unsigned char *hqNxAsmHelper( void (*hqNxFunction) ( int*, unsigned char*
 	outWidth = N * inWidth;
 	outHeight = N *inHeight;
 
-	static int initdone = false;
-
-	if (!initdone)
-	{
-		HQnX_asm::InitLUTs();
-		initdone = true;
-	}
+	// Upscaling may run on worker threads, so this relies on thread-safe static initialization.
+	static bool initdone = (HQnX_asm::InitLUTs(), true);
 
 	auto pImageIn = std::make_unique<HQnX_asm::CImage>();
 	auto& cImageIn = *pImageIn;
@@ -325,13 +322,8 @@ static unsigned char *hqNxHelper( void (HQX_CALLCONV *hqNxFunction) ( unsigned*,
 							  int &outWidth,
 							  int &outHeight )
 {
-	static int initdone = false;
-
-	if (!initdone)
-	{
-		hqxInit();
-		initdone = true;
-	}
+	// Upscaling may run on worker threads, so this relies on thread-safe static initialization.
+	static bool initdone = (hqxInit(), true);
 	outWidth = N * inWidth;
 	outHeight = N *inHeight;
 
@@ -414,6 +406,87 @@ static void xbrzOldScale(size_t factor, const uint32_t* src, uint32_t* trg, int
 }
 
 
+//===========================================================================
+// 
+// Runs the selected scaler over texbuffer.mBuffer and replaces it with the
+// result. Returns false if the combination of type and factor is not
+// supported, in which case the buffer is left alone.
+//
+//===========================================================================
+
+static bool UpscaleBuffer(FTextureBuffer &texbuffer, int type, int mult)
+{
+	int inWidth = texbuffer.mWidth;
+	int inHeight = texbuffer.mHeight;
+
+	if (type == 1)
+	{
+		if (mult == 2)
+			texbuffer.mBuffer = scaleNxHelper(&scale2x, 2, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
+		else if (mult == 3)
+			texbuffer.mBuffer = scaleNxHelper(&scale3x, 3, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
+		else if (mult == 4)
+			texbuffer.mBuffer = scaleNxHelper(&scale4x, 4, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
+		else return false;
+	}
+	else if (type == 2)
+	{
+		if (mult == 2)
+			texbuffer.mBuffer = hqNxHelper(&hq2x_32, 2, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
+		else if (mult == 3)
+			texbuffer.mBuffer = hqNxHelper(&hq3x_32, 3, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
+		else if (mult == 4)
+			texbuffer.mBuffer = hqNxHelper(&hq4x_32, 4, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
+		else return false;
+	}
+#ifdef HAVE_MMX
+	else if (type == 3)
+	{
+		if (mult == 2)
+			texbuffer.mBuffer = hqNxAsmHelper(&HQnX_asm::hq2x_32, 2, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
+		else if (mult == 3)
+			texbuffer.mBuffer = hqNxAsmHelper(&HQnX_asm::hq3x_32, 3, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
+		else if (mult == 4)
+			texbuffer.mBuffer = hqNxAsmHelper(&HQnX_asm::hq4x_32, 4, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
+		else return false;
+	}
+#endif
+	else if (type == 4)
+		texbuffer.mBuffer = xbrzHelper(xbrz::scale, mult, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
+	else if (type == 5)
+		texbuffer.mBuffer = xbrzHelper(xbrzOldScale, mult, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
+	else if (type == 6)
+		texbuffer.mBuffer = normalNx(mult, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
+	else
+		return false;
+	return true;
+}
+
+//===========================================================================
+// 
+// Everything that can change the scaler's output goes into the disk cache key.
+//
+//===========================================================================
+
+static std::string UpscaleCacheKey(const FTextureBuffer &texbuffer, int type, int mult)
+{
+	struct
+	{
+		int32_t type, mult;
+		float xbrz[5];
+	} settings = { type, mult, {} };
+
+	if (type == 4 || type == 5)
+	{
+		settings.xbrz[0] = xbrz_luminanceweight;
+		settings.xbrz[1] = xbrz_equalcolortolerance;
+		settings.xbrz[2] = type == 4 ? *xbrz_centerdirectionbias : 0.f;
+		settings.xbrz[3] = xbrz_dominantdirectionthreshold;
+		settings.xbrz[4] = xbrz_steepdirectionthreshold;
+	}
+	return FUpscaleCache::MakeKey(texbuffer.mBuffer, texbuffer.mWidth, texbuffer.mHeight, &settings, sizeof(settings));
+}
+
 //===========================================================================
 // 
 // [BB] Upsamples the texture in texbuffer.mBuffer, frees texbuffer.mBuffer and returns
@@ -426,9 +499,6 @@ void FTexture::CreateUpsampledTextureBuffer(FTextureBuffer &texbuffer, bool hasA
 	// [BB] Make sure that inWidth and inHeight denote the size of
 	// the returned buffer even if we don't upsample the input buffer.
 
-	int inWidth = texbuffer.mWidth;
-	int inHeight = texbuffer.mHeight;
-
 	int type = gl_texture_hqresizemode;
 	int mult = gl_texture_hqresizemult;
 #ifdef HAVE_MMX
@@ -444,46 +514,30 @@ void FTexture::CreateUpsampledTextureBuffer(FTextureBuffer &texbuffer, bool hasA
 
 	if (!checkonly)
 	{
-		if (type == 1)
+		std::string cachekey;
+		uint8_t *cached = nullptr;
+		int width, height;
+
+		if (gl_texture_hqresize_diskcache > 0)
 		{
-			if (mult == 2)
-				texbuffer.mBuffer = scaleNxHelper(&scale2x, 2, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
-			else if (mult == 3)
-				texbuffer.mBuffer = scaleNxHelper(&scale3x, 3, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
-			else if (mult == 4)
-				texbuffer.mBuffer = scaleNxHelper(&scale4x, 4, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
-			else return;
+			cachekey = UpscaleCacheKey(texbuffer, type, mult);
+			cached = UpscaleCache.Load(cachekey, width, height);
 		}
-		else if (type == 2)
+
+		if (cached != nullptr && width == texbuffer.mWidth * mult && height == texbuffer.mHeight * mult)
 		{
-			if (mult == 2)
-				texbuffer.mBuffer = hqNxHelper(&hq2x_32, 2, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
-			else if (mult == 3)
-				texbuffer.mBuffer = hqNxHelper(&hq3x_32, 3, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
-			else if (mult == 4)
-				texbuffer.mBuffer = hqNxHelper(&hq4x_32, 4, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
-			else return;
+			if (texbuffer.mFreeBuffer) delete[] texbuffer.mBuffer;
+			texbuffer.mBuffer = cached;
+			texbuffer.mFreeBuffer = true;
+			texbuffer.mWidth = width;
+			texbuffer.mHeight = height;
 		}
-#ifdef HAVE_MMX
-		else if (type == 3)
+		else
 		{
-			if (mult == 2)
-				texbuffer.mBuffer = hqNxAsmHelper(&HQnX_asm::hq2x_32, 2, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
-			else if (mult == 3)
-				texbuffer.mBuffer = hqNxAsmHelper(&HQnX_asm::hq3x_32, 3, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
-			else if (mult == 4)
-				texbuffer.mBuffer = hqNxAsmHelper(&HQnX_asm::hq4x_32, 4, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
-			else return;
+			delete[] cached;
+			if (!UpscaleBuffer(texbuffer, type, mult)) return;
+			if (!cachekey.empty()) UpscaleCache.Store(cachekey, texbuffer.mBuffer, texbuffer.mWidth, texbuffer.mHeight);
 		}
-#endif
-		else if (type == 4)
-			texbuffer.mBuffer = xbrzHelper(xbrz::scale, mult, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
-		else if (type == 5)
-			texbuffer.mBuffer = xbrzHelper(xbrzOldScale, mult, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
-		else if (type == 6)
-			texbuffer.mBuffer = normalNx(mult, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
-		else
-			return;
 	}
 	else
 	{
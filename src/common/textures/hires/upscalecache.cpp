@@ -0,0 +1,379 @@
+/*
+** upscalecache.cpp
+** Persistent disk cache for upscaled texture data
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 GZDoom Maintainers and Contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+** Each upscaled image is stored deflated in its own file in the cache
+** directory. A small index keeps track of the entries' sizes and when
+** they were last used, so that the least recently used ones can be
+** deleted once the cache exceeds its size budget. Files which are not
+** in the index, e.g. after a crash, are picked up on startup and are
+** the first ones to go. The index is only written when a level starts,
+** when the budget changes and on shutdown, not after every store.
+**
+*/
+
+#include <miniz.h>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include "upscalecache.h"
+#include "c_cvars.h"
+#include "c_dispatch.h"
+#include "cmdlib.h"
+#include "md5.h"
+#include "files.h"
+#include "fs_findfile.h"
+#include "i_specialpaths.h"
+#include "printf.h"
+
+static const char IndexMagic[4] = { 'U', 'P', 'C', 'I' };
+static const char EntryMagic[4] = { 'U', 'P', 'C', 'E' };
+static const uint32_t CacheVersion = 1;
+
+FUpscaleCache UpscaleCache;
+
+CUSTOM_CVAR(Int, gl_texture_hqresize_diskcache, 256, CVAR_ARCHIVE | CVAR_GLOBALCONFIG | CVAR_NOINITCALL)
+{
+	if (self < 0) self = 0;
+	else UpscaleCache.ApplyBudget();
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+FUpscaleCache::~FUpscaleCache()
+{
+	Flush();
+}
+
+std::string FUpscaleCache::MakeKey(const uint8_t *pixels, int width, int height, const void *settings, size_t settingslen)
+{
+	uint8_t digest[16];
+	uint32_t size[2] = { uint32_t(width), uint32_t(height) };
+	MD5Context md5;
+	md5.Update((const uint8_t *)size, sizeof(size));
+	md5.Update((const uint8_t *)settings, (unsigned)settingslen);
+	md5.Update(pixels, unsigned(width * height * 4));
+	md5.Final(digest);
+
+	char hexdigest[33];
+	for (int i = 0; i < 16; i++)
+	{
+		snprintf(hexdigest + i * 2, 3, "%02x", digest[i]);
+	}
+	return hexdigest;
+}
+
+std::string FUpscaleCache::EntryPath(const std::string &key) const
+{
+	return Path + key + ".upc";
+}
+
+//==========================================================================
+//
+// Must be called with the lock held.
+//
+//==========================================================================
+
+void FUpscaleCache::Init()
+{
+	if (Inited) return;
+	Inited = true;
+
+	FString path = M_GetCachePath(true);
+	path << "/upscaled/";
+	CreatePath(path.GetChars());
+	Path = path.GetChars();
+
+	FileReader fr;
+	if (fr.OpenFile((Path + "index.dat").c_str()))
+	{
+		char magic[4];
+		if (fr.Read(magic, 4) == 4 && !memcmp(magic, IndexMagic, 4) && fr.ReadUInt32() == CacheVersion)
+		{
+			UseCounter = fr.ReadUInt64();
+			uint32_t count = fr.ReadUInt32();
+			for (uint32_t i = 0; i < count; i++)
+			{
+				char key[33];
+				if (fr.Read(key, 32) != 32) break;
+				key[32] = 0;
+				FEntry entry;
+				entry.Size = fr.ReadUInt32();
+				entry.LastUse = fr.ReadUInt64();
+				Entries[key] = entry;
+			}
+		}
+	}
+
+	// The directory is the authority over what is actually cached.
+	std::unordered_map<std::string, FEntry> found;
+	FileSys::FileList list;
+	if (FileSys::ScanDirectory(list, Path.c_str(), "*.upc", true))
+	{
+		for (auto &file : list)
+		{
+			if (file.isDirectory) continue;
+			if (file.FileName.length() != 36)
+			{
+				// Leftover from a store that never completed.
+				if (file.FileName.length() > 8 && file.FileName.compare(file.FileName.length() - 8, 8, ".tmp.upc") == 0)
+					RemoveFile((Path + file.FileName).c_str());
+				continue;
+			}
+			std::string key = file.FileName.substr(0, 32);
+			auto it = Entries.find(key);
+			FEntry entry = { uint32_t(file.Length), it == Entries.end() ? 0 : it->second.LastUse };
+			found[key] = entry;
+			TotalSize += entry.Size;
+		}
+	}
+	Dirty = found.size() != Entries.size();
+	Entries = std::move(found);
+}
+
+//==========================================================================
+//
+// Must be called with the lock held.
+//
+//==========================================================================
+
+void FUpscaleCache::Remove(const std::string &key)
+{
+	auto it = Entries.find(key);
+	if (it == Entries.end()) return;
+	TotalSize -= it->second.Size;
+	Entries.erase(it);
+	RemoveFile(EntryPath(key).c_str());
+	Dirty = true;
+}
+
+void FUpscaleCache::Trim(uint64_t budget)
+{
+	if (TotalSize <= budget) return;
+
+	// Leave some room so that the following stores do not have to sort all entries again.
+	budget -= budget / 8;
+
+	std::vector<std::pair<uint64_t, std::string>> order;
+	order.reserve(Entries.size());
+	for (auto &entry : Entries) order.emplace_back(entry.second.LastUse, entry.first);
+	std::sort(order.begin(), order.end());
+
+	for (auto &entry : order)
+	{
+		if (TotalSize <= budget) break;
+		Remove(entry.second);
+		Evictions++;
+	}
+}
+
+void FUpscaleCache::ApplyBudget()
+{
+	std::lock_guard<std::mutex> guard(Lock);
+	if (!Inited) return;
+	Trim(uint64_t(gl_texture_hqresize_diskcache) << 20);
+	WriteIndex();
+}
+
+//==========================================================================
+//
+// Must be called with the lock held.
+//
+//==========================================================================
+
+void FUpscaleCache::WriteIndex()
+{
+	if (!Dirty) return;
+	Dirty = false;
+
+	std::unique_ptr<FileWriter> fw(FileWriter::Open((Path + "index.dat").c_str()));
+	if (fw)
+	{
+		uint32_t count = uint32_t(Entries.size());
+		fw->Write(IndexMagic, 4);
+		fw->Write(&CacheVersion, sizeof(uint32_t));
+		fw->Write(&UseCounter, sizeof(uint64_t));
+		fw->Write(&count, sizeof(uint32_t));
+		for (auto &entry : Entries)
+		{
+			fw->Write(entry.first.c_str(), 32);
+			fw->Write(&entry.second.Size, sizeof(uint32_t));
+			fw->Write(&entry.second.LastUse, sizeof(uint64_t));
+		}
+	}
+}
+
+void FUpscaleCache::Flush()
+{
+	std::lock_guard<std::mutex> guard(Lock);
+	if (Inited) WriteIndex();
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+uint8_t *FUpscaleCache::Load(const std::string &key, int &width, int &height)
+{
+	if (gl_texture_hqresize_diskcache <= 0) return nullptr;
+
+	std::string path;
+	{
+		std::lock_guard<std::mutex> guard(Lock);
+		Init();
+		auto it = Entries.find(key);
+		if (it == Entries.end())
+		{
+			Misses++;
+			return nullptr;
+		}
+		it->second.LastUse = ++UseCounter;
+		Dirty = true;
+		path = EntryPath(key);
+	}
+
+	// The file is read and inflated outside the lock. Anything that does not look right is treated as a miss and gets removed.
+	FileReader fr;
+	uint8_t *buffer = nullptr;
+	if (fr.OpenFile(path.c_str()))
+	{
+		char magic[4];
+		if (fr.Read(magic, 4) == 4 && !memcmp(magic, EntryMagic, 4) && fr.ReadUInt32() == CacheVersion)
+		{
+			int w = fr.ReadInt32();
+			int h = fr.ReadInt32();
+			uint32_t packedsize = fr.ReadUInt32();
+			if (w > 0 && h > 0 && w <= 16384 && h <= 16384 && packedsize == fr.GetLength() - fr.Tell())
+			{
+				auto packed = fr.Read(packedsize);
+				mz_ulong size = mz_ulong(w) * h * 4;
+				buffer = new uint8_t[size];
+				if (packed.size() != packedsize || uncompress(buffer, &size, packed.bytes(), packedsize) != Z_OK || size != mz_ulong(w) * h * 4)
+				{
+					delete[] buffer;
+					buffer = nullptr;
+				}
+				else
+				{
+					width = w;
+					height = h;
+				}
+			}
+		}
+	}
+
+	std::lock_guard<std::mutex> guard(Lock);
+	if (buffer == nullptr)
+	{
+		Misses++;
+		Remove(key);
+	}
+	else Hits++;
+	return buffer;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+void FUpscaleCache::Store(const std::string &key, const uint8_t *pixels, int width, int height)
+{
+	if (gl_texture_hqresize_diskcache <= 0) return;
+
+	uint64_t budget = uint64_t(gl_texture_hqresize_diskcache) << 20;
+	mz_ulong size = mz_ulong(width) * height * 4;
+	mz_ulong packedsize = compressBound(size);
+	std::unique_ptr<uint8_t[]> packed(new uint8_t[packedsize]);
+	// Upscaled images compress well even at the fastest level, and this runs on the texture creation path.
+	if (compress2(packed.get(), &packedsize, pixels, size, Z_BEST_SPEED) != Z_OK) return;
+
+	uint32_t filesize = uint32_t(packedsize + 20);
+	if (filesize > budget) return;
+
+	std::string path, temppath;
+	{
+		std::lock_guard<std::mutex> guard(Lock);
+		Init();
+		if (Entries.find(key) != Entries.end() || !Pending.insert(key).second) return;
+		path = EntryPath(key);
+		temppath = Path + key + ".tmp.upc";
+	}
+
+	// The file only gets its real name once it is complete, so that Load never sees a partial one.
+	std::unique_ptr<FileWriter> fw(FileWriter::Open(temppath.c_str()));
+	bool ok = fw != nullptr;
+	if (ok)
+	{
+		uint32_t header[4] = { CacheVersion, uint32_t(width), uint32_t(height), uint32_t(packedsize) };
+		ok = fw->Write(EntryMagic, 4) == 4 && fw->Write(header, sizeof(header)) == sizeof(header) && fw->Write(packed.get(), packedsize) == packedsize;
+		fw.reset();
+		ok = ok && RenameFile(temppath.c_str(), path.c_str());
+		if (!ok) RemoveFile(temppath.c_str());
+	}
+
+	std::lock_guard<std::mutex> guard(Lock);
+	Pending.erase(key);
+	if (!ok) return;
+	auto &entry = Entries[key];
+	TotalSize += filesize - entry.Size;
+	entry.Size = filesize;
+	entry.LastUse = ++UseCounter;
+	Stores++;
+	Dirty = true;
+	Trim(budget);
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+void FUpscaleCache::PrintStats()
+{
+	std::lock_guard<std::mutex> guard(Lock);
+	Init();
+	Printf("Upscale cache: %u entries, %.1f of %d MB used\n", unsigned(Entries.size()), TotalSize / 1048576., *gl_texture_hqresize_diskcache);
+	Printf("This session: %u hits, %u misses, %u stored, %u evicted\n", Hits, Misses, Stores, Evictions);
+}
+
+CCMD(upscalecachestats)
+{
+	UpscaleCache.PrintStats();
+}
@@ -0,0 +1,89 @@
+/*
+** upscalecache.h
+** Persistent disk cache for upscaled texture data
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 GZDoom Maintainers and Contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+class FUpscaleCache
+{
+public:
+	~FUpscaleCache();
+
+	// Identifies an upscaled image by the source pixels and everything else that can affect the scaler's output.
+	static std::string MakeKey(const uint8_t *pixels, int width, int height, const void *settings, size_t settingslen);
+
+	// Returns a buffer allocated with new[] or nullptr if the key is not cached.
+	uint8_t *Load(const std::string &key, int &width, int &height);
+	void Store(const std::string &key, const uint8_t *pixels, int width, int height);
+
+	// Writes the index if it changed since it was last written.
+	void Flush();
+
+	// Deletes the least recently used entries until the cache fits into gl_texture_hqresize_diskcache
+	// and writes the index. Called when a level starts.
+	void ApplyBudget();
+
+	void PrintStats();
+
+private:
+	struct FEntry
+	{
+		uint32_t Size;		// on disk
+		uint64_t LastUse;
+	};
+
+	void Init();
+	void Remove(const std::string &key);
+	void Trim(uint64_t budget);
+	void WriteIndex();
+	std::string EntryPath(const std::string &key) const;
+
+	std::mutex Lock;
+	std::unordered_map<std::string, FEntry> Entries;
+	std::unordered_set<std::string> Pending;	// being written by Store
+	std::string Path;
+	uint64_t TotalSize = 0;
+	uint64_t UseCounter = 0;
+	bool Inited = false;
+	bool Dirty = false;
+
+	unsigned Hits = 0, Misses = 0, Stores = 0, Evictions = 0;
+};
+
+extern FUpscaleCache UpscaleCache;
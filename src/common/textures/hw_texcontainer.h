@@ -115,6 +115,11 @@ public:
 		return tt->hwTexture;
 	}
 
+	bool HasHardwareTexture(int translation, int scaleflags)
+	{
+		return GetTexID(translation, scaleflags)->hwTexture != nullptr;
+	}
+
 	void AddHardwareTexture(int translation, int scaleflags, IHardwareTexture *tex)
 	{
 		auto tt = GetTexID(translation, scaleflags);
@@ -40,12 +40,25 @@
 #include "files.h"
 #include "cmdlib.h"
 #include "palettecontainer.h"
+#include "workerpool.h"
 
 FMemArena ImageArena(32768);
 TArray<FImageSource *>FImageSource::ImageForLump;
 int FImageSource::NextID;
 static PrecacheInfo precacheInfo;
 
+// All images registered for precaching in registration order, which is also roughly the order in which the renderer will ask for them.
+static TArray<FImageSource *> precacheImages;
+static TMap<int, unsigned> precachePosition;
+static bool precaching;
+
+// Limits for a single batch of images decoded ahead of time.
+enum
+{
+	DECODEAHEAD_MAXIMAGES = 256,
+	DECODEAHEAD_MAXBYTES = 64 << 20,
+};
+
 struct PrecacheDataPaletted
 {
 	PalettedPixels Pixels;
@@ -87,7 +100,12 @@ PalettedPixels FImageSource::GetCachedPalettedPixels(int conversion, int frame)
 	auto imageID = ImageID;
 
 	// Do we have this image in the cache?
-	unsigned index = conversion != normal? UINT_MAX : precacheDataPaletted.FindEx([=](PrecacheDataPaletted &entry) { return entry.ImageID == imageID && entry.Frame == frame; });
+	auto findcached = [=]() { return precacheDataPaletted.FindEx([=](PrecacheDataPaletted &entry) { return entry.ImageID == imageID && entry.Frame == frame; }); };
+	unsigned index = conversion != normal? UINT_MAX : findcached();
+	if (index >= precacheDataPaletted.Size() && conversion == normal && frame == 0 && DecodeAhead(this, false))
+	{
+		index = findcached();
+	}
 	if (index < precacheDataPaletted.Size())
 	{
 		auto cache = &precacheDataPaletted[index];
@@ -126,6 +144,7 @@ PalettedPixels FImageSource::GetCachedPalettedPixels(int conversion, int frame)
 			PrecacheDataPaletted *pdp = &precacheDataPaletted[precacheDataPaletted.Reserve(1)];
 
 			pdp->ImageID = imageID;
+			pdp->Frame = frame;
 			pdp->RefCount = info->second - 1;
 			info->second = 0;
 			pdp->Pixels = CreatePalettedPixels(normal, frame);
@@ -214,7 +233,12 @@ FBitmap FImageSource::GetCachedBitmap(const PalEntry *remap, int conversion, int
 	{
 		if (conversion == luminance) conversion = normal;	// luminance has no meaning for true color.
 		// Do we have this image in the cache?
-		unsigned index = conversion != normal? UINT_MAX : precacheDataRgba.FindEx([=](PrecacheDataRgba &entry) { return entry.ImageID == imageID && entry.Frame == frame; });
+		auto findcached = [=]() { return precacheDataRgba.FindEx([=](PrecacheDataRgba &entry) { return entry.ImageID == imageID && entry.Frame == frame; }); };
+		unsigned index = conversion != normal? UINT_MAX : findcached();
+		if (index >= precacheDataRgba.Size() && conversion == normal && frame == 0 && DecodeAhead(this, true))
+		{
+			index = findcached();
+		}
 		if (index < precacheDataRgba.Size())
 		{
 			auto cache = &precacheDataRgba[index];
@@ -290,18 +314,127 @@ void FImageSource::CollectForPrecache(PrecacheInfo &info, bool requiretruecolor)
 	{
 		auto pair = std::make_pair(tc, !tc);
 		info.Insert(ImageID, pair);
+		if (&info == &precacheInfo)
+		{
+			precachePosition.Insert(ImageID, precacheImages.Push(this));
+		}
 	}
 }
 
 void FImageSource::BeginPrecaching()
 {
 	precacheInfo.Clear();
+	precacheImages.Clear();
+	precachePosition.Clear();
+	precaching = true;
 }
 
 void FImageSource::EndPrecaching()
 {
 	precacheDataPaletted.Clear();
 	precacheDataRgba.Clear();
+	precacheImages.Reset();
+	precachePosition.Clear();
+	precaching = false;
+}
+
+//==========================================================================
+//
+// Called on a cache miss while precaching. Decodes the requested image
+// together with the images that were registered after it on the worker
+// threads and places the results in the precache cache so that the
+// following requests can be served from there.
+//
+// Returns false if nothing was decoded, in which case the caller has
+// to create the image itself.
+//
+//==========================================================================
+
+bool FImageSource::DecodeAhead(FImageSource *img, bool truecolor)
+{
+	if (!precaching || FWorkerPool::IsWorkerThread() || !img->SupportsThreadedDecoding()) return false;
+
+	auto info = precacheInfo.CheckKey(img->ImageID);
+	auto pos = precachePosition.CheckKey(img->ImageID);
+	if (info == nullptr || pos == nullptr || (truecolor ? info->first : info->second) <= 0) return false;
+
+	struct DecodeJob
+	{
+		FImageSource *Image;
+		bool Rgba, Paletted;
+		bool Failed = false;
+		FBitmap Bitmap;
+		int Trans = 0;
+		PalettedPixels Pixels;
+	};
+
+	TArray<DecodeJob> jobs;
+	size_t bytes = 0;
+
+	for (unsigned i = *pos; i < precacheImages.Size() && jobs.Size() < DECODEAHEAD_MAXIMAGES && bytes < DECODEAHEAD_MAXBYTES; i++)
+	{
+		auto image = precacheImages[i];
+		if (!image->SupportsThreadedDecoding() || image->NumOfFrames != 1 || image->Width <= 0 || image->Height <= 0) continue;
+
+		// Images which are already cached or have already been handed out have their counters reset.
+		auto imageinfo = precacheInfo.CheckKey(image->ImageID);
+		if (imageinfo == nullptr || (imageinfo->first <= 0 && imageinfo->second <= 0)) continue;
+
+		auto &job = jobs[jobs.Reserve(1)];
+		job.Image = image;
+		job.Rgba = imageinfo->first > 0;
+		job.Paletted = imageinfo->second > 0;
+		bytes += size_t(image->Width) * image->Height * (job.Rgba * 4 + job.Paletted);
+	}
+	if (jobs.Size() == 0) return false;
+
+	WorkerPool.ParallelFor(jobs.Size(), [&](int i)
+	{
+		auto &job = jobs[i];
+		// Errors are left for the regular code path so that they get reported for the image that was actually requested.
+		try
+		{
+			if (job.Rgba)
+			{
+				job.Bitmap.Create(job.Image->Width, job.Image->Height);
+				job.Trans = job.Image->CopyPixels(&job.Bitmap, normal, 0);
+			}
+			if (job.Paletted)
+			{
+				job.Pixels = job.Image->CreatePalettedPixels(normal, 0);
+			}
+		}
+		catch (...)
+		{
+			job.Failed = true;
+		}
+	});
+
+	for (auto &job : jobs)
+	{
+		if (job.Failed) continue;
+		auto imageinfo = precacheInfo.CheckKey(job.Image->ImageID);
+		if (job.Rgba)
+		{
+			PrecacheDataRgba *pdr = &precacheDataRgba[precacheDataRgba.Reserve(1)];
+			pdr->ImageID = job.Image->ImageID;
+			pdr->Frame = 0;
+			pdr->RefCount = imageinfo->first;
+			pdr->TransInfo = job.Trans;
+			pdr->Pixels = std::move(job.Bitmap);
+			imageinfo->first = 0;
+		}
+		if (job.Paletted)
+		{
+			PrecacheDataPaletted *pdp = &precacheDataPaletted[precacheDataPaletted.Reserve(1)];
+			pdp->ImageID = job.Image->ImageID;
+			pdp->Frame = 0;
+			pdp->RefCount = imageinfo->second;
+			pdp->Pixels = std::move(job.Pixels);
+			imageinfo->second = 0;
+		}
+	}
+	return true;
 }
 
 void FImageSource::RegisterForPrecache(FImageSource *img, bool requiretruecolor)
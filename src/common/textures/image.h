@@ -78,11 +78,13 @@ protected:
 
 	virtual PalettedPixels CreatePalettedPixels(int conversion, int frame = 0);
 	int CopyTranslatedPixels(FBitmap *bmp, const PalEntry *remap, int frame = 0);
+	static bool DecodeAhead(FImageSource *img, bool truecolor);
 
 
 public:
 	virtual bool SupportRemap0() { return false; }		// Unfortunate hackery that's needed for Hexen's skies. Only the image can know about the needed parameters
 	virtual bool IsRawCompatible() { return true; }		// Same thing for mid texture compatibility handling. Can only be determined by looking at the composition data which is private to the image.
+	virtual bool SupportsThreadedDecoding() { return false; }	// true if CopyPixels and CreatePalettedPixels only access this image's own data, so that precaching can run them on worker threads.
 
 	void CopySize(FImageSource &other) noexcept
 	{
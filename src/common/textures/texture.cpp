@@ -34,6 +34,7 @@
 **
 */
 
+#include <mutex>
 #include "printf.h"
 #include "files.h"
 #include "filesystem.h"
@@ -51,6 +52,7 @@
 #include "imagehelpers.h"
 #include "v_video.h"
 #include "v_font.h"
+#include "asyncupscale.h"
 
 // Wrappers to keep the definitions of these classes out of here.
 IHardwareTexture* CreateHardwareTexture(int numchannels);
@@ -317,6 +319,83 @@ bool FTexture::ProcessData(unsigned char* buffer, int w, int h, bool ispatch)
 	return true;
 }
 
+//===========================================================================
+// 
+//	Initializes the buffer for the texture data without any postprocessing
+//
+//===========================================================================
+
+FTextureBuffer FTexture::CreateRawTexBuffer(int translation, int flags, int &isTransparent)
+{
+	FTextureBuffer result;
+	unsigned char* buffer = nullptr;
+	int W, H;
+	bool checkonly = !!(flags & CTF_CheckOnly);
+
+	int exx = !!(flags & CTF_Expand);
+
+	W = GetWidth() + 2 * exx;
+	H = GetHeight() + 2 * exx;
+
+	if (!checkonly)
+	{
+		auto remap = translation <= 0 || IsLuminosityTranslation(translation) ? nullptr : GPalette.TranslationToTable(translation);
+		if (remap && remap->Inactive) remap = nullptr;
+		if (remap) translation = remap->Index;
+
+		int trans;
+		auto Pixels = GetBgraBitmap(remap ? remap->Palette : nullptr, &trans);
+		
+		if(!exx && Pixels.ClipRect.x == 0 && Pixels.ClipRect.y == 0 && Pixels.ClipRect.width == Pixels.Width && Pixels.ClipRect.height == Pixels.Height && (Pixels.FreeBuffer || !IsLuminosityTranslation(translation)))
+		{
+			buffer = Pixels.data;
+			result.mFreeBuffer = Pixels.FreeBuffer;
+			Pixels.FreeBuffer = false;
+		}
+		else
+		{
+			buffer = new unsigned char[W * (H + 1) * 4];
+			memset(buffer, 0, W * (H + 1) * 4);
+
+			FBitmap bmp(buffer, W * 4, W, H);
+
+			bmp.Blit(exx, exx, Pixels);
+		}
+		
+		if (IsLuminosityTranslation(translation))
+		{
+			V_ApplyLuminosityTranslation(LuminosityTranslationDesc::fromInt(translation), buffer, W * H);
+		}
+
+		if (remap == nullptr)
+		{
+			CheckTrans(buffer, W * H, trans);
+			isTransparent = bTranslucent;
+		}
+		else
+		{
+			isTransparent = 0;
+			// A translated image is not conclusive for setting the texture's transparency info.
+		}
+	}
+
+	if (GetImage())
+	{
+		FContentIdBuilder builder;
+		builder.id = 0;
+		builder.imageID = GetImage()->GetId();
+		builder.translation = max(0, translation);
+		builder.expand = exx;
+		result.mContentId = builder.id;
+	}
+	else result.mContentId = 0;	// for non-image backed textures this has no meaning so leave it at 0.
+
+	result.mBuffer = buffer;
+	result.mWidth = W;
+	result.mHeight = H;
+	return result;
+}
+
 //===========================================================================
 // 
 //	Initializes the buffer for the texture data
@@ -340,74 +419,17 @@ FTextureBuffer FTexture::CreateTexBuffer(int translation, int flags)
 		result.mContentId = 0;
 		ImageHelpers::FlipNonSquareBlock(result.mBuffer, p, h, w, h);
 	}
+	else if ((flags & (CTF_Upscale | CTF_ProcessData | CTF_CheckOnly)) == (CTF_Upscale | CTF_ProcessData) && AsyncUpscaler.Take(this, translation, flags, result))
+	{
+		// The upscaling was already done in the background.
+		ProcessData(result.mBuffer, result.mWidth, result.mHeight, false);
+	}
 	else
 	{
-		unsigned char* buffer = nullptr;
-		int W, H;
 		int isTransparent = -1;
 		bool checkonly = !!(flags & CTF_CheckOnly);
 
-		int exx = !!(flags & CTF_Expand);
-
-		W = GetWidth() + 2 * exx;
-		H = GetHeight() + 2 * exx;
-
-		if (!checkonly)
-		{
-			auto remap = translation <= 0 || IsLuminosityTranslation(translation) ? nullptr : GPalette.TranslationToTable(translation);
-			if (remap && remap->Inactive) remap = nullptr;
-			if (remap) translation = remap->Index;
-
-			int trans;
-			auto Pixels = GetBgraBitmap(remap ? remap->Palette : nullptr, &trans);
-			
-			if(!exx && Pixels.ClipRect.x == 0 && Pixels.ClipRect.y == 0 && Pixels.ClipRect.width == Pixels.Width && Pixels.ClipRect.height == Pixels.Height && (Pixels.FreeBuffer || !IsLuminosityTranslation(translation)))
-			{
-				buffer = Pixels.data;
-				result.mFreeBuffer = Pixels.FreeBuffer;
-				Pixels.FreeBuffer = false;
-			}
-			else
-			{
-				buffer = new unsigned char[W * (H + 1) * 4];
-				memset(buffer, 0, W * (H + 1) * 4);
-
-				FBitmap bmp(buffer, W * 4, W, H);
-
-				bmp.Blit(exx, exx, Pixels);
-			}
-			
-			if (IsLuminosityTranslation(translation))
-			{
-				V_ApplyLuminosityTranslation(LuminosityTranslationDesc::fromInt(translation), buffer, W * H);
-			}
-
-			if (remap == nullptr)
-			{
-				CheckTrans(buffer, W * H, trans);
-				isTransparent = bTranslucent;
-			}
-			else
-			{
-				isTransparent = 0;
-				// A translated image is not conclusive for setting the texture's transparency info.
-			}
-		}
-
-		if (GetImage())
-		{
-			FContentIdBuilder builder;
-			builder.id = 0;
-			builder.imageID = GetImage()->GetId();
-			builder.translation = max(0, translation);
-			builder.expand = exx;
-			result.mContentId = builder.id;
-		}
-		else result.mContentId = 0;	// for non-image backed textures this has no meaning so leave it at 0.
-
-		result.mBuffer = buffer;
-		result.mWidth = W;
-		result.mHeight = H;
+		result = CreateRawTexBuffer(translation, flags, isTransparent);
 
 		// Only do postprocessing for image-backed textures. (i.e. not for the burn texture which can also pass through here.)
 		if (GetImage() && flags & CTF_ProcessData)
@@ -421,6 +443,27 @@ FTextureBuffer FTexture::CreateTexBuffer(int translation, int flags)
 
 }
 
+//===========================================================================
+// 
+//	The upscaling job runs on another thread and must own its input.
+//
+//===========================================================================
+
+FTextureBuffer FTexture::CreateUpscaleSource(int translation, int flags, bool &hasAlpha)
+{
+	int isTransparent = -1;
+	auto result = CreateRawTexBuffer(translation, flags & CTF_Expand, isTransparent);
+	if (!result.mFreeBuffer && result.mBuffer != nullptr)
+	{
+		auto copy = new uint8_t[result.mWidth * result.mHeight * 4];
+		memcpy(copy, result.mBuffer, result.mWidth * result.mHeight * 4);
+		result.mBuffer = copy;
+		result.mFreeBuffer = true;
+	}
+	hasAlpha = !!isTransparent;
+	return result;
+}
+
 //===========================================================================
 // 
 // Dummy texture for the 0-entry.
@@ -434,6 +477,20 @@ bool FTexture::DetermineTranslucency()
 	return !!bTranslucent;
 }
 
+//===========================================================================
+// 
+// The hardware renderer's BSP workers may run into the same texture at
+// the same time, so the first check gets serialized.
+//
+//===========================================================================
+
+bool FTexture::CheckTranslucency()
+{
+	static std::mutex TranslucencyMutex;
+	std::lock_guard<std::mutex> lock(TranslucencyMutex);
+	return bTranslucent != -1 ? !!bTranslucent : DetermineTranslucency();
+}
+
 //===========================================================================
 // 
 // the default just returns an empty texture.
@@ -49,6 +49,7 @@
 #include "formats/multipatchtexture.h"
 #include "basics.h"
 #include "cmdlib.h"
+#include "asyncupscale.h"
 
 using namespace FileSys;
 FTextureManager TexMan;
@@ -118,6 +119,7 @@ void FTextureManager::DeleteAll()
 
 void FTextureManager::FlushAll()
 {
+	AsyncUpscaler.Clear();
 	for (int i = TexMan.NumTextures() - 1; i >= 0; i--)
 	{
 		for (int j = 0; j < 2; j++)
@@ -227,8 +227,12 @@ protected:
 public:
 
 	IHardwareTexture* GetHardwareTexture(int translation, int scaleflags);
+	bool HasHardwareTexture(int translation, int scaleflags)
+	{
+		return SystemTextures.HasHardwareTexture(translation, scaleflags);
+	}
 	virtual FImageSource *GetImage() const { return nullptr; }
-	void CreateUpsampledTextureBuffer(FTextureBuffer &texbuffer, bool hasAlpha, bool checkonly);
+	static void CreateUpsampledTextureBuffer(FTextureBuffer &texbuffer, bool hasAlpha, bool checkonly);
 
 	void CleanHardwareTextures()
 	{
@@ -290,13 +294,18 @@ public:
 
 	FTexture (int lumpnum = -1);
 
+	FTextureBuffer CreateRawTexBuffer(int translation, int flags, int &isTransparent);
+
 public:
 	FTextureBuffer CreateTexBuffer(int translation, int flags = 0);
+	// Creates the unscaled input for an upscaling job that runs outside of CreateTexBuffer.
+	FTextureBuffer CreateUpscaleSource(int translation, int flags, bool &hasAlpha);
 	virtual bool DetermineTranslucency();
 	bool GetTranslucency()
 	{
-		return bTranslucent != -1 ? bTranslucent : DetermineTranslucency();
+		return bTranslucent != -1 ? bTranslucent : CheckTranslucency();
 	}
+	bool CheckTranslucency();
 
 public:
 
@@ -603,6 +603,17 @@ void RemoveFile(const char* file)
 #endif
 }
 
+bool RenameFile(const char* from, const char* to)
+{
+#ifndef _WIN32
+	return rename(from, to) == 0;
+#else
+	auto wfrom = WideString(from);
+	auto wto = WideString(to);
+	return _wrename(wfrom.c_str(), wto.c_str()) == 0;
+#endif
+}
+
 int RemoveDir(const char* file)
 {
 #ifndef _WIN32
@@ -33,6 +33,7 @@
 */
 
 #include <string.h>
+#include <thread>
 #include "name.h"
 #include "superfasthash.h"
 #include "cmdlib.h"
@@ -45,7 +46,8 @@
 // that is just large enough to hold it.
 #define BLOCK_SIZE			4096
 
-// How many entries to grow the NameArray by when it needs to grow.
+// How many entries the first NameArray allocation gets on top of the
+// predefined names. After that the array doubles in size when it fills up.
 #define NAME_GROW_AMOUNT	256
 
 // TYPES -------------------------------------------------------------------
@@ -60,6 +62,46 @@ struct FName::NameManager::NameBlock
 	NameBlock *NextBlock;
 };
 
+// Open addressing hash table with linear probing. A slot holds the name's
+// index + 1 so that a cleared table is empty. The table is never more than
+// half full, so a probe sequence always ends at an empty slot.
+
+struct FName::NameManager::HashTable
+{
+	unsigned int Mask;
+	std::atomic<int> Slots[1];
+};
+
+// Name arrays and hash tables that have been replaced by larger ones.
+
+struct FName::NameManager::Retired
+{
+	Retired *Next;
+	void *Memory;
+};
+
+// The lock only serializes writers, so it is just a spinlock that can live
+// in the BSS section without needing a constructor.
+
+class FNameLockGuard
+{
+	std::atomic<bool> &Lock;
+
+public:
+	FNameLockGuard(std::atomic<bool> &lock) : Lock(lock)
+	{
+		while (Lock.exchange(true, std::memory_order_acquire))
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	~FNameLockGuard()
+	{
+		Lock.store(false, std::memory_order_release);
+	}
+};
+
 // PRIVATE FUNCTION PROTOTYPES ---------------------------------------------
 
 // PUBLIC DATA DEFINITIONS -------------------------------------------------
@@ -67,7 +109,6 @@ struct FName::NameManager::NameBlock
 // PRIVATE DATA DEFINITIONS ------------------------------------------------
 
 FName::NameManager FName::NameData;
-bool FName::NameManager::Inited;
 
 // Define the predefined names.
 static const char *PredefinedNames[] =
@@ -96,37 +137,11 @@ static const char *PredefinedNames[] =
 
 int FName::NameManager::FindName (const char *text, bool noCreate)
 {
-	if (!Inited)
-	{
-		InitBuckets ();
-	}
-
 	if (text == NULL)
 	{
 		return 0;
 	}
-
-	unsigned int hash = MakeKey (text);
-	unsigned int bucket = hash % HASH_SIZE;
-	int scanner = Buckets[bucket];
-
-	// See if the name already exists.
-	while (scanner >= 0)
-	{
-		if (NameArray[scanner].Hash == hash && stricmp (NameArray[scanner].Text, text) == 0)
-		{
-			return scanner;
-		}
-		scanner = NameArray[scanner].NextHash;
-	}
-
-	// If we get here, then the name does not exist.
-	if (noCreate)
-	{
-		return 0;
-	}
-
-	return AddName (text, hash, bucket);
+	return FindName (text, strlen (text), noCreate);
 }
 
 //==========================================================================
@@ -138,7 +153,7 @@ int FName::NameManager::FindName (const char *text, bool noCreate)
 
 int FName::NameManager::FindName (const char *text, size_t textLen, bool noCreate)
 {
-	if (!Inited)
+	if (!Inited.load(std::memory_order_acquire))
 	{
 		InitBuckets ();
 	}
@@ -149,19 +164,11 @@ int FName::NameManager::FindName (const char *text, size_t textLen, bool noCreat
 	}
 
 	unsigned int hash = MakeKey (text, textLen);
-	unsigned int bucket = hash % HASH_SIZE;
-	int scanner = Buckets[bucket];
+	int index = Lookup (text, textLen, hash);
 
-	// See if the name already exists.
-	while (scanner >= 0)
+	if (index >= 0)
 	{
-		if (NameArray[scanner].Hash == hash &&
-			strnicmp (NameArray[scanner].Text, text, textLen) == 0 &&
-			NameArray[scanner].Text[textLen] == '\0')
-		{
-			return scanner;
-		}
-		scanner = NameArray[scanner].NextHash;
+		return index;
 	}
 
 	// If we get here, then the name does not exist.
@@ -170,7 +177,40 @@ int FName::NameManager::FindName (const char *text, size_t textLen, bool noCreat
 		return 0;
 	}
 
-	return AddName (text, hash, bucket);
+	return AddName (text, textLen, hash);
+}
+
+//==========================================================================
+//
+// FName :: NameManager :: Lookup
+//
+// Lock-free search of the hash table. Returns -1 if the name is not in
+// the table.
+//
+//==========================================================================
+
+int FName::NameManager::Lookup (const char *text, size_t textLen, unsigned int hash)
+{
+	HashTable *table = Buckets.load(std::memory_order_acquire);
+
+	for (unsigned int slot = hash & table->Mask; ; slot = (slot + 1) & table->Mask)
+	{
+		int scanner = table->Slots[slot].load(std::memory_order_acquire) - 1;
+		if (scanner < 0)
+		{
+			return -1;
+		}
+
+		// The name array must be fetched after the slot because the slot
+		// may refer to a name that was added after a previous fetch.
+		NameEntry &entry = NameArray.load(std::memory_order_acquire)[scanner];
+		if (entry.Hash == hash &&
+			strnicmp (entry.Text, text, textLen) == 0 &&
+			entry.Text[textLen] == '\0')
+		{
+			return scanner;
+		}
+	}
 }
 
 //==========================================================================
@@ -183,30 +223,61 @@ int FName::NameManager::FindName (const char *text, size_t textLen, bool noCreat
 
 void FName::NameManager::InitBuckets ()
 {
-	Inited = true;
-	memset (Buckets, -1, sizeof(Buckets));
+	FNameLockGuard lock(Lock);
+
+	if (Inited.load(std::memory_order_relaxed))
+	{
+		return;
+	}
+
+	GrowHashTable ();
 
 	// Register built-in names. 'None' must be name 0.
 	for (size_t i = 0; i < countof(PredefinedNames); ++i)
 	{
-		assert((0 == FindName(PredefinedNames[i], true)) && "Predefined name already inserted");
-		FindName (PredefinedNames[i], false);
+		size_t len = strlen (PredefinedNames[i]);
+		unsigned int hash = MakeKey (PredefinedNames[i], len);
+		assert((Lookup(PredefinedNames[i], len, hash) < 0) && "Predefined name already inserted");
+		InsertName (PredefinedNames[i], len, hash);
 	}
+
+	Inited.store(true, std::memory_order_release);
 }
 
 //==========================================================================
 //
 // FName :: NameManager :: AddName
 //
-// Adds a new name to the name table.
+// Adds a new name to the name table, unless another thread was faster.
 //
 //==========================================================================
 
-int FName::NameManager::AddName (const char *text, unsigned int hash, unsigned int bucket)
+int FName::NameManager::AddName (const char *text, size_t textLen, unsigned int hash)
+{
+	FNameLockGuard lock(Lock);
+
+	int index = Lookup (text, textLen, hash);
+	if (index >= 0)
+	{
+		return index;
+	}
+	return InsertName (text, textLen, hash);
+}
+
+//==========================================================================
+//
+// FName :: NameManager :: InsertName
+//
+// Must be called with the lock held. Everything a reader can reach through
+// the new hash slot is written before the slot itself is published.
+//
+//==========================================================================
+
+int FName::NameManager::InsertName (const char *text, size_t textLen, unsigned int hash)
 {
 	char *textstore;
 	NameBlock *block = Blocks;
-	size_t len = strlen (text) + 1;
+	size_t len = textLen + 1;
 
 	// Get a block large enough for the name. Only the first block in the
 	// list is ever considered for name storage.
@@ -217,25 +288,122 @@ int FName::NameManager::AddName (const char *text, unsigned int hash, unsigned i
 
 	// Copy the string into the block.
 	textstore = (char *)block + block->NextAlloc;
-	strcpy (textstore, text);
+	memcpy (textstore, text, textLen);
+	textstore[textLen] = '\0';
 	block->NextAlloc += len;
 
 	// Add an entry for the name to the NameArray
-	if (NumNames >= MaxNames)
+	int index = NumNames.load(std::memory_order_relaxed);
+	if (index >= MaxNames)
+	{
+		GrowNameArray ();
+	}
+
+	NameEntry &entry = NameArray.load(std::memory_order_relaxed)[index];
+	entry.Text = textstore;
+	entry.Hash = hash;
+
+	// The table must grow before the new name is counted, or the rehash
+	// would already insert it and the probe below would add it a second time.
+	HashTable *table = Buckets.load(std::memory_order_relaxed);
+	if ((unsigned int)(index + 1) * 2 > table->Mask + 1)
+	{
+		GrowHashTable ();
+		table = Buckets.load(std::memory_order_relaxed);
+	}
+	NumNames.store(index + 1, std::memory_order_release);
+
+	unsigned int slot = hash & table->Mask;
+	while (table->Slots[slot].load(std::memory_order_relaxed) != 0)
+	{
+		slot = (slot + 1) & table->Mask;
+	}
+	table->Slots[slot].store(index + 1, std::memory_order_release);
+
+	return index;
+}
+
+//==========================================================================
+//
+// FName :: NameManager :: GrowNameArray
+//
+//==========================================================================
+
+void FName::NameManager::GrowNameArray ()
+{
+	// If no names have been defined yet, make the first allocation
+	// large enough to hold all the predefined names.
+	int newMax = MaxNames == 0 ? int(countof(PredefinedNames) + NAME_GROW_AMOUNT) : MaxNames * 2;
+	NameEntry *oldArray = NameArray.load(std::memory_order_relaxed);
+	NameEntry *newArray = (NameEntry *)M_Malloc (newMax * sizeof(NameEntry));
+
+	if (oldArray != NULL)
+	{
+		memcpy (newArray, oldArray, MaxNames * sizeof(NameEntry));
+	}
+	NameArray.store(newArray, std::memory_order_release);
+	MaxNames = newMax;
+	if (oldArray != NULL)
+	{
+		Retire (oldArray);
+	}
+}
+
+//==========================================================================
+//
+// FName :: NameManager :: GrowHashTable
+//
+// Creates a hash table twice the size of the current one (or the minimum
+// size if there is none yet) and rehashes all names into it.
+//
+//==========================================================================
+
+void FName::NameManager::GrowHashTable ()
+{
+	HashTable *oldTable = Buckets.load(std::memory_order_relaxed);
+	unsigned int size = oldTable == NULL ? MIN_HASH_SIZE : (oldTable->Mask + 1) * 2;
+	HashTable *newTable = (HashTable *)M_Malloc (sizeof(HashTable) + (size - 1) * sizeof(std::atomic<int>));
+
+	newTable->Mask = size - 1;
+	for (unsigned int i = 0; i < size; i++)
+	{
+		new (&newTable->Slots[i]) std::atomic<int>(0);
+	}
+
+	NameEntry *names = NameArray.load(std::memory_order_relaxed);
+	int count = NumNames.load(std::memory_order_relaxed);
+	for (int i = 0; i < count; i++)
 	{
-		// If no names have been defined yet, make the first allocation
-		// large enough to hold all the predefined names.
-		MaxNames += MaxNames == 0 ? countof(PredefinedNames) + NAME_GROW_AMOUNT : NAME_GROW_AMOUNT;
+		unsigned int slot = names[i].Hash & newTable->Mask;
+		while (newTable->Slots[slot].load(std::memory_order_relaxed) != 0)
+		{
+			slot = (slot + 1) & newTable->Mask;
+		}
+		newTable->Slots[slot].store(i + 1, std::memory_order_relaxed);
+	}
 
-		NameArray = (NameEntry *)M_Realloc (NameArray, MaxNames * sizeof(NameEntry));
+	Buckets.store(newTable, std::memory_order_release);
+	if (oldTable != NULL)
+	{
+		Retire (oldTable);
 	}
+}
 
-	NameArray[NumNames].Text = textstore;
-	NameArray[NumNames].Hash = hash;
-	NameArray[NumNames].NextHash = Buckets[bucket];
-	Buckets[bucket] = NumNames;
+//==========================================================================
+//
+// FName :: NameManager :: Retire
+//
+// Keeps replaced memory alive until shutdown because lock-free readers
+// may still be looking at it.
+//
+//==========================================================================
 
-	return NumNames++;
+void FName::NameManager::Retire (void *memory)
+{
+	Retired *node = (Retired *)M_Malloc (sizeof(Retired));
+	node->Memory = memory;
+	node->Next = RetiredBlocks;
+	RetiredBlocks = node;
 }
 
 //==========================================================================
@@ -284,11 +452,25 @@ FName::NameManager::~NameManager()
 	}
 	Blocks = NULL;
 
-	if (NameArray != NULL)
+	Retired *retired, *nextRetired;
+	for (retired = RetiredBlocks; retired != NULL; retired = nextRetired)
+	{
+		nextRetired = retired->Next;
+		M_Free (retired->Memory);
+		M_Free (retired);
+	}
+	RetiredBlocks = NULL;
+
+	if (NameArray.load() != NULL)
 	{
-		M_Free (NameArray);
+		M_Free (NameArray.load());
 		NameArray = NULL;
 	}
+	if (Buckets.load() != NULL)
+	{
+		M_Free (Buckets.load());
+		Buckets = NULL;
+	}
 	NumNames = MaxNames = 0;
-	memset (Buckets, -1, sizeof(Buckets));
+	Inited = false;
 }
@@ -34,6 +34,7 @@
 #ifndef NAME_H
 #define NAME_H
 
+#include <atomic>
 #include "tarray.h"
 #include "zstring.h"
 
@@ -65,7 +66,7 @@ public:
  //   ~FName () {}	// Names can be added but never removed.
 
 	int GetIndex() const { return Index; }
-	const char *GetChars() const { return NameData.NameArray[Index].Text; }
+	const char *GetChars() const { return NameData.NameArray.load(std::memory_order_acquire)[Index].Text; }
 
 	FName &operator = (const char *text) { Index = NameData.FindName (text, false); return *this; }
 	FName& operator = (const FString& text) { Index = NameData.FindName(text.GetChars(), text.Len(), false); return *this; }
@@ -74,7 +75,7 @@ public:
 
 	int SetName (const char *text, bool noCreate=false) { return Index = NameData.FindName (text, noCreate); }
 
-	bool IsValidName() const { return (unsigned)Index < (unsigned)NameData.NumNames; }
+	bool IsValidName() const { return (unsigned)Index < (unsigned)NameData.NumNames.load(std::memory_order_acquire); }
 
 	// Note that the comparison operators compare the names' indices, not
 	// their text, so they cannot be used to do a lexicographical sort.
@@ -99,9 +100,13 @@ protected:
 	{
 		char *Text;
 		unsigned int Hash;
-		int NextHash;
 	};
 
+	// Lookups never lock. Names are added under a lock, and both the name
+	// array and the hash table are replaced instead of modified in place when
+	// they need to grow, so a reader always sees a consistent state. Replaced
+	// arrays are kept around until shutdown because a reader on another thread
+	// may still be using them.
 	struct NameManager
 	{
 		// No constructor because we can't ensure that it actually gets
@@ -109,20 +114,30 @@ protected:
 		// means this struct must only exist in the program's BSS section.
 		~NameManager();
 
-		enum { HASH_SIZE = 1024 };
+		enum { MIN_HASH_SIZE = 4096 };
 		struct NameBlock;
+		struct HashTable;
+		struct Retired;
 
 		NameBlock *Blocks;
-		NameEntry *NameArray;
-		int NumNames, MaxNames;
-		int Buckets[HASH_SIZE];
+		std::atomic<NameEntry *> NameArray;
+		std::atomic<HashTable *> Buckets;
+		std::atomic<int> NumNames;
+		int MaxNames;
+		Retired *RetiredBlocks;
+		std::atomic<bool> Lock;
+		std::atomic<bool> Inited;
 
 		int FindName (const char *text, bool noCreate);
 		int FindName (const char *text, size_t textlen, bool noCreate);
-		int AddName (const char *text, unsigned int hash, unsigned int bucket);
+		int Lookup (const char *text, size_t textlen, unsigned int hash);
+		int AddName (const char *text, size_t textlen, unsigned int hash);
+		int InsertName (const char *text, size_t textlen, unsigned int hash);
+		void GrowNameArray ();
+		void GrowHashTable ();
+		void Retire (void *memory);
 		NameBlock *AddBlock (size_t len);
 		void InitBuckets ();
-		static bool Inited;
 	};
 
 	static NameManager NameData;
@@ -24,41 +24,45 @@
 
 #include "r_memory.h"
 #include <stdlib.h>
+#include <algorithm>
 
 void *RenderMemory::AllocBytes(int size)
 {
-	size = (size + 15) / 16 * 16; // 16-byte align
+	size_t alignedsize = (size_t(size) + 15) / 16 * 16; // 16-byte align
 
-	if (UsedBlocks.empty() || UsedBlocks.back()->Position + size > BlockSize)
+	if (Blocks.empty())
 	{
-		if (!FreeBlocks.empty())
-		{
-			auto block = std::move(FreeBlocks.back());
-			block->Position = 0;
-			FreeBlocks.pop_back();
-			UsedBlocks.push_back(std::move(block));
-		}
-		else
+		Blocks.push_back(std::unique_ptr<MemoryBlock>(new MemoryBlock(std::max<size_t>(BlockSize, alignedsize))));
+		Reserved += Blocks.back()->Size;
+	}
+
+	// Move on to the next block until one fits. Allocations larger than a block get a block of their own.
+	while (Blocks[Current]->Position + alignedsize > Blocks[Current]->Size)
+	{
+		Current++;
+		if (Current == Blocks.size())
 		{
-			UsedBlocks.push_back(std::unique_ptr<MemoryBlock>(new MemoryBlock()));
+			Blocks.push_back(std::unique_ptr<MemoryBlock>(new MemoryBlock(std::max<size_t>(BlockSize, alignedsize))));
+			Reserved += Blocks.back()->Size;
 		}
+		Blocks[Current]->Position = 0;
 	}
 
-	auto &block = UsedBlocks.back();
+	auto &block = Blocks[Current];
 	void *data = block->Data + block->Position;
-	block->Position += size;
+	block->Position += alignedsize;
+	Used += alignedsize;
 
 	return data;
 }
 
 void RenderMemory::Clear()
 {
-	while (!UsedBlocks.empty())
-	{
-		auto block = std::move(UsedBlocks.back());
-		UsedBlocks.pop_back();
-		FreeBlocks.push_back(std::move(block));
-	}
+	Peak = PeakBytes();
+	Used = 0;
+	Current = 0;
+	if (!Blocks.empty())
+		Blocks[0]->Position = 0;
 }
 
 static void* Aligned_Alloc(size_t alignment, size_t size)
@@ -91,7 +95,7 @@ static void Aligned_Free(void* ptr)
 	}
 }
 
-RenderMemory::MemoryBlock::MemoryBlock() : Data(static_cast<uint8_t*>(Aligned_Alloc(16, BlockSize))), Position(0)
+RenderMemory::MemoryBlock::MemoryBlock(size_t size) : Data(static_cast<uint8_t*>(Aligned_Alloc(16, size))), Size(size), Position(0)
 {
 }
 
@@ -7,6 +7,7 @@
 class RenderMemory
 {
 public:
+	// Makes all memory available again. The blocks are kept, so once a few frames have been rendered nothing gets allocated from the heap anymore.
 	void Clear();
 
 	template<typename T>
@@ -22,6 +23,16 @@ public:
 		return new (ptr)T(std::forward<Types>(args)...);
 	}
 
+	// Bytes handed out since the last Clear
+	size_t UsedBytes() const { return Used; }
+
+	// The most bytes that were in use at the same time
+	size_t PeakBytes() const { return Used > Peak ? Used : Peak; }
+
+	// Total size of the blocks
+	size_t ReservedBytes() const { return Reserved; }
+	int BlockCount() const { return (int)Blocks.size(); }
+
 private:
 	void *AllocBytes(int size);
 
@@ -29,15 +40,19 @@ private:
 
 	struct MemoryBlock
 	{
-		MemoryBlock();
+		MemoryBlock(size_t size);
 		~MemoryBlock();
 
 		MemoryBlock(const MemoryBlock &) = delete;
 		MemoryBlock &operator=(const MemoryBlock &) = delete;
 
 		uint8_t *Data;
-		uint32_t Position;
+		size_t Size;
+		size_t Position;
 	};
-	std::vector<std::unique_ptr<MemoryBlock>> UsedBlocks;
-	std::vector<std::unique_ptr<MemoryBlock>> FreeBlocks;
+	std::vector<std::unique_ptr<MemoryBlock>> Blocks;
+	size_t Current = 0;	// blocks after this one are unused
+	size_t Used = 0;
+	size_t Peak = 0;
+	size_t Reserved = 0;
 };
@@ -0,0 +1,118 @@
+/*
+** radixsort.h
+** Stable radix sort for per-frame draw lists
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 GZDoom Maintainers and Contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+** Sorting thousands of sprites by distance with a comparison sort every
+** frame is needlessly expensive. The keys used by the renderers are plain
+** floats plus an optional tie breaker, so they get turned into unsigned
+** integers that sort the same way and are ordered with a least significant
+** digit radix sort. Passes in which all keys share the same byte are
+** skipped, so the high half of a 64 bit key costs next to nothing if the
+** tie breakers are small.
+**
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <utility>
+
+template<class Key, class Value>
+struct FRadixSortItem
+{
+	Key SortKey;
+	Value Item;
+};
+
+// Maps a float onto an unsigned integer which sorts in the same order. -0 and +0 map to the same key.
+inline uint32_t RadixFloatKey(float f)
+{
+	uint32_t bits;
+	memcpy(&bits, &f, sizeof(bits));
+	if (bits == 0x80000000u) bits = 0;
+	return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+}
+
+// Sorts count items ascending by key without changing the order of items with equal keys.
+// temp must have room for count items as well. The result always ends up in items.
+template<class Key, class Value>
+void RadixSort(FRadixSortItem<Key, Value> *items, FRadixSortItem<Key, Value> *temp, size_t count)
+{
+	enum { NumPasses = sizeof(Key) };
+
+	if (count < 64)
+	{
+		// Not worth the histograms.
+		for (size_t i = 1; i < count; i++)
+		{
+			auto item = items[i];
+			size_t j = i;
+			for (; j > 0 && item.SortKey < items[j - 1].SortKey; j--)
+				items[j] = items[j - 1];
+			items[j] = item;
+		}
+		return;
+	}
+
+	size_t histogram[NumPasses][256];
+	memset(histogram, 0, sizeof(histogram));
+	for (size_t i = 0; i < count; i++)
+	{
+		Key key = items[i].SortKey;
+		for (int pass = 0; pass < NumPasses; pass++)
+			histogram[pass][(key >> (pass * 8)) & 0xff]++;
+	}
+
+	auto src = items;
+	auto dst = temp;
+	for (int pass = 0; pass < NumPasses; pass++)
+	{
+		size_t *counts = histogram[pass];
+		int shift = pass * 8;
+		if (counts[(src[0].SortKey >> shift) & 0xff] == count)
+			continue;
+
+		size_t offset = 0;
+		for (int i = 0; i < 256; i++)
+		{
+			size_t c = counts[i];
+			counts[i] = offset;
+			offset += c;
+		}
+		for (size_t i = 0; i < count; i++)
+			dst[counts[(src[i].SortKey >> shift) & 0xff]++] = src[i];
+		std::swap(src, dst);
+	}
+
+	if (src != items)
+		memcpy(items, src, count * sizeof(*items));
+}
@@ -63,6 +63,13 @@ FString DumpCPUInfo(const CPUInfo *cpu, bool brief)
 	: "=a" ((output)[0]), "=b" ((output)[1]), "=c" ((output)[2]), "=d" ((output)[3]) \
 	: "a" (func), "c" (subfunc));
 #define __cpuid(output, func) __cpuidex(output, func, 0)
+#define _xgetbv(index) xgetbv(index)
+static inline uint64_t xgetbv(unsigned int index)
+{
+	uint32_t eax, edx;
+	__asm__ __volatile__("xgetbv" : "=a" (eax), "=d" (edx) : "c" (index));
+	return ((uint64_t)edx << 32) | eax;
+}
 #endif
 
 void CheckCPUID(CPUInfo *cpu)
@@ -159,6 +166,17 @@ void CheckCPUID(CPUInfo *cpu)
 		__cpuidex(foo, 7, 1);
 		cpu->FeatureFlags[7] = foo[0];
 	}
+
+	// The AVX registers can only be used if the OS saves them on context switches.
+	uint64_t xcr0 = cpu->bOSXSAVE ? _xgetbv(0) : 0;
+	if ((xcr0 & 6) != 6)
+	{
+		cpu->bAVX = cpu->bAVX2 = cpu->bFMA3 = cpu->bF16C = 0;
+	}
+	if ((xcr0 & 0xe6) != 0xe6)
+	{
+		cpu->bAVX512_F = cpu->bAVX512_DQ = cpu->bAVX512_IFMA = cpu->bAVX512_PF = cpu->bAVX512_ER = cpu->bAVX512_CD = cpu->bAVX512_BW = cpu->bAVX512_VL = 0;
+	}
 }
 
 FString DumpCPUInfo(const CPUInfo *cpu, bool brief)
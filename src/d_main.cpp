@@ -106,6 +106,7 @@
 #include "c_buttons.h"
 #include "d_buttons.h"
 #include "i_interface.h"
+#include "taskgraph.h"
 #include "animations.h"
 #include "texturemanager.h"
 #include "formats/multipatchtexture.h"
@@ -118,6 +119,8 @@
 #include "screenjob.h"
 #include "startscreen.h"
 #include "shiftstate.h"
+#include "workerpool.h"
+#include "upscalecache.h"
 
 #ifdef __unix__
 #include "i_system.h"  // for SHARE_DIR
@@ -908,6 +911,7 @@ void D_Display ()
 	
 	if (!AppActive && (screen->IsFullscreen() || !vid_activeinbackground))
 	{
+		SkipSWDrawerFrame();
 		return;
 	}
 
@@ -939,6 +943,7 @@ void D_Display ()
 	if (setmodeneeded)
 	{
 		setmodeneeded = false;
+		SkipSWDrawerFrame();
 		screen->ToggleFullscreen(vid_fullscreen);
 		V_OutputResized(screen->GetWidth(), screen->GetHeight());
 	}
@@ -1063,6 +1068,7 @@ void D_Display ()
 	}
 	else
 	{
+		SkipSWDrawerFrame();
 		twod->Begin(screen->GetWidth(), screen->GetHeight());
 		switch (gamestate)
 		{
@@ -1188,6 +1194,44 @@ void D_ErrorCleanup ()
 	ClearGlobalVMStack();
 }
 
+//==========================================================================
+//
+// CCMD viewbench
+//
+// Renders the current view a number of times without running the game
+// in between, so that every frame shows exactly the same scene. Mostly
+// useful with the null backend to measure the renderer's CPU cost.
+//
+//==========================================================================
+
+CCMD(viewbench)
+{
+	if (gamestate != GS_LEVEL)
+	{
+		Printf("viewbench can only be used in a level\n");
+		return;
+	}
+	int frames = argv.argc() > 1 ? max(1, (int)strtol(argv[1], nullptr, 10)) : 100;
+
+	uint64_t start = I_nsTime();
+	for (int i = 0; i < frames; i++)
+	{
+		screen->FrameTime = I_msTimeFS();
+		screen->BeginFrame();
+		twod->ClearClipRect();
+		D_Render([&]()
+		{
+			RenderView(&players[consoleplayer]);
+		}, false);
+		twod->Begin(screen->GetWidth(), screen->GetHeight());
+		twod->End();
+		screen->Update();
+		twod->OnFrameDone();
+	}
+	double elapsed = (I_nsTime() - start) / 1e6;
+	Printf("%d frames in %.2f ms, %.3f ms per frame\n", frames, elapsed, elapsed / frames);
+}
+
 //==========================================================================
 //
 // D_DoomLoop
@@ -3318,51 +3362,95 @@ static int D_InitGame(const FIWADInfo* iwad_info, std::vector<std::string>& allw
 
 	CheckCmdLine();
 
+	// The sound and map definitions do not depend on the texture manager, so with -parallelstartup
+	// they get parsed on a worker thread while the textures are being set up on the main thread.
+	// Everything touching the startup screen has to stay on the main thread.
+	FTaskGraph startupTasks;
+
 	// [RH] Load sound environments
-	S_ParseReverbDef ();
+	int reverbTask = startupTasks.AddTask("S_ParseReverbDef", []()
+	{
+		S_ParseReverbDef ();
+	});
 
 	// [RH] Parse any SNDINFO lumps
-	if (!batchrun) Printf ("S_InitData: Load sound definitions.\n");
-	S_InitData ();
+	int sndinfoTask = startupTasks.AddTask("S_InitData", []()
+	{
+		if (!batchrun) Printf ("S_InitData: Load sound definitions.\n");
+		S_InitData ();
+	}, { reverbTask });
 
 	// [RH] Parse through all loaded mapinfo lumps
-	if (!batchrun) Printf ("G_ParseMapInfo: Load map definitions.\n");
-	G_ParseMapInfo (iwad_info->MapInfo);
-	MessageBoxClass = gameinfo.MessageBoxClass;
-	endoomName = gameinfo.Endoom;
-	menuBlurAmount = gameinfo.bluramount;
-	ReadStatistics();
+	// MAPINFO references sounds so it must wait for SNDINFO.
+	int mapinfoTask = startupTasks.AddTask("G_ParseMapInfo", [=]()
+	{
+		if (!batchrun) Printf ("G_ParseMapInfo: Load map definitions.\n");
+		G_ParseMapInfo (iwad_info->MapInfo);
+		MessageBoxClass = gameinfo.MessageBoxClass;
+		endoomName = gameinfo.Endoom;
+		menuBlurAmount = gameinfo.bluramount;
+		ReadStatistics();
+	}, { sndinfoTask });
 
 	// MUSINFO must be parsed after MAPINFO
-	S_ParseMusInfo();
+	int musinfoTask = startupTasks.AddTask("S_ParseMusInfo", []()
+	{
+		S_ParseMusInfo();
+	}, { mapinfoTask });
+
+	int texturesTask = startupTasks.AddTask("TexMan.AddTextures", []()
+	{
+		if (!batchrun) Printf ("Texman.Init: Init texture manager.\n");
+		UpdateUpscaleMask();
+		SpriteFrames.Clear();
+		TexMan.AddTextures([]() 
+		{ 
+			StartWindow->Progress(); 
+			if (StartScreen) StartScreen->Progress(1); 
+		}, CheckForHacks, InitBuildTiles);
+		PatchTextures();
+	}, {}, FTaskGraph::TF_MainThread);
+
+	// ANIMDEFS can assign sounds to animated doors.
+	int animdefsTask = startupTasks.AddTask("TexAnim.Init", []()
+	{
+		TexAnim.Init();
+	}, { texturesTask, sndinfoTask }, FTaskGraph::TF_MainThread);
+
+	int conbackTask = startupTasks.AddTask("C_InitConback", []()
+	{
+		C_InitConback(TexMan.CheckForTexture(gameinfo.BorderFlat.GetChars(), ETextureType::Flat), true, 0.25);
+	}, { texturesTask, mapinfoTask }, FTaskGraph::TF_MainThread);
+
+	int fontsTask = startupTasks.AddTask("V_InitFonts", []()
+	{
+		FixWideStatusBar();
 
-	if (!batchrun) Printf ("Texman.Init: Init texture manager.\n");
-	UpdateUpscaleMask();
-	SpriteFrames.Clear();
-	TexMan.AddTextures([]() 
-	{ 
 		StartWindow->Progress(); 
-		if (StartScreen) StartScreen->Progress(1); 
-	}, CheckForHacks, InitBuildTiles);
-	PatchTextures();
-	TexAnim.Init();
-	C_InitConback(TexMan.CheckForTexture(gameinfo.BorderFlat.GetChars(), ETextureType::Flat), true, 0.25);
+		if (StartScreen) StartScreen->Progress(1);
+		V_InitFonts();
+		InitDoomFonts();
+		V_LoadTranslations();
+		UpdateGenericUI(false);
 
-	FixWideStatusBar();
+		// [CW] Parse any TEAMINFO lumps.
+		if (!batchrun) Printf ("ParseTeamInfo: Load team definitions.\n");
+		FTeam::ParseTeamInfo ();
 
-	StartWindow->Progress(); 
-	if (StartScreen) StartScreen->Progress(1);
-	V_InitFonts();
-	InitDoomFonts();
-	V_LoadTranslations();
-	UpdateGenericUI(false);
+		R_ParseTrnslate();
+	}, { texturesTask, mapinfoTask, conbackTask }, FTaskGraph::TF_MainThread);
+
+	// ZScript and DECORATE are compiled here. The compiler resolves sounds, textures, fonts and
+	// translations and fills the global type and symbol tables, so it depends on every phase above
+	// and cannot overlap with anything. It is part of the graph for the timings.
+	startupTasks.AddTask("PClassActor::StaticInit", []()
+	{
+		PClassActor::StaticInit ();
+	}, { fontsTask, musinfoTask, animdefsTask }, FTaskGraph::TF_MainThread);
 
-	// [CW] Parse any TEAMINFO lumps.
-	if (!batchrun) Printf ("ParseTeamInfo: Load team definitions.\n");
-	FTeam::ParseTeamInfo ();
+	startupTasks.Run(Args->CheckParm("-parallelstartup") ? 1 : 0);
+	if (Args->CheckParm("-stdout")) startupTasks.PrintTimings();
 
-	R_ParseTrnslate();
-	PClassActor::StaticInit ();
 	FBaseCVar::InitZSCallbacks ();
 	
 	Job_Init();
@@ -3831,6 +3919,9 @@ int GameMain()
 	}
 	// Unless something really bad happened, the game should only exit through this single point in the code.
 	// No more 'exit', please.
+	// Background jobs, e.g. asynchronous upscaling, use other subsystems and must be finished before those go away.
+	WorkerPool.Shutdown();
+	UpscaleCache.Flush();
 	D_Cleanup();
 	CloseNetwork();
 	GC::FinalGC = true;
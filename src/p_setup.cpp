@@ -78,6 +78,7 @@
 #include "s_music.h"
 #include "animations.h"
 #include "texturemanager.h"
+#include "upscalecache.h"
 #include "p_lnspec.h"
 #include "d_main.h"
 
@@ -571,6 +572,7 @@ void P_SetupLevel(FLevelLocals *Level, int position, bool newGame)
 		PrecacheLevel(Level);
 		S_PrecacheLevel(Level);
 	}
+	UpscaleCache.ApplyBudget();
 
 	if (deathmatch)
 	{
@@ -24,10 +24,12 @@
 
 #include "doom_aabbtree.h"
 #include "g_levellocals.h"
+#include "c_dispatch.h"
+#include "stats.h"
 
 using namespace hwrenderer;
 
-DoomLevelAABBTree::DoomLevelAABBTree(FLevelLocals *lev)
+DoomLevelAABBTree::DoomLevelAABBTree(FLevelLocals *lev, EBuildMode mode)
 {
 	Level = lev;
 	// Calculate the center of all lines
@@ -40,7 +42,7 @@ DoomLevelAABBTree::DoomLevelAABBTree(FLevelLocals *lev)
 	}
 
 	// Create the static subtree
-	if (!GenerateTree(&centroids[0], false))
+	if (!GenerateTree(&centroids[0], false, mode))
 		return;
 
 	int staticroot = nodes.Size() - 1;
@@ -49,7 +51,7 @@ DoomLevelAABBTree::DoomLevelAABBTree(FLevelLocals *lev)
 	dynamicStartLine = treelines.Size();
 
 	// Create the dynamic subtree
-	if (GenerateTree(&centroids[0], true))
+	if (GenerateTree(&centroids[0], true, mode))
 	{
 		int dynamicroot = nodes.Size() - 1;
 
@@ -76,9 +78,11 @@ DoomLevelAABBTree::DoomLevelAABBTree(FLevelLocals *lev)
 		treeline.dx = (float)line.v2->fX() - treeline.x;
 		treeline.dy = (float)line.v2->fY() - treeline.y;
 	}
+
+	InitRefit();
 }
 
-bool DoomLevelAABBTree::GenerateTree(const FVector2 *centroids, bool dynamicsubtree)
+bool DoomLevelAABBTree::GenerateTree(const FVector2 *centroids, bool dynamicsubtree, EBuildMode mode)
 {
 	// Create a list of level lines we want to add:
 	TArray<int> line_elements;
@@ -104,6 +108,28 @@ bool DoomLevelAABBTree::GenerateTree(const FVector2 *centroids, bool dynamicsubt
 	if (line_elements.Size() == 0)
 		return false;
 
+	if (mode != BUILD_MEDIAN)
+	{
+		TArray<AABBTreeBuildLine> buildlines;
+		buildlines.Resize(line_elements.Size());
+		for (unsigned int i = 0; i < line_elements.Size(); i++)
+		{
+			const auto &line = maplines[mapLines[line_elements[i]]];
+			float x1 = (float)line.v1->fX();
+			float y1 = (float)line.v1->fY();
+			float x2 = (float)line.v2->fX();
+			float y2 = (float)line.v2->fY();
+
+			auto &buildline = buildlines[i];
+			buildline.aabb_min = { min(x1, x2), min(y1, y2) };
+			buildline.aabb_max = { max(x1, x2), max(y1, y2) };
+			buildline.center = centroids[mapLines[line_elements[i]]];
+			buildline.line_index = line_elements[i];
+		}
+		GenerateSAHTree(&buildlines[0], (int)buildlines.Size(), mode == BUILD_SAH_PARALLEL);
+		return true;
+	}
+
 	// GenerateTreeNode needs a buffer where it can store line indices temporarily when sorting lines into the left and right child AABB buckets
 	TArray<int> work_buffer;
 	work_buffer.Resize(line_elements.Size() * 2);
@@ -115,7 +141,7 @@ bool DoomLevelAABBTree::GenerateTree(const FVector2 *centroids, bool dynamicsubt
 
 bool DoomLevelAABBTree::Update()
 {
-	bool modified = false;
+	BeginRefit();
 	for (unsigned int i = dynamicStartLine; i < mapLines.Size(); i++)
 	{
 		const auto &line = Level->lines[mapLines[i]];
@@ -128,37 +154,10 @@ bool DoomLevelAABBTree::Update()
 
 		if (memcmp(&treelines[i], &treeline, sizeof(AABBTreeLine)))
 		{
-			TArray<int> path = FindNodePath(i, nodes.Size() - 1);
-			if (path.Size())
-			{
-				float x1 = (float)line.v1->fX();
-				float y1 = (float)line.v1->fY();
-				float x2 = (float)line.v2->fX();
-				float y2 = (float)line.v2->fY();
-
-				int nodeIndex = path[0];
-				nodes[nodeIndex].aabb_left = min(x1, x2);
-				nodes[nodeIndex].aabb_right = max(x1, x2);
-				nodes[nodeIndex].aabb_top = min(y1, y2);
-				nodes[nodeIndex].aabb_bottom = max(y1, y2);
-
-				for (unsigned int j = 1; j < path.Size(); j++)
-				{
-					auto &cur = nodes[path[j]];
-					const auto &left = nodes[cur.left_node];
-					const auto &right = nodes[cur.right_node];
-					cur.aabb_left = min(left.aabb_left, right.aabb_left);
-					cur.aabb_top = min(left.aabb_top, right.aabb_top);
-					cur.aabb_right = max(left.aabb_right, right.aabb_right);
-					cur.aabb_bottom = max(left.aabb_bottom, right.aabb_bottom);
-				}
-
-				treelines[i] = treeline;
-				modified = true;
-			}
+			RefitLine(i, treeline);
 		}
 	}
-	return modified;
+	return dirtyEndLine > dirtyStartLine;
 }
 
 
@@ -271,3 +270,62 @@ int DoomLevelAABBTree::GenerateTreeNode(int *lines, int num_lines, const FVector
 	return (int)nodes.Size() - 1;
 }
 
+
+//==========================================================================
+//
+// Builds the current level's tree with every builder and compares
+// build time, tree quality and ray test speed.
+//
+//==========================================================================
+
+CCMD(bench_aabbtree)
+{
+	if (primaryLevel == nullptr || primaryLevel->lines.Size() == 0)
+	{
+		Printf("No level loaded\n");
+		return;
+	}
+
+	int runs = argv.argc() > 1 ? max(atoi(argv[1]), 1) : 5;
+	static const char *names[] = { "median", "SAH", "parallel SAH" };
+	auto &lines = primaryLevel->lines;
+
+	// Rays between scattered line centers, the same set for every tree.
+	TArray<DVector3> rays;
+	for (unsigned i = 0; i < 20000; i++)
+	{
+		const auto &l1 = lines[(i * 7919u) % lines.Size()];
+		const auto &l2 = lines[(i * 104729u + 17u) % lines.Size()];
+		rays.Push(DVector3((l1.v1->fPos() + l1.v2->fPos()) * 0.5, 0.));
+		rays.Push(DVector3((l2.v1->fPos() + l2.v2->fPos()) * 0.5, 0.));
+	}
+
+	Printf("%u lines, %d runs\n", lines.Size(), runs);
+	for (int mode = DoomLevelAABBTree::BUILD_MEDIAN; mode <= DoomLevelAABBTree::BUILD_SAH_PARALLEL; mode++)
+	{
+		cycle_t buildtime, raytime;
+		buildtime.Reset();
+		raytime.Reset();
+
+		DoomLevelAABBTree *tree = nullptr;
+		for (int i = 0; i < runs; i++)
+		{
+			delete tree;
+			buildtime.Clock();
+			tree = new DoomLevelAABBTree(primaryLevel, (DoomLevelAABBTree::EBuildMode)mode);
+			buildtime.Unclock();
+		}
+
+		int hits = 0;
+		raytime.Clock();
+		for (unsigned i = 0; i < rays.Size(); i += 2)
+		{
+			if (tree->RayTest(rays[i], rays[i + 1]) < 1.0) hits++;
+		}
+		raytime.Unclock();
+
+		Printf("%-12s build %7.2f ms, %u nodes, depth %d, SAH cost %8.1f, %u rays %7.2f ms (%d hits)\n", names[mode], buildtime.TimeMS() / runs,
+			tree->NodesCount(), tree->GetDepth(), tree->GetSAHCost(), rays.Size() / 2, raytime.TimeMS(), hits);
+		delete tree;
+	}
+}
@@ -7,12 +7,19 @@ struct FLevelLocals;
 class DoomLevelAABBTree : public hwrenderer::LevelAABBTree
 {
 public:
+	enum EBuildMode
+	{
+		BUILD_MEDIAN,			// splits at the mean of the line centers
+		BUILD_SAH,				// binned surface area heuristic
+		BUILD_SAH_PARALLEL,		// same tree as BUILD_SAH, built by the worker pool
+	};
+
 	// Constructs a tree for the current level
-	DoomLevelAABBTree(FLevelLocals *lev);
+	DoomLevelAABBTree(FLevelLocals *lev, EBuildMode mode = BUILD_SAH_PARALLEL);
 	bool Update() override;
 
 private:
-	bool GenerateTree(const FVector2 *centroids, bool dynamicsubtree);
+	bool GenerateTree(const FVector2 *centroids, bool dynamicsubtree, EBuildMode mode);
 
 	// Generate a tree node and its children recursively
 	int GenerateTreeNode(int *treelines, int num_lines, const FVector2 *centroids, int *work_buffer);
@@ -16,7 +16,7 @@ struct Surface
 	unsigned int startVertIndex;
 	secplane_t plane;
 	sector_t *controlSector;
-	bool bSky;
+	bool bSky = false;
 };
 
 class DoomLevelMesh : public hwrenderer::LevelMesh
@@ -0,0 +1,584 @@
+/*
+** doom_lightmapbaker.cpp
+** Bakes the static lights of a level into a LIGHTMAP lump on the CPU
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 GZDoom Maintainers and Contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+*/
+
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+#include <string.h>
+#include <miniz.h>
+#include "c_dispatch.h"
+#include "stats.h"
+#include "files.h"
+#include "m_swap.h"
+#include "workerpool.h"
+#include "g_levellocals.h"
+#include "actor.h"
+#include "a_dynlight.h"
+#include "doom_levelmesh.h"
+#include "doom_lightmapbaker.h"
+
+// Distance the shadow rays start away from the surface, so that they do not hit it.
+static const float SurfaceOffset = 0.5f;
+
+//==========================================================================
+//
+// Half float conversion for the lightmap texels, rounding to nearest.
+// Values too large for a half are clamped to the largest finite one.
+//
+//==========================================================================
+
+static uint16_t FloatToHalf(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	uint32_t sign = (bits >> 16) & 0x8000;
+	int exponent = (int)((bits >> 23) & 0xff) - 127 + 15;
+	uint32_t mantissa = bits & 0x7fffff;
+
+	if (exponent <= 0)
+	{
+		if (exponent < -10)
+			return (uint16_t)sign;
+		mantissa |= 0x800000;
+		int shift = 14 - exponent;
+		uint32_t half = mantissa >> shift;
+		if ((mantissa >> (shift - 1)) & 1)
+			half++;
+		return (uint16_t)(sign | half);
+	}
+	if (exponent >= 31)
+		return (uint16_t)(sign | 0x7bff);
+
+	uint32_t half = sign | (exponent << 10) | (mantissa >> 13);
+	if (mantissa & 0x1000)
+		half++;
+	return (uint16_t)std::min<uint32_t>(half, sign | 0x7bff);
+}
+
+static float SmoothStep(float edge0, float edge1, float x)
+{
+	float t = clamp<float>((x - edge0) / (edge1 - edge0), 0.0f, 1.0f);
+	return t * t * (3.0f - 2.0f * t);
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+DoomLightmapBaker::DoomLightmapBaker(FLevelLocals *level, DoomLevelMesh *mesh, int textureSize, float sampleDistance)
+	: Level(level), Mesh(mesh), textureSize(textureSize), sampleDistance(sampleDistance)
+{
+}
+
+void DoomLightmapBaker::Bake()
+{
+	BVH.reset(new hwrenderer::LevelMeshBVH(*Mesh));
+
+	CollectLights();
+	CreateRects();
+	PackRects();
+	CreateTexCoords();
+
+	textureData.Resize(numTextures * textureSize * textureSize * 3);
+	if (textureData.Size() > 0)
+		memset(textureData.Data(), 0, textureData.Size() * sizeof(uint16_t));
+
+	// Every surface owns its own texels, so they can be lit in any order.
+	WorkerPool.ParallelFor(rects.Size(), [&](int i) { BakeRect(rects[i]); });
+
+	BakeProbes();
+}
+
+//==========================================================================
+//
+// Only lights that neither move nor animate can be baked
+//
+//==========================================================================
+
+void DoomLightmapBaker::CollectLights()
+{
+	lights.Clear();
+	for (FDynamicLight *light = Level->lights; light; light = light->next)
+	{
+		if (!light->IsActive() || light->DontLightMap() || light->IsSubtractive() || light->lighttype != PointLight)
+			continue;
+
+		AActor *owner = light->target;
+		if (owner && ((owner->flags3 & MF3_ISMONSTER) || (owner->flags & MF_MISSILE)))
+			continue;
+
+		BakeLight bl;
+		bl.Origin = FVector3((float)light->Pos.X, (float)light->Pos.Y, (float)light->Pos.Z);
+		bl.Radius = light->GetRadius();
+		bl.Color = FVector3(light->GetRed() / 255.0f, light->GetGreen() / 255.0f, light->GetBlue() / 255.0f);
+		bl.Attenuate = light->IsAttenuated();
+		bl.Spot = light->IsSpot() && owner;
+		bl.SpotDir = FVector3(0.0f, 0.0f, 0.0f);
+		bl.SpotInnerCos = bl.SpotOuterCos = -1.0f;
+		if (bl.Radius <= 0.0f)
+			continue;
+
+		if (bl.Spot)
+		{
+			// Same direction AddLightToList hands to the shaders, but in map space
+			DAngle negPitch = -*light->pPitch;
+			DAngle angle = owner->Angles.Yaw;
+			double xyLen = negPitch.Cos();
+			bl.SpotDir = FVector3(float(angle.Cos() * xyLen), float(angle.Sin() * xyLen), float(negPitch.Sin()));
+			bl.SpotInnerCos = (float)light->pSpotInnerAngle->Cos();
+			bl.SpotOuterCos = (float)light->pSpotOuterAngle->Cos();
+		}
+		lights.Push(bl);
+	}
+}
+
+//==========================================================================
+//
+// Maps every surface onto a rectangle of texels with a one texel border,
+// walls along the line and up, flats from above.
+//
+//==========================================================================
+
+void DoomLightmapBaker::CreateRects()
+{
+	rects.Clear();
+	for (unsigned int i = 0; i < Mesh->Surfaces.Size(); i++)
+	{
+		const Surface &surface = Mesh->Surfaces[i];
+		if (surface.bSky || surface.numVerts < 3)
+			continue;
+
+		SurfaceRect rect;
+		rect.Surface = i;
+		rect.Texture = rect.X = rect.Y = 0;
+		rect.FirstTexCoord = 0;
+		rect.Normal = FVector3(surface.plane.Normal());
+
+		if (surface.type == ST_FLOOR || surface.type == ST_CEILING)
+		{
+			rect.Origin = FVector3(0.0f, 0.0f, 0.0f);
+			rect.UAxis = FVector3(1.0f, 0.0f, 0.0f);
+			rect.VAxis = FVector3(0.0f, 1.0f, 0.0f);
+		}
+		else
+		{
+			const side_t &side = Level->sides[surface.typeIndex];
+			FVector2 v1((float)side.V1()->fX(), (float)side.V1()->fY());
+			FVector2 v2((float)side.V2()->fX(), (float)side.V2()->fY());
+			rect.Origin = FVector3(v1.X, v1.Y, 0.0f);
+			rect.UAxis = FVector3((v2 - v1).Unit(), 0.0f);
+			rect.VAxis = FVector3(0.0f, 0.0f, 1.0f);
+		}
+
+		const FVector3 *verts = &Mesh->MeshVertices[surface.startVertIndex];
+		float minU = FLT_MAX, minV = FLT_MAX, maxU = -FLT_MAX, maxV = -FLT_MAX;
+		for (int j = 0; j < surface.numVerts; j++)
+		{
+			float u = (verts[j] - rect.Origin) | rect.UAxis;
+			float v = (verts[j] - rect.Origin) | rect.VAxis;
+			minU = std::min(minU, u);
+			minV = std::min(minV, v);
+			maxU = std::max(maxU, u);
+			maxV = std::max(maxV, v);
+		}
+
+		// Surfaces too large for a texture get a coarser sample distance
+		int texelsU = clamp<int>((int)ceilf((maxU - minU) / sampleDistance), 1, textureSize - 2);
+		int texelsV = clamp<int>((int)ceilf((maxV - minV) / sampleDistance), 1, textureSize - 2);
+		rect.Width = texelsU + 2;
+		rect.Height = texelsV + 2;
+		rect.MinU = minU;
+		rect.MinV = minV;
+		rect.TexelU = std::max(maxU - minU, 1.0f) / texelsU;
+		rect.TexelV = std::max(maxV - minV, 1.0f) / texelsV;
+		rects.Push(rect);
+	}
+}
+
+//==========================================================================
+//
+// Shelf packing, tallest rectangles first. Ties are broken by surface
+// index so that the same level always bakes to the same lump.
+//
+//==========================================================================
+
+void DoomLightmapBaker::PackRects()
+{
+	TArray<int> order;
+	order.Resize(rects.Size());
+	for (unsigned int i = 0; i < order.Size(); i++)
+		order[i] = i;
+
+	std::sort(order.begin(), order.end(), [&](int a, int b)
+	{
+		if (rects[a].Height != rects[b].Height)
+			return rects[a].Height > rects[b].Height;
+		if (rects[a].Width != rects[b].Width)
+			return rects[a].Width > rects[b].Width;
+		return a < b;
+	});
+
+	numTextures = rects.Size() > 0 ? 1 : 0;
+	int x = 0, y = 0, shelfHeight = 0;
+	for (int index : order)
+	{
+		SurfaceRect &rect = rects[index];
+		if (x + rect.Width > textureSize)
+		{
+			x = 0;
+			y += shelfHeight;
+			shelfHeight = 0;
+		}
+		if (y + rect.Height > textureSize)
+		{
+			numTextures++;
+			x = y = shelfHeight = 0;
+		}
+		rect.Texture = numTextures - 1;
+		rect.X = x;
+		rect.Y = y;
+		x += rect.Width;
+		shelfHeight = std::max(shelfHeight, rect.Height);
+	}
+}
+
+//==========================================================================
+//
+// The texture coordinates are stored in the vertex order the renderer
+// uses: subsector order for flats, and lower left, upper left,
+// upper right, lower right for walls.
+//
+//==========================================================================
+
+void DoomLightmapBaker::CreateTexCoords()
+{
+	texCoords.Clear();
+	for (SurfaceRect &rect : rects)
+	{
+		const Surface &surface = Mesh->Surfaces[rect.Surface];
+		const FVector3 *verts = &Mesh->MeshVertices[surface.startVertIndex];
+
+		auto addTexCoord = [&](const FVector3 &vert)
+		{
+			float u = (vert - rect.Origin) | rect.UAxis;
+			float v = (vert - rect.Origin) | rect.VAxis;
+			texCoords.Push((rect.X + 1 + (u - rect.MinU) / rect.TexelU) / textureSize);
+			texCoords.Push((rect.Y + 1 + (v - rect.MinV) / rect.TexelV) / textureSize);
+		};
+
+		rect.FirstTexCoord = texCoords.Size() / 2;
+		if (surface.type == ST_CEILING)
+		{
+			for (int j = 0; j < surface.numVerts; j++)
+				addTexCoord(verts[j]);
+		}
+		else if (surface.type == ST_FLOOR)
+		{
+			// The level mesh winds floors the other way around
+			for (int j = surface.numVerts - 1; j >= 0; j--)
+				addTexCoord(verts[j]);
+		}
+		else
+		{
+			// Vertices 0 and 2 are the bottom and top of one end of the wall, 1 and 3 of the other.
+			bool v1First = ((verts[0] - rect.Origin) | rect.UAxis) <= ((verts[1] - rect.Origin) | rect.UAxis);
+			int left = v1First ? 0 : 1, right = v1First ? 1 : 0;
+			addTexCoord(verts[left]);
+			addTexCoord(verts[left + 2]);
+			addTexCoord(verts[right + 2]);
+			addTexCoord(verts[right]);
+		}
+	}
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+FVector3 DoomLightmapBaker::SurfacePoint(const SurfaceRect &rect, float u, float v) const
+{
+	FVector3 pos = rect.Origin + rect.UAxis * u + rect.VAxis * v;
+	const Surface &surface = Mesh->Surfaces[rect.Surface];
+	if (surface.type == ST_FLOOR || surface.type == ST_CEILING)
+		pos.Z = (float)surface.plane.ZatPoint(pos.X, pos.Y);
+	return pos;
+}
+
+//==========================================================================
+//
+// Lights the texels of one surface, border included, so that bilinear
+// filtering at the edges does not pick up its neighbours in the atlas.
+//
+//==========================================================================
+
+void DoomLightmapBaker::BakeRect(const SurfaceRect &rect)
+{
+	const Surface &surface = Mesh->Surfaces[rect.Surface];
+	const FVector3 *verts = &Mesh->MeshVertices[surface.startVertIndex];
+
+	FVector3 aabb_min = verts[0], aabb_max = verts[0];
+	for (int j = 1; j < surface.numVerts; j++)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			aabb_min[k] = std::min(aabb_min[k], verts[j][k]);
+			aabb_max[k] = std::max(aabb_max[k], verts[j][k]);
+		}
+	}
+
+	// Lights whose sphere reaches the surface from its front side
+	TArray<int> candidates;
+	for (unsigned int i = 0; i < lights.Size(); i++)
+	{
+		const BakeLight &light = lights[i];
+		if (((light.Origin - verts[0]) | rect.Normal) <= 0.0f)
+			continue;
+
+		float distSqr = 0.0f;
+		for (int k = 0; k < 3; k++)
+		{
+			float d = std::max({ aabb_min[k] - light.Origin[k], 0.0f, light.Origin[k] - aabb_max[k] });
+			distSqr += d * d;
+		}
+		if (distSqr < light.Radius * light.Radius)
+			candidates.Push(i);
+	}
+	if (candidates.Size() == 0)
+		return;
+
+	for (int y = 0; y < rect.Height; y++)
+	{
+		uint16_t *dest = &textureData[((rect.Texture * textureSize + rect.Y + y) * textureSize + rect.X) * 3];
+		float v = rect.MinV + (y - 0.5f) * rect.TexelV;
+		for (int x = 0; x < rect.Width; x++)
+		{
+			float u = rect.MinU + (x - 0.5f) * rect.TexelU;
+			FVector3 color = LightPoint(SurfacePoint(rect, u, v), &rect.Normal, candidates);
+			dest[x * 3] = FloatToHalf(color.X);
+			dest[x * 3 + 1] = FloatToHalf(color.Y);
+			dest[x * 3 + 2] = FloatToHalf(color.Z);
+		}
+	}
+}
+
+//==========================================================================
+//
+// Uses the same falloff as the dynamic light shaders. Without a normal
+// (light probes) the light is not attenuated by the angle of incidence.
+//
+//==========================================================================
+
+FVector3 DoomLightmapBaker::LightPoint(const FVector3 &pos, const FVector3 *normal, const TArray<int> &candidates) const
+{
+	FVector3 result(0.0f, 0.0f, 0.0f);
+	FVector3 origin = normal ? pos + *normal * SurfaceOffset : pos;
+	for (int index : candidates)
+	{
+		const BakeLight &light = lights[index];
+		FVector3 dir = light.Origin - pos;
+		float dist = dir.Length();
+		if (dist >= light.Radius)
+			continue;
+		if (dist > 0.0f)
+			dir /= dist;
+
+		float attenuation = 1.0f - dist / light.Radius;
+		if (normal)
+		{
+			float ndotl = *normal | dir;
+			if (ndotl <= 0.0f)
+				continue;
+			if (light.Attenuate)
+				attenuation *= ndotl;
+		}
+		if (light.Spot)
+		{
+			attenuation *= SmoothStep(light.SpotOuterCos, light.SpotInnerCos, -(dir | light.SpotDir));
+			if (attenuation <= 0.0f)
+				continue;
+		}
+
+		if (!BVH->IsOccluded(origin, light.Origin))
+			result += light.Color * attenuation;
+	}
+	return result;
+}
+
+//==========================================================================
+//
+// One probe in the middle of every subsector for lighting actors
+//
+//==========================================================================
+
+void DoomLightmapBaker::BakeProbes()
+{
+	TArray<int> allLights;
+	allLights.Resize(lights.Size());
+	for (unsigned int i = 0; i < lights.Size(); i++)
+		allLights[i] = i;
+
+	TArray<subsector_t *> subsectors;
+	for (auto &sub : Level->subsectors)
+	{
+		if (sub.sector && sub.numlines >= 3)
+			subsectors.Push(&sub);
+	}
+
+	probes.Resize(subsectors.Size());
+	WorkerPool.ParallelFor(subsectors.Size(), [&](int i)
+	{
+		subsector_t *sub = subsectors[i];
+		DVector2 center(0.0, 0.0);
+		for (unsigned int j = 0; j < sub->numlines; j++)
+			center += sub->firstline[j].v1->fPos();
+		center /= sub->numlines;
+
+		double floorz = sub->sector->floorplane.ZatPoint(center);
+		double ceilingz = sub->sector->ceilingplane.ZatPoint(center);
+		FVector3 pos((float)center.X, (float)center.Y, (float)((floorz + ceilingz) * 0.5));
+		FVector3 color = LightPoint(pos, nullptr, allLights);
+
+		LightProbe &probe = probes[i];
+		probe.X = pos.X;
+		probe.Y = pos.Y;
+		probe.Z = pos.Z;
+		probe.Red = color.X;
+		probe.Green = color.Y;
+		probe.Blue = color.Z;
+	});
+}
+
+//==========================================================================
+//
+// Version 0 of the LIGHTMAP lump, zlib compressed
+//
+//==========================================================================
+
+bool DoomLightmapBaker::WriteLump(const char *filename) const
+{
+	TArray<uint8_t> lump;
+	auto write = [&](const void *data, size_t size)
+	{
+		if (size > 0) memcpy(&lump[lump.Reserve((unsigned)size)], data, size);
+	};
+	auto writeUInt16 = [&](uint16_t value) { value = LittleShort(value); write(&value, sizeof(value)); };
+	auto writeUInt32 = [&](uint32_t value) { value = LittleLong(value); write(&value, sizeof(value)); };
+
+	writeUInt32(0);
+	writeUInt16((uint16_t)textureSize);
+	writeUInt16((uint16_t)numTextures);
+	writeUInt32(rects.Size());
+	writeUInt32(texCoords.Size() / 2);
+	writeUInt32(probes.Size());
+	writeUInt32(Level->subsectors.Size());
+
+	write(probes.Data(), probes.Size() * sizeof(LightProbe));
+
+	for (const SurfaceRect &rect : rects)
+	{
+		const Surface &surface = Mesh->Surfaces[rect.Surface];
+		writeUInt32(surface.type);
+		writeUInt32(surface.typeIndex);
+		writeUInt32(surface.controlSector ? surface.controlSector->Index() : 0xffffffff);
+		writeUInt32(rect.Texture);
+		writeUInt32(rect.FirstTexCoord);
+	}
+
+	write(texCoords.Data(), texCoords.Size() * sizeof(float));
+	write(textureData.Data(), textureData.Size() * sizeof(uint16_t));
+
+	mz_ulong packedsize = compressBound(lump.Size());
+	TArray<uint8_t> packed(packedsize, true);
+	if (compress2(packed.Data(), &packedsize, lump.Data(), lump.Size(), 9) != Z_OK)
+		return false;
+
+	FileWriter *fw = FileWriter::Open(filename);
+	if (fw == nullptr)
+		return false;
+	bool saved = fw->Write(packed.Data(), packedsize) == packedsize;
+	delete fw;
+	return saved;
+}
+
+//==========================================================================
+//
+// Bakes the current level and writes the result to a lump file that can
+// be added to the map as its LIGHTMAP lump.
+//
+//==========================================================================
+
+CCMD(bakelightmap)
+{
+	if (argv.argc() < 2)
+	{
+		Printf("Usage: bakelightmap <filename> [sample distance] [texture size]\n");
+		return;
+	}
+	if (primaryLevel == nullptr || primaryLevel->subsectors.Size() == 0)
+	{
+		Printf("No level loaded\n");
+		return;
+	}
+
+	float sampleDistance = argv.argc() > 2 ? clamp<float>((float)atof(argv[2]), 1.0f, 1024.0f) : 16.0f;
+	int textureSize = argv.argc() > 3 ? clamp<int>(atoi(argv[3]), 64, 4096) : 1024;
+
+	std::unique_ptr<DoomLevelMesh> levelMesh;
+	DoomLevelMesh *mesh = primaryLevel->levelMesh;
+	if (mesh == nullptr)
+	{
+		levelMesh.reset(new DoomLevelMesh(*primaryLevel));
+		mesh = levelMesh.get();
+	}
+
+	cycle_t baketime;
+	baketime.Reset();
+	baketime.Clock();
+	DoomLightmapBaker baker(primaryLevel, mesh, textureSize, sampleDistance);
+	baker.Bake();
+	baketime.Unclock();
+
+	Printf("Baked %u surfaces with %u lights into %d textures and %u probes in %.2f ms\n",
+		baker.SurfacesCount(), baker.LightsCount(), baker.TexturesCount(), baker.ProbesCount(), baketime.TimeMS());
+
+	if (baker.WriteLump(argv[1]))
+		Printf("Wrote %s\n", argv[1]);
+	else
+		Printf("Could not write %s\n", argv[1]);
+}
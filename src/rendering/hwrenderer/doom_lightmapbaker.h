@@ -0,0 +1,113 @@
+/*
+** doom_lightmapbaker.h
+** Bakes the static lights of a level into a LIGHTMAP lump on the CPU
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 GZDoom Maintainers and Contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+*/
+#pragma once
+
+#include <memory>
+#include "tarray.h"
+#include "vectors.h"
+#include "r_defs.h"
+#include "hw_meshbvh.h"
+
+struct FLevelLocals;
+class DoomLevelMesh;
+
+//==========================================================================
+//
+// Lights every surface of the level mesh with the level's static lights,
+// tracing shadow rays through a BVH of the mesh, and packs the results
+// into the lump format MapLoader::LoadLightmap reads.
+//
+//==========================================================================
+
+class DoomLightmapBaker
+{
+public:
+	DoomLightmapBaker(FLevelLocals *level, DoomLevelMesh *mesh, int textureSize, float sampleDistance);
+
+	void Bake();
+	bool WriteLump(const char *filename) const;
+
+	int TexturesCount() const { return numTextures; }
+	unsigned SurfacesCount() const { return rects.Size(); }
+	unsigned LightsCount() const { return lights.Size(); }
+	unsigned ProbesCount() const { return probes.Size(); }
+
+private:
+	struct BakeLight
+	{
+		FVector3 Origin;
+		float Radius;
+		FVector3 Color;
+		bool Attenuate;
+		bool Spot;
+		FVector3 SpotDir;
+		float SpotInnerCos, SpotOuterCos;
+	};
+
+	// Area of a lightmap texture that a mesh surface is mapped to
+	struct SurfaceRect
+	{
+		int Surface;
+		int Texture, X, Y, Width, Height;
+
+		// Planar projection of the surface: world position = Origin + UAxis * u + VAxis * v
+		FVector3 Origin, UAxis, VAxis, Normal;
+		float MinU, MinV, TexelU, TexelV;
+
+		unsigned int FirstTexCoord;
+	};
+
+	void CollectLights();
+	void CreateRects();
+	void PackRects();
+	void CreateTexCoords();
+	void BakeRect(const SurfaceRect &rect);
+	void BakeProbes();
+	FVector3 LightPoint(const FVector3 &pos, const FVector3 *normal, const TArray<int> &candidates) const;
+	FVector3 SurfacePoint(const SurfaceRect &rect, float u, float v) const;
+
+	FLevelLocals *Level;
+	DoomLevelMesh *Mesh;
+	std::unique_ptr<hwrenderer::LevelMeshBVH> BVH;
+
+	int textureSize;
+	float sampleDistance;
+	int numTextures = 0;
+
+	TArray<BakeLight> lights;
+	TArray<SurfaceRect> rects;
+	TArray<float> texCoords;
+	TArray<uint16_t> textureData;
+	TArray<LightProbe> probes;
+};
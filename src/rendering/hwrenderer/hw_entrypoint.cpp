@@ -63,6 +63,11 @@ void CleanSWDrawer()
 	swdrawer = nullptr;
 }
 
+void SkipSWDrawerFrame()
+{
+	if (swdrawer) swdrawer->SkipFrame();
+}
+
 #include "g_levellocals.h"
 #include "a_dynlight.h"
 
@@ -330,6 +335,7 @@ sector_t* RenderView(player_t* player)
 	}
 	else
 	{
+		SkipSWDrawerFrame();	// in case the software renderer was just switched off
 		hw_ClearFakeFlat();
 
 		iter_dlightf = iter_dlight = draw_dlight = draw_dlightf = 0;
@@ -36,6 +36,7 @@
 #include "texturemanager.h"
 #include "hwrenderer/scene/hw_fakeflat.h"
 #include "hwrenderer/scene/hw_clipper.h"
+#include "hwrenderer/scene/hw_occlusion.h"
 #include "hwrenderer/scene/hw_drawstructs.h"
 #include "hwrenderer/scene/hw_drawinfo.h"
 #include "hwrenderer/scene/hw_portal.h"
@@ -44,18 +45,35 @@
 #include "hw_vertexbuilder.h"
 #include "hw_walldispatcher.h"
 
+#include <thread>
+#include <algorithm>
+
 #ifdef ARCH_IA32
 #include <immintrin.h>
 #endif // ARCH_IA32
 
+enum
+{
+	MAX_BSP_WORKERS = 8
+};
+
 CVAR(Bool, gl_multithread, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+CUSTOM_CVAR(Int, gl_multithread_workers, 0, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)	// 0 picks a count based on the available cores.
+{
+	if (self < 0) self = 0;
+	else if (self > MAX_BSP_WORKERS) self = MAX_BSP_WORKERS;
+}
 
 EXTERN_CVAR(Float, r_actorspriteshadowdist)
 
 thread_local bool isWorkerThread;
+thread_local HWDrawSink *CurrentDrawSink;
+static thread_local int CurrentJobSequence;
 ctpl::thread_pool renderPool(1);
 bool inited = false;
 
+static HWDrawSink bspSinks[MAX_BSP_WORKERS];
+
 struct RenderJob
 {
 	enum
@@ -71,77 +89,148 @@ struct RenderJob
 	int type;
 	subsector_t *sub;
 	seg_t *seg;
+	int worker;		// -1 means all workers.
 };
 
 
 class RenderJobQueue
 {
 	RenderJob pool[300000];	// Way more than ever needed. The largest ever seen on a single viewpoint is around 40000.
-	std::atomic<int> readindex{};
 	std::atomic<int> writeindex{};
+	int numworkers = 1;
+	int nextworker = 0;
 public:
 	void AddJob(int type, subsector_t *sub, seg_t *seg = nullptr)
 	{
 		// This does not check for array overflows. The pool should be large enough that it never hits the limit.
 
-		pool[writeindex] = { type, sub, seg };
+		// Walls and flats do not depend on each other and get distributed round robin.
+		// Everything that touches actors or portals stays on the first worker so that it is processed in BSP order.
+		int worker = 0;
+		if (type == RenderJob::TerminateJob)
+		{
+			worker = -1;
+		}
+		else if (type == RenderJob::WallJob || type == RenderJob::FlatJob)
+		{
+			worker = nextworker;
+			if (++nextworker == numworkers) nextworker = 0;
+		}
+		pool[writeindex] = { type, sub, seg, worker };
 		writeindex++;	// update index only after the value has been written.
 	}
 
-	RenderJob *GetJob()
+	// Each worker walks the queue with its own read position and skips the jobs that belong to the others.
+	RenderJob *GetJob(int worker, int &readindex)
 	{
-		if (readindex < writeindex) return &pool[readindex++];
+		int end = writeindex;
+		while (readindex < end)
+		{
+			auto job = &pool[readindex++];
+			if (job->worker == worker || job->worker == -1) return job;
+		}
 		return nullptr;
 	}
 	
-	void ReleaseAll()
+	int Size() const
+	{
+		return writeindex;
+	}
+
+	void ReleaseAll(int workers)
 	{
-		readindex = 0;
 		writeindex = 0;
+		numworkers = workers;
+		nextworker = 0;
 	}
 };
 
 static RenderJobQueue jobQueue;	// One static queue is sufficient here. This code will never be called recursively.
 
-void HWDrawInfo::WorkerThread()
+// Workers report the job they are processing, the main thread how far it has gotten with queuing them.
+int GetBSPJobSequence()
+{
+	return CurrentDrawSink ? CurrentJobSequence : jobQueue.Size();
+}
+
+//==========================================================================
+//
+// Waits for the main thread to queue more work. While the BSP traversal
+// keeps producing jobs a few pause instructions are enough, yielding right
+// away would be too costly. The longer the queue stays empty the longer
+// the pauses get, until the worker starts giving up its time slice.
+//
+//==========================================================================
+
+class JobBackoff
+{
+	int rounds = 0;
+public:
+	void Reset()
+	{
+		rounds = 0;
+	}
+
+	void Wait()
+	{
+		if (rounds < 8)
+		{
+#ifdef ARCH_IA32
+			for (int i = 0; i < (4 << rounds); i++)
+			{
+				_mm_pause();
+			}
+#endif // ARCH_IA32
+			rounds++;
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+};
+
+void HWDrawInfo::WorkerThread(int worker)
 {
 	sector_t *front, *back;
 	HWWallDispatcher disp(this);
+	HWDrawSink &sink = bspSinks[worker];
+	JobBackoff backoff;
+	int readindex = 0;
+	bool clocked = worker == 0;	// The timers are not thread safe so only the first worker updates them.
 
-	WTTotal.Clock();
+	if (clocked) WTTotal.Clock();
 	isWorkerThread = true;	// for adding asserts in GL API code. The worker thread may never call any GL API.
+	CurrentDrawSink = &sink;
+	ThreadRenderDataAllocator = sink.RenderData;
 	while (true)
 	{
-		auto job = jobQueue.GetJob();
+		auto job = jobQueue.GetJob(worker, readindex);
 		if (job == nullptr)
 		{
-#ifdef ARCH_IA32
-			// The queue is empty. But yielding would be too costly here and possibly cause further delays down the line if the thread is halted.
-			// So instead add a few pause instructions and retry immediately.
-			_mm_pause();
-			_mm_pause();
-			_mm_pause();
-			_mm_pause();
-			_mm_pause();
-			_mm_pause();
-			_mm_pause();
-			_mm_pause();
-			_mm_pause();
-			_mm_pause();
-#endif // ARCH_IA32
+			backoff.Wait();
+			continue;
 		}
+		backoff.Reset();
+		CurrentJobSequence = readindex - 1;
+
+		unsigned itemcounts[GLDL_TYPES];
+		for (int i = 0; i < GLDL_TYPES; i++) itemcounts[i] = sink.drawlists[i].drawitems.Size();
+
 		// Note that the main thread MUST have prepared the fake sectors that get used below!
 		// This worker thread cannot prepare them itself without costly synchronization.
-		else switch (job->type)
+		switch (job->type)
 		{
 		case RenderJob::TerminateJob:
-			WTTotal.Unclock();
+			CurrentDrawSink = nullptr;
+			ThreadRenderDataAllocator = nullptr;
+			if (clocked) WTTotal.Unclock();
 			return;
 
 		case RenderJob::WallJob:
 		{
 			HWWall wall;
-			SetupWall.Clock();
+			if (clocked) SetupWall.Clock();
 			wall.sub = job->sub;
 
 			front = hw_FakeFlat(job->sub->sector, in_area, false);
@@ -171,29 +260,33 @@ void HWDrawInfo::WorkerThread()
 			}
 			else back = nullptr;
 
-			wall.Process(&disp, job->seg, front, back);
-			rendered_lines++;
-			SetupWall.Unclock();
+			wallCache.ProcessWall(&disp, wall, job->seg, front, back);
+			sink.rendered_lines++;
+			if (clocked) SetupWall.Unclock();
 			break;
 		}
 
 		case RenderJob::FlatJob:
 		{
 			HWFlat flat;
-			SetupFlat.Clock();
+			if (clocked) SetupFlat.Clock();
 			flat.section = job->sub->section;
 			front = hw_FakeFlat(job->sub->render_sector, in_area, false);
 			flat.ProcessSector(this, front);
-			SetupFlat.Unclock();
+			if (clocked) SetupFlat.Unclock();
 			break;
 		}
 
 		case RenderJob::SpriteJob:
+		{
+			// Line portals being processed by another worker may temporarily move actors around.
+			std::lock_guard<std::mutex> lock(SharedStateLock);
 			SetupSprite.Clock();
 			front = hw_FakeFlat(job->sub->sector, in_area, false);
 			RenderThings(job->sub, front);
 			SetupSprite.Unclock();
 			break;
+		}
 
 		case RenderJob::ParticleJob:
 			SetupSprite.Clock();
@@ -207,6 +300,90 @@ void HWDrawInfo::WorkerThread()
 			break;
 		}
 
+		for (int i = 0; i < GLDL_TYPES; i++)
+		{
+			for (unsigned j = itemcounts[i]; j < sink.drawlists[i].drawitems.Size(); j++) sink.Sequence[i].Push(CurrentJobSequence);
+		}
+	}
+}
+
+//==========================================================================
+//
+// The workers create portals in whatever order they get to them. Put them,
+// and the lines within each portal, back into BSP order so that portal
+// rendering does not depend on thread timing.
+//
+//==========================================================================
+
+void HWDrawInfo::SortPortals(unsigned first)
+{
+	if (Portals.Size() > first + 1)
+	{
+		std::stable_sort(&Portals[first], &Portals[0] + Portals.Size(), [](HWPortal *a, HWPortal *b)
+		{
+			return a->Sequence < b->Sequence;
+		});
+	}
+	for (unsigned i = first; i < Portals.Size(); i++)
+	{
+		auto portal = Portals[i];
+		unsigned count = portal->lines.Size();
+		if (count > 1 && portal->lineSequence.Size() == count)
+		{
+			TArray<unsigned> order(count, true);
+			for (unsigned j = 0; j < count; j++) order[j] = j;
+			std::stable_sort(&order[0], &order[0] + count, [=](unsigned a, unsigned b)
+			{
+				return portal->lineSequence[a] < portal->lineSequence[b];
+			});
+			TArray<HWWall> lines(count, true);
+			for (unsigned j = 0; j < count; j++) lines[j] = portal->lines[order[j]];
+			portal->lines = std::move(lines);
+		}
+		portal->lineSequence.Clear();
+	}
+}
+
+//==========================================================================
+//
+// Appends the workers' output to the draw lists in BSP job order, which
+// is what a single threaded traversal would have produced. Each worker
+// processes its jobs in order, so this is a merge of sorted lists.
+//
+//==========================================================================
+
+void HWDrawInfo::MergeDrawSinks(int count)
+{
+	for (int j = 0; j < GLDL_TYPES; j++)
+	{
+		unsigned pos[MAX_BSP_WORKERS] = {};
+		while (true)
+		{
+			int best = -1;
+			for (int i = 0; i < count; i++)
+			{
+				if (pos[i] < bspSinks[i].Sequence[j].Size() && (best < 0 || bspSinks[i].Sequence[j][pos[i]] < bspSinks[best].Sequence[j][pos[best]])) best = i;
+			}
+			if (best < 0) break;
+			drawlists[j].AppendItem(bspSinks[best].drawlists[j], pos[best]++);
+		}
+		for (int i = 0; i < count; i++)
+		{
+			bspSinks[i].drawlists[j].Reset();
+			bspSinks[i].Sequence[j].Clear();
+		}
+	}
+
+	for (int i = 0; i < count; i++)
+	{
+		auto &sink = bspSinks[i];
+		for (int j = 0; j < 2; j++)
+		{
+			Decals[j].Append(sink.Decals[j]);
+			sink.Decals[j].Clear();
+		}
+		rendered_lines += sink.rendered_lines;
+		sink.rendered_lines = 0;
 	}
 }
 
@@ -343,6 +520,9 @@ void HWDrawInfo::AddLine (seg_t *seg, bool portalclip)
 
 		if (gl_render_walls)
 		{
+			// The occlusion buffer belongs to the thread walking the BSP, never to the workers.
+			if (mOcclusion && !ispoly) AddOccluders(seg, currentsector, backsector);
+
 			if (multithread)
 			{
 				jobQueue.AddJob(RenderJob::WallJob, seg->Subsector, seg);
@@ -353,7 +533,7 @@ void HWDrawInfo::AddLine (seg_t *seg, bool portalclip)
 				HWWallDispatcher disp(this);
 				SetupWall.Clock();
 				wall.sub = seg->Subsector;
-				wall.Process(&disp, seg, currentsector, backsector);
+				wallCache.ProcessWall(&disp, wall, seg, currentsector, backsector);
 				rendered_lines++;
 				SetupWall.Unclock();
 			}
@@ -481,6 +661,38 @@ void HWDrawInfo::AddLines(subsector_t * sub, sector_t * sector)
 	ClipWall.Unclock();
 }
 
+//==========================================================================
+//
+// An occluded subsector skips AddLines, but its lines still count as
+// seen for the automap, same as when they get clipped there.
+//
+//==========================================================================
+
+void HWDrawInfo::MarkOccludedLines(subsector_t * sub)
+{
+	if (sub->polys != nullptr) return;
+
+	auto &clipper = *mClipper;
+	seg_t * seg = sub->firstline;
+	for (int count = sub->numlines; count--; seg++)
+	{
+		angle_t startAngle = clipper.GetClipAngle(seg->v2);
+		angle_t endAngle = clipper.GetClipAngle(seg->v1);
+		if (startAngle - endAngle < ANGLE_180 || !clipper.SafeCheckRange(startAngle, endAngle)) continue;
+
+		sub->flags |= SSECMF_DRAWN;
+		if (seg->sidedef == nullptr || (seg->sidedef->Flags & WALLF_POLYOBJ)) continue;
+
+		// Same as AddLine: lines inside a sector are only mapped when they have something on them.
+		if (seg->backsector && seg->backsector->sectornum == seg->frontsector->sectornum && !seg->linedef->isVisualPortal())
+		{
+			auto tex = TexMan.GetGameTexture(seg->sidedef->GetTexture(side_t::mid), true);
+			if (!tex || !tex->isValid()) continue;
+		}
+		seg->linedef->flags |= ML_MAPPED;
+	}
+}
+
 //==========================================================================
 //
 // Adds lines that lie directly on the portal boundary.
@@ -683,6 +895,9 @@ void HWDrawInfo::DoSubsector(subsector_t * sub)
 		CheckUpdate(screen->mVertexData, sector);
 	}
 
+	// Sprites may extend beyond their subsector so they are still collected and get culled individually afterward.
+	bool occluded = mOcclusion && IsSubsectorOccluded(sub, fakesector);
+
 	// [RH] Add particles
 	if (gl_render_things && (sub->sprites.Size() > 0 || Level->ParticlesInSubsec[sub->Index()] != NO_PARTICLE))
 	{
@@ -698,7 +913,8 @@ void HWDrawInfo::DoSubsector(subsector_t * sub)
 		}
 	}
 
-	AddLines(sub, fakesector);
+	if (!occluded) AddLines(sub, fakesector);
+	else MarkOccludedLines(sub);
 
 	// BSP is traversed by subsector.
 	// A sector might have been split into several
@@ -725,7 +941,7 @@ void HWDrawInfo::DoSubsector(subsector_t * sub)
 		}
 	}
 
-	if (gl_render_flats)
+	if (gl_render_flats && !occluded)
 	{
 		// Subsectors with only 2 lines cannot have any area
 		if (sub->numlines>2 || (sub->hacked&1)) 
@@ -858,27 +1074,49 @@ void HWDrawInfo::RenderBSP(void *node, bool drawpsprites)
 	viewy = FLOAT2FIXED(Viewpoint.Pos.Y);
 
 	validcount++;	// used for processing sidedefs only once by the renderer.
+	wallCache.BeginPass(this);
+	// Portal scenes keep subsectors that straddle the portal line, and the part in front of it would
+	// be rasterized as an occluder even though it gets clipped away later.
+	if (mClipPortal != nullptr) mOcclusion = nullptr;
+	if (mOcclusion) mOcclusion->Begin(this);
 
 	multithread = gl_multithread;
 	if (multithread)
 	{
-		jobQueue.ReleaseAll();
-		auto future = renderPool.push([&](int id) {
-			WorkerThread();
-		});
+		int numworkers = gl_multithread_workers;
+		if (numworkers <= 0) numworkers = clamp<int>(std::thread::hardware_concurrency() / 2, 1, 4);
+		if (renderPool.size() != numworkers) renderPool.resize(numworkers);
+
+		jobQueue.ReleaseAll(numworkers);
+		unsigned firstportal = Portals.Size();
+		std::future<void> futures[MAX_BSP_WORKERS];
+		for (int i = 0; i < numworkers; i++)
+		{
+			bspSinks[i].RenderData = GetWorkerRenderDataAllocator(i);
+			futures[i] = renderPool.push([this, i](int id) {
+				WorkerThread(i);
+			});
+		}
 		RenderBSPNode(node);
 
 		jobQueue.AddJob(RenderJob::TerminateJob, nullptr, nullptr);
 		Bsp.Unclock();
 		MTWait.Clock();
-		future.wait();
+		for (int i = 0; i < numworkers; i++)
+		{
+			futures[i].wait();
+		}
 		MTWait.Unclock();
+		MergeDrawSinks(numworkers);
+		SortPortals(firstportal);
 	}
 	else
 	{
 		RenderBSPNode(node);
 		Bsp.Unclock();
 	}
+	if (mOcclusion) CullOccludedSprites();
+
 	// Process all the sprites on the current portal's back side which touch the portal.
 	if (mCurrentPortal != nullptr) mCurrentPortal->RenderAttached(this);
 
@@ -38,6 +38,11 @@
 #include "hw_clipper.h"
 #include "g_levellocals.h"
 #include "basics.h"
+#include "c_cvars.h"
+#include "c_dispatch.h"
+#include "printf.h"
+
+CVAR(Int, gl_clipper, Clipper::CLIP_List, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
 
 unsigned Clipper::starttime;
 
@@ -97,6 +102,73 @@ void Clipper::Clear()
 	cliphead = NULL;
 	silhouette = NULL;
 	starttime++;
+
+	ranges.Clear();
+	silhouetteranges.Clear();
+	if (mismatches > 0)
+	{
+		Printf("Clipper: %d mismatches between the list and the array\n", mismatches);
+		mismatches = 0;
+	}
+	mode = clamp<int>(gl_clipper, CLIP_List, CLIP_Validate);
+}
+
+//-----------------------------------------------------------------------------
+//
+// SelfTest
+//
+// Runs random range operations on a clipper that maintains both storages
+// and returns how often they disagreed.
+//
+//-----------------------------------------------------------------------------
+
+int Clipper::SelfTest()
+{
+	Clipper clipper;
+	clipper.mode = CLIP_Validate;
+
+	// Touching ranges left behind by a removal must be merged when a new range overlaps them.
+	clipper.AddClipRange(1, 8);
+	clipper.RemoveClipRange(7, 7);
+	clipper.AddClipRange(0, 5);
+	clipper.IsRangeVisible(6, 8);
+	int total = clipper.mismatches;
+
+	// A small set of angles so that ranges often overlap, touch or coincide.
+	uint32_t seed = 1;
+	auto random = [&](unsigned range) { seed = seed * 1664525 + 1013904223; return (seed >> 16) % range; };
+	for (int round = 0; round < 200; round++)
+	{
+		clipper.mismatches = 0;
+		clipper.Clear();
+		clipper.mode = CLIP_Validate;
+		for (int op = 0; op < 40; op++)
+		{
+			if (op == 20 && (round & 1)) clipper.SetSilhouette();
+
+			angle_t a = random(32), b = random(32);
+			if (a > b) std::swap(a, b);
+			switch (random(4))
+			{
+			case 0:
+				clipper.RemoveClipRange(a, b);
+				break;
+			case 1:
+				clipper.IsRangeVisible(a, b);
+				break;
+			default:
+				clipper.AddClipRange(a, b);
+				break;
+			}
+		}
+		total += clipper.mismatches;
+	}
+	return total;
+}
+
+CCMD(gl_clippertest)
+{
+	Printf("Clipper: self test found %d mismatches between the list and the array\n", Clipper::SelfTest());
 }
 
 //-----------------------------------------------------------------------------
@@ -107,6 +179,12 @@ void Clipper::Clear()
 
 void Clipper::SetSilhouette()
 {
+	if (mode != CLIP_List)
+	{
+		silhouetteranges = ranges;
+		if (mode == CLIP_Array) return;
+	}
+
 	ClipNode *node = cliphead;
 	ClipNode *last = NULL;
 
@@ -123,11 +201,61 @@ void Clipper::SetSilhouette()
 
 //-----------------------------------------------------------------------------
 //
-// IsRangeVisible
+// Dispatches to the active range storage. CLIP_Validate runs both and
+// counts every query or update after which they do not agree.
 //
 //-----------------------------------------------------------------------------
 
 bool Clipper::IsRangeVisible(angle_t startAngle, angle_t endAngle)
+{
+	switch (mode)
+	{
+	case CLIP_Array:
+		return IsRangeVisibleArray(startAngle, endAngle);
+
+	case CLIP_Validate:
+	{
+		bool visible = IsRangeVisibleList(startAngle, endAngle);
+		if (visible != IsRangeVisibleArray(startAngle, endAngle)) mismatches++;
+		return visible;
+	}
+
+	default:
+		return IsRangeVisibleList(startAngle, endAngle);
+	}
+}
+
+bool Clipper::RangesMatch()
+{
+	unsigned i = 0;
+	for (ClipNode *node = cliphead; node != nullptr; node = node->next, i++)
+	{
+		if (i >= ranges.Size() || ranges[i].start != node->start || ranges[i].end != node->end) return false;
+	}
+	return i == ranges.Size();
+}
+
+void Clipper::AddClipRange(angle_t start, angle_t end)
+{
+	if (mode != CLIP_List) AddClipRangeArray(start, end);
+	if (mode != CLIP_Array) AddClipRangeList(start, end);
+	if (mode == CLIP_Validate && !RangesMatch()) mismatches++;
+}
+
+void Clipper::RemoveClipRange(angle_t start, angle_t end)
+{
+	if (mode != CLIP_List) RemoveClipRangeArray(start, end);
+	if (mode != CLIP_Array) RemoveClipRangeList(start, end);
+	if (mode == CLIP_Validate && !RangesMatch()) mismatches++;
+}
+
+//-----------------------------------------------------------------------------
+//
+// IsRangeVisible
+//
+//-----------------------------------------------------------------------------
+
+bool Clipper::IsRangeVisibleList(angle_t startAngle, angle_t endAngle)
 {
 	ClipNode *ci;
 	ci = cliphead;
@@ -152,7 +280,7 @@ bool Clipper::IsRangeVisible(angle_t startAngle, angle_t endAngle)
 //
 //-----------------------------------------------------------------------------
 
-void Clipper::AddClipRange(angle_t start, angle_t end)
+void Clipper::AddClipRangeList(angle_t start, angle_t end)
 {
 	ClipNode *node, *temp, *prevNode;
 
@@ -257,7 +385,7 @@ void Clipper::AddClipRange(angle_t start, angle_t end)
 //
 //-----------------------------------------------------------------------------
 
-void Clipper::RemoveClipRange(angle_t start, angle_t end)
+void Clipper::RemoveClipRangeList(angle_t start, angle_t end)
 {
 	ClipNode *node;
 
@@ -342,6 +470,136 @@ void Clipper::DoRemoveClipRange(angle_t start, angle_t end)
 }
 
 
+//-----------------------------------------------------------------------------
+//
+// Array storage
+//
+// The ranges never overlap, so both their starts and their ends are sorted.
+// Each operation finds its position with a binary search and only touches
+// the ranges that actually overlap instead of walking everything before them.
+// Every operation follows the same steps as its list counterpart so that both
+// end up with the same ranges. gl_clipper 2 compares them while rendering and
+// gl_clippertest runs randomized operations on both.
+//
+//-----------------------------------------------------------------------------
+
+// Returns the index of the first range that ends at or after the given angle.
+unsigned Clipper::FindFirstRange(angle_t start)
+{
+	unsigned lo = 0, hi = ranges.Size();
+	while (lo < hi)
+	{
+		unsigned mid = (lo + hi) >> 1;
+		if (ranges[mid].end < start) lo = mid + 1;
+		else hi = mid;
+	}
+	return lo;
+}
+
+bool Clipper::IsRangeVisibleArray(angle_t startAngle, angle_t endAngle)
+{
+	if (endAngle == 0 && ranges.Size() > 0 && ranges[0].start == 0) return false;
+
+	// Only ranges that reach the end angle can contain the queried one.
+	for (unsigned i = FindFirstRange(endAngle); i < ranges.Size() && ranges[i].start < endAngle; i++)
+	{
+		if (startAngle >= ranges[i].start && endAngle <= ranges[i].end)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void Clipper::AddClipRangeArray(angle_t start, angle_t end)
+{
+	// Same steps as AddClipRangeList. Ranges that end before the new one starts are never affected.
+	unsigned first = FindFirstRange(start);
+
+	// Remove the ranges the new one contains, unless it is already covered by one.
+	for (unsigned i = first; i < ranges.Size() && ranges[i].start < end;)
+	{
+		if (ranges[i].start >= start && ranges[i].end <= end) ranges.Delete(i);
+		else if (ranges[i].start <= start && ranges[i].end >= end) return;
+		else i++;
+	}
+
+	if (first == ranges.Size() || ranges[first].start > end)
+	{
+		ranges.Insert(first, { start, end });
+		return;
+	}
+
+	// Merge into the first overlapping range and keep absorbing the ones that now overlap or touch it.
+	auto &merged = ranges[first];
+	if (merged.start > start) merged.start = start;
+	if (merged.end < end) merged.end = end;
+	unsigned last = first + 1;
+	while (last < ranges.Size() && ranges[last].start <= merged.end)
+	{
+		if (ranges[last].end > merged.end) merged.end = ranges[last].end;
+		last++;
+	}
+	if (last - first > 1) ranges.Delete(first + 1, last - first - 1);
+}
+
+void Clipper::RemoveClipRangeArray(angle_t start, angle_t end)
+{
+	if (silhouetteranges.Size() > 0)
+	{
+		unsigned i = 0;
+		while (i < silhouetteranges.Size() && silhouetteranges[i].end <= start)
+		{
+			i++;
+		}
+		if (i < silhouetteranges.Size() && silhouetteranges[i].start <= start)
+		{
+			if (silhouetteranges[i].end >= end) return;
+			start = silhouetteranges[i].end;
+			i++;
+		}
+		while (i < silhouetteranges.Size() && silhouetteranges[i].start < end)
+		{
+			DoRemoveClipRangeArray(start, silhouetteranges[i].start);
+			start = silhouetteranges[i].end;
+			i++;
+		}
+		if (start >= end) return;
+	}
+	DoRemoveClipRangeArray(start, end);
+}
+
+void Clipper::DoRemoveClipRangeArray(angle_t start, angle_t end)
+{
+	unsigned i = FindFirstRange(start);
+	while (i < ranges.Size() && ranges[i].start <= end)
+	{
+		auto &range = ranges[i];
+		if (range.start >= start && range.end <= end && range.start < end)
+		{
+			ranges.Delete(i);
+		}
+		else if (range.start >= start)
+		{
+			range.start = end;
+			break;
+		}
+		else if (range.end <= end)
+		{
+			range.end = start;
+			i++;
+		}
+		else
+		{
+			// The removed part lies inside this range which has to be split.
+			ClipRange back = { end, range.end };
+			range.end = start;
+			ranges.Insert(i + 1, back);
+			break;
+		}
+	}
+}
+
 //-----------------------------------------------------------------------------
 //
 // 
@@ -5,6 +5,7 @@
 #include "xs_Float.h"
 #include "r_utility.h"
 #include "memarena.h"
+#include "tarray.h"
 
 class ClipNode
 {
@@ -19,9 +20,23 @@ class ClipNode
 	}
 };
 
+struct ClipRange
+{
+	angle_t start, end;
+};
+
 
 class Clipper
 {
+public:
+	enum
+	{
+		CLIP_List,		// linked list of ClipNodes
+		CLIP_Array,		// sorted array with binary searches
+		CLIP_Validate,	// maintains both and reports when they disagree
+	};
+
+private:
 	static unsigned starttime;
 	FMemArena nodearena;
 	ClipNode * freelist = nullptr;
@@ -32,18 +47,37 @@ class Clipper
     const FRenderViewpoint *viewpoint = nullptr;
 	bool blocked = false;
 
+	// The same ranges as the list, for CLIP_Array and CLIP_Validate.
+	TArray<ClipRange> ranges;
+	TArray<ClipRange> silhouetteranges;
+	int mode = CLIP_List;	// only changes in Clear() so that a scene never mixes both.
+	int mismatches = 0;
+
 	static angle_t AngleToPseudo(angle_t ang);
 	bool IsRangeVisible(angle_t startangle, angle_t endangle);
-	void RemoveRange(ClipNode * cn);
 	void AddClipRange(angle_t startangle, angle_t endangle);
 	void RemoveClipRange(angle_t startangle, angle_t endangle);
+
+	bool RangesMatch();
+
+	bool IsRangeVisibleList(angle_t startangle, angle_t endangle);
+	void RemoveRange(ClipNode * cn);
+	void AddClipRangeList(angle_t startangle, angle_t endangle);
+	void RemoveClipRangeList(angle_t startangle, angle_t endangle);
 	void DoRemoveClipRange(angle_t start, angle_t end);
 
+	unsigned FindFirstRange(angle_t start);
+	bool IsRangeVisibleArray(angle_t startangle, angle_t endangle);
+	void AddClipRangeArray(angle_t startangle, angle_t endangle);
+	void RemoveClipRangeArray(angle_t startangle, angle_t endangle);
+	void DoRemoveClipRangeArray(angle_t start, angle_t end);
+
 public:
 
 	Clipper();
 
 	void Clear();
+	static int SelfTest();
 
 	void Free(ClipNode *node)
 	{
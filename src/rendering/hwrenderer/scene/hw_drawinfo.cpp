@@ -44,6 +44,7 @@
 #include "hw_bonebuffer.h"
 #include "hw_vrmodes.h"
 #include "hw_clipper.h"
+#include "hw_occlusion.h"
 #include "v_draw.h"
 #include "a_corona.h"
 #include "texturemanager.h"
@@ -51,6 +52,7 @@
 #include "g_levellocals.h"
 
 EXTERN_CVAR(Float, r_visibility)
+EXTERN_CVAR(Bool, gl_occlusion)
 CVAR(Bool, gl_bandedswlight, false, CVAR_ARCHIVE)
 CVAR(Bool, gl_sort_textures, false, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
 CVAR(Bool, gl_no_skyclear, false, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
@@ -137,6 +139,7 @@ void HWDrawInfo::StartScene(FRenderViewpoint &parentvp, HWViewpointUniforms *uni
 {
 	staticClipper.Clear();
 	mClipper = &staticClipper;
+	mOcclusion = gl_occlusion ? &occlusionBuffer : nullptr;
 
 	Viewpoint = parentvp;
 	lightmode = getRealLightmode(Level, true);
@@ -397,6 +400,7 @@ void HWDrawInfo::SetupView(FRenderState &state, float vx, float vy, float vz, bo
 	SetViewMatrix(vp.HWAngles, vx, vy, vz, mirror, planemirror);
 	SetCameraPos(vp.Pos);
 	VPUniforms.CalcDependencies();
+	VPUniforms.mLightGridIndex = -1;	// the scene's grid gets built after the BSP traversal.
 	vpIndex = screen->mViewpoints->SetViewpoint(state, &VPUniforms);
 }
 
@@ -422,8 +426,9 @@ HWPortal * HWDrawInfo::FindPortal(const void * src)
 
 HWDecal *HWDrawInfo::AddDecal(bool onmirror)
 {
-	auto decal = (HWDecal*)RenderDataAllocator.Alloc(sizeof(HWDecal));
-	Decals[onmirror ? 1 : 0].Push(decal);
+	auto decal = (HWDecal*)AllocRenderData(sizeof(HWDecal));
+	auto decals = CurrentDrawSink ? CurrentDrawSink->Decals : Decals;
+	decals[onmirror ? 1 : 0].Push(decal);
 	return decal;
 }
 
@@ -461,6 +466,8 @@ void HWDrawInfo::CreateScene(bool drawpsprites)
 	HandleHackedSubsectors();	// open sector hacks for deep water
 	PrepareUnhandledMissingTextures();
 	DispatchRenderHacks();
+	CreateSpriteVertices();
+	BuildLightGrid(*screen->RenderState());
 	screen->mLights->Unmap();
 	screen->mBones->Unmap();
 	screen->mVertexData->Unmap();
@@ -489,11 +496,11 @@ void HWDrawInfo::RenderScene(FRenderState &state)
 
 	if (gl_sort_textures)
 	{
-		drawlists[GLDL_PLAINWALLS].SortWalls();
-		drawlists[GLDL_PLAINFLATS].SortFlats();
-		drawlists[GLDL_MASKEDWALLS].SortWalls();
-		drawlists[GLDL_MASKEDFLATS].SortFlats();
-		drawlists[GLDL_MASKEDWALLSOFS].SortWalls();
+		drawlists[GLDL_PLAINWALLS].SortWalls(this);
+		drawlists[GLDL_PLAINFLATS].SortFlats(this);
+		drawlists[GLDL_MASKEDWALLS].SortWalls(this);
+		drawlists[GLDL_MASKEDFLATS].SortFlats(this);
+		drawlists[GLDL_MASKEDWALLSOFS].SortWalls(this);
 	}
 
 	// Part 1: solid geometry. This is set up so that there are no transparent parts
@@ -877,6 +884,7 @@ void HWDrawInfo::ProcessScene(bool toscreen)
 
 void HWDrawInfo::AddSubsectorToPortal(FSectorPortalGroup *ptg, subsector_t *sub)
 {
+	std::lock_guard<std::mutex> lock(SharedStateLock);
 	auto portal = FindPortal(ptg);
 	if (!portal)
 	{
@@ -885,5 +893,6 @@ void HWDrawInfo::AddSubsectorToPortal(FSectorPortalGroup *ptg, subsector_t *sub)
 	}
     auto ptl = static_cast<HWSectorStackPortal*>(portal);
 	ptl->AddSubsector(sub);
+	ptl->Sequence = min(ptl->Sequence, GetBSPJobSequence());
 }
 
@@ -2,6 +2,7 @@
 
 #include <atomic>
 #include <functional>
+#include <mutex>
 #include "vectors.h"
 #include "r_defs.h"
 #include "r_utility.h"
@@ -24,6 +25,7 @@ struct FFlatVertex;
 class HWWall;
 class HWFlat;
 class HWSprite;
+class HWOcclusionBuffer;
 struct HWDecal;
 class IShadowMap;
 struct particle_t;
@@ -95,6 +97,27 @@ enum DrawListType
 	GLDL_TYPES,
 };
 
+//==========================================================================
+//
+// Receives the output of one BSP worker thread. Every draw item is tagged
+// with the BSP job that produced it, and once all workers are done the
+// sinks get merged by that, so that the draw lists keep the traversal's
+// front to back order regardless of which worker got which job.
+//
+//==========================================================================
+
+struct HWDrawSink
+{
+	HWDrawList drawlists[GLDL_TYPES];
+	TArray<int> Sequence[GLDL_TYPES];	// job sequence of each draw item
+	TArray<HWDecal *> Decals[2];
+	FMemArena *RenderData = nullptr;
+	int rendered_lines = 0;
+};
+
+extern thread_local HWDrawSink *CurrentDrawSink;	// only set on BSP worker threads.
+int GetBSPJobSequence();	// position of the current work in BSP order, for restoring it after multithreaded processing.
+
 
 struct HWDrawInfo
 {
@@ -146,6 +169,7 @@ struct HWDrawInfo
 	HWPortal *mCurrentPortal;
 	//FRotator mAngles;
 	Clipper *mClipper;
+	HWOcclusionBuffer *mOcclusion;
 	FRenderViewpoint Viewpoint;
 	HWViewpointUniforms VPUniforms;	// per-viewpoint uniform state
 	TArray<HWPortal *> Portals;
@@ -181,6 +205,7 @@ struct HWDrawInfo
 	area_t	in_area;
 	fixed_t viewx, viewy;	// since the nodes are still fixed point, keeping the view position  also fixed point for node traversal is faster.
 	bool multithread;
+	std::mutex SharedStateLock;	// guards portals, missing textures and actor access while several BSP workers are active.
 
 private:
     // For ProcessLowerMiniseg
@@ -191,7 +216,14 @@ private:
 	subsector_t *currentsubsector;	// used by the line processing code.
 	sector_t *currentsector;
 
-	void WorkerThread();
+	void WorkerThread(int worker);
+	void MergeDrawSinks(int count);
+	void SortPortals(unsigned first);
+
+	HWDrawList &GetDrawList(int list)
+	{
+		return CurrentDrawSink ? CurrentDrawSink->drawlists[list] : drawlists[list];
+	}
 
 	void UnclipSubsector(subsector_t *sub);
 	
@@ -200,12 +232,18 @@ private:
 	void RenderPolyBSPNode(void *node);
 	void AddPolyobjs(subsector_t *sub);
 	void AddLines(subsector_t * sub, sector_t * sector);
+	void MarkOccludedLines(subsector_t * sub);
 	void AddSpecialPortalLines(subsector_t * sub, sector_t * sector, linebase_t *line);
 	public:
 	void RenderThings(subsector_t * sub, sector_t * sector);
 	void RenderParticles(subsector_t *sub, sector_t *front);
 	void DoSubsector(subsector_t * sub);
+	void AddOccluders(seg_t *seg, sector_t *front, sector_t *back);
+	bool IsSubsectorOccluded(subsector_t *sub, sector_t *sector);
+	void CullOccludedSprites();
 	int SetupLightsForOtherPlane(subsector_t * sub, FDynLightData &lightdata, const secplane_t *plane);
+	void BuildLightGrid(FRenderState &state);
+	void CreateSpriteVertices();
 	int CreateOtherPlaneVertices(subsector_t *sub, const secplane_t *plane);
 	void DrawPSprite(HUDSprite *huds, FRenderState &state);
 	WeaponLighting GetWeaponLighting(sector_t *viewsector, const DVector3 &pos, int cm, area_t in_area, const DVector3 &playerpos);
@@ -321,6 +359,7 @@ public:
 };
 
 void CleanSWDrawer();
+void SkipSWDrawerFrame();
 sector_t* RenderViewpoint(FRenderViewpoint& mainvp, AActor* camera, IntRect* bounds, float fov, float ratio, float fovratio, bool mainview, bool toscreen);
 void WriteSavePic(player_t* player, FileWriter* file, int width, int height);
 sector_t* RenderView(player_t* player);
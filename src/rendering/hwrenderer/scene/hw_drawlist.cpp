@@ -32,6 +32,7 @@
 #include "g_levellocals.h"
 #include "hwrenderer/scene/hw_drawstructs.h"
 #include "hwrenderer/scene/hw_drawlist.h"
+#include "radixsort.h"
 #include "flatvertices.h"
 #include "hw_clock.h"
 #include "hw_renderstate.h"
@@ -40,10 +41,23 @@
 #include "hw_walldispatcher.h"
 
 FMemArena RenderDataAllocator(1024*1024);	// Use large blocks to reduce allocation time.
+thread_local FMemArena *ThreadRenderDataAllocator;
+static TDeletingArray<FMemArena *> WorkerRenderDataAllocators;
 
 void ResetRenderDataAllocator()
 {
 	RenderDataAllocator.FreeAll();
+	for (auto arena : WorkerRenderDataAllocators) arena->FreeAll();
+}
+
+// Must be called from the main thread before the worker gets started.
+FMemArena *GetWorkerRenderDataAllocator(int worker)
+{
+	while (WorkerRenderDataAllocators.Size() <= (unsigned)worker)
+	{
+		WorkerRenderDataAllocators.Push(new FMemArena(1024 * 1024));
+	}
+	return WorkerRenderDataAllocators[worker];
 }
 
 //==========================================================================
@@ -364,6 +378,10 @@ void HWDrawList::SortSpriteIntoPlane(SortNode * head, SortNode * sort)
 				s->z1 = ss->z2 = fh->z;
 				s->vt = ss->vb = newtexv;
 			}
+			if (screen->BuffersArePersistent())
+			{
+				s->vertexindex = ss->vertexindex = -1;
+			}
 		}
 
 		SortNode * sort2 = SortNodes.GetNew();
@@ -610,27 +628,32 @@ inline int HWDrawList::CompareSprites(SortNode * a,SortNode * b)
 SortNode * HWDrawList::SortSpriteList(SortNode * head)
 {
 	SortNode * n;
-	int count;
 	unsigned i;
 
-	static TArray<SortNode*> sortspritelist;
+	static TArray<FRadixSortItem<uint64_t, SortNode*>> sortspritelist, sorttemp;
 
 	SortNode * parent=head->parent;
 
+	// Same order as CompareSprites: farthest first, then by index.
 	sortspritelist.Clear();
-	for(count=0,n=head;n;n=n->next) sortspritelist.Push(n);
-	std::stable_sort(sortspritelist.begin(), sortspritelist.end(), [=](SortNode *a, SortNode *b)
+	for(n=head;n;n=n->next)
 	{
-		return CompareSprites(a, b) < 0;
-	});
+		HWSprite * ss = sprites[drawitems[n->itemindex].index];
+		uint32_t index = uint32_t(ss->index) ^ 0x80000000u;
+		if (reverseSort) index = ~index;
+		sortspritelist.Push({ (uint64_t(~RadixFloatKey(ss->depth)) << 32) | index, n });
+	}
+	sorttemp.Resize(sortspritelist.Size());
+	RadixSort(&sortspritelist[0], &sorttemp[0], sortspritelist.Size());
 
 	for(i=0;i<sortspritelist.Size();i++)
 	{
-		sortspritelist[i]->next=NULL;
-		if (parent) parent->equal=sortspritelist[i];
-		parent=sortspritelist[i];
+		n = sortspritelist[i].Item;
+		n->next=NULL;
+		if (parent) parent->equal=n;
+		parent=n;
 	}
-	return sortspritelist[0];
+	return sortspritelist[0].Item;
 }
 
 //==========================================================================
@@ -721,36 +744,83 @@ void HWDrawList::Sort(HWDrawInfo *di)
 
 //==========================================================================
 //
-// Sorting the drawitems first by texture and then by light level
+// Opaque geometry is sorted by a packed key so that items sharing a shader
+// and a material end up next to each other. Items with the same state are
+// drawn front to back to help the depth test. Walls and flats never use a
+// translation so there is no field for it.
+//
+// 63-56: shader index
+// 55-32: texture
+// 31-28: clamp mode, glow and dynamic lights
+// 15-0:  distance to the view point in steps of 16 map units
 //
 //==========================================================================
 
-void HWDrawList::SortWalls()
+static uint64_t MakeStateKey(FGameTexture *tex, unsigned lightbits, float dist)
 {
-	if (drawitems.Size() > 1)
+	uint64_t key = 0;
+	if (tex != nullptr)
 	{
-		std::sort(drawitems.begin(), drawitems.end(), [=](const HWDrawItem &a, const HWDrawItem &b) -> bool
-		{
-			HWWall * w1 = walls[a.index];
-			HWWall * w2 = walls[b.index];
+		key |= uint64_t(clamp<int>(tex->GetShaderIndex(), 0, 255)) << 56;
+		key |= uint64_t(tex->GetID().GetIndex() & 0xffffff) << 32;
+	}
+	key |= uint64_t(lightbits & 15) << 28;
+	key |= uint64_t(clamp<int>(int(dist * (1.f / 16)), 0, 0xffff));
+	return key;
+}
 
-			if (w1->texture != w2->texture) return w1->texture < w2->texture;
-			return (w1->flags & 3) < (w2->flags & 3);
+static TArray<FRadixSortItem<uint64_t, HWDrawItem>> statesortlist, statesorttemp;
 
-		});
+static void SortByStateKey(TArray<HWDrawItem> &drawitems)
+{
+	statesorttemp.Resize(statesortlist.Size());
+	RadixSort(&statesortlist[0], &statesorttemp[0], statesortlist.Size());
+	for (unsigned i = 0; i < drawitems.Size(); i++)
+	{
+		drawitems[i] = statesortlist[i].Item;
 	}
 }
 
-void HWDrawList::SortFlats()
+void HWDrawList::SortWalls(HWDrawInfo *di)
 {
 	if (drawitems.Size() > 1)
 	{
-		std::sort(drawitems.begin(), drawitems.end(), [=](const HWDrawItem &a, const HWDrawItem &b)
+		FVector2 view((float)di->Viewpoint.Pos.X, (float)di->Viewpoint.Pos.Y);
+		statesortlist.Resize(drawitems.Size());
+		for (unsigned i = 0; i < drawitems.Size(); i++)
 		{
-			HWFlat * w1 = flats[a.index];
-			HWFlat* w2 = flats[b.index];
-			return w1->texture < w2->texture;
-		});
+			HWWall *w = walls[drawitems[i].index];
+			FVector2 center((w->glseg.x1 + w->glseg.x2) * 0.5f, (w->glseg.y1 + w->glseg.y2) * 0.5f);
+			unsigned lightbits = ((w->flags & 3) << 2) | ((w->flags & HWWall::HWF_GLOW) ? 2 : 0) | (w->dynlightindex >= 0 ? 1 : 0);
+			statesortlist[i] = { MakeStateKey(w->texture, lightbits, (center - view).Length()), drawitems[i] };
+		}
+		SortByStateKey(drawitems);
+	}
+}
+
+void HWDrawList::SortFlats(HWDrawInfo *di)
+{
+	if (drawitems.Size() > 1)
+	{
+		FVector2 view((float)di->Viewpoint.Pos.X, (float)di->Viewpoint.Pos.Y);
+		statesortlist.Resize(drawitems.Size());
+		for (unsigned i = 0; i < drawitems.Size(); i++)
+		{
+			HWFlat *f = flats[drawitems[i].index];
+			FVector2 center;
+			if (f->section != nullptr)
+			{
+				auto &bounds = f->section->bounds;
+				center = { float(bounds.left + bounds.right) * 0.5f, float(bounds.top + bounds.bottom) * 0.5f };
+			}
+			else
+			{
+				// render hack flats have no section.
+				center = { (float)f->sector->centerspot.X, (float)f->sector->centerspot.Y };
+			}
+			statesortlist[i] = { MakeStateKey(f->texture, f->dynlightindex >= 0 ? 1 : 0, (center - view).Length()), drawitems[i] };
+		}
+		SortByStateKey(drawitems);
 	}
 }
 
@@ -763,7 +833,7 @@ void HWDrawList::SortFlats()
 
 HWWall *HWDrawList::NewWall()
 {
-	auto wall = (HWWall*)RenderDataAllocator.Alloc(sizeof(HWWall));
+	auto wall = (HWWall*)AllocRenderData(sizeof(HWWall));
 	drawitems.Push(HWDrawItem(DrawType_WALL, walls.Push(wall)));
 	return wall;
 }
@@ -775,7 +845,7 @@ HWWall *HWDrawList::NewWall()
 //==========================================================================
 HWFlat *HWDrawList::NewFlat()
 {
-	auto flat = (HWFlat*)RenderDataAllocator.Alloc(sizeof(HWFlat));
+	auto flat = (HWFlat*)AllocRenderData(sizeof(HWFlat));
 	drawitems.Push(HWDrawItem(DrawType_FLAT,flats.Push(flat)));
 	return flat;
 }
@@ -787,11 +857,47 @@ HWFlat *HWDrawList::NewFlat()
 //==========================================================================
 HWSprite *HWDrawList::NewSprite()
 {	
-	auto sprite = (HWSprite*)RenderDataAllocator.Alloc(sizeof(HWSprite));
+	auto sprite = (HWSprite*)AllocRenderData(sizeof(HWSprite));
 	drawitems.Push(HWDrawItem(DrawType_SPRITE, sprites.Push(sprite)));
 	return sprite;
 }
 
+//==========================================================================
+//
+// Moves all items of another list to the end of this one.
+//
+//==========================================================================
+
+void HWDrawList::Append(HWDrawList &other)
+{
+	drawitems.Grow(other.drawitems.Size());
+	for (unsigned i = 0; i < other.drawitems.Size(); i++)
+	{
+		AppendItem(other, i);
+	}
+	other.Reset();
+}
+
+// Copies a single item from the other list. The other list is left as it is.
+void HWDrawList::AppendItem(HWDrawList &other, unsigned index)
+{
+	auto &item = other.drawitems[index];
+	switch (item.rendertype)
+	{
+	case DrawType_WALL:
+		drawitems.Push(HWDrawItem(DrawType_WALL, walls.Push(other.walls[item.index])));
+		break;
+
+	case DrawType_FLAT:
+		drawitems.Push(HWDrawItem(DrawType_FLAT, flats.Push(other.flats[item.index])));
+		break;
+
+	case DrawType_SPRITE:
+		drawitems.Push(HWDrawItem(DrawType_SPRITE, sprites.Push(other.sprites[item.index])));
+		break;
+	}
+}
+
 //==========================================================================
 //
 //
@@ -3,7 +3,14 @@
 #include "memarena.h"
 
 extern FMemArena RenderDataAllocator;
+extern thread_local FMemArena *ThreadRenderDataAllocator;	// set on the BSP worker threads so that they do not share one arena.
 void ResetRenderDataAllocator();
+FMemArena *GetWorkerRenderDataAllocator(int worker);
+
+inline void *AllocRenderData(size_t size)
+{
+	return (ThreadRenderDataAllocator ? ThreadRenderDataAllocator : &RenderDataAllocator)->Alloc(size);
+}
 struct HWDrawInfo;
 class HWWall;
 class HWFlat;
@@ -91,9 +98,11 @@ public:
 	HWWall *NewWall();
 	HWFlat *NewFlat();
 	HWSprite *NewSprite();
+	void Append(HWDrawList &other);
+	void AppendItem(HWDrawList &other, unsigned index);
 	void Reset();
-	void SortWalls();
-	void SortFlats();
+	void SortWalls(HWDrawInfo *di);
+	void SortFlats(HWDrawInfo *di);
 	
 	
 	void MakeSortList();
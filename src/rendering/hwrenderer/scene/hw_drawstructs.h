@@ -394,13 +394,26 @@ public:
 	DRotator Angles;
 
 
+	// How CalculateVertices transforms the sprite. Only the billboards can be batched.
+	enum EBillboard
+	{
+		BILLBOARD_Upright,
+		BILLBOARD_XY,
+		BILLBOARD_XYFaceCamera,
+		BILLBOARD_Other
+	};
+
 	void SplitSprite(HWDrawInfo *di, sector_t * frontsector, bool translucent);
 	void PerformSpriteClipAdjustment(AActor *thing, const DVector2 &thingpos, float spriteheight);
+	bool UseXYBillboard() const;
+	bool BillboardFacesCamera() const;
+	EBillboard GetBillboard() const;
 	bool CalculateVertices(HWDrawInfo *di, FVector3 *v, DVector3 *vp);
 
 public:
 
 	void CreateVertices(HWDrawInfo *di);
+	void CreateVertices(HWDrawInfo *di, FFlatVertex *vp, unsigned int index);
 	void PutSprite(HWDrawInfo *di, bool translucent);
 	void Process(HWDrawInfo *di, AActor* thing,sector_t * sector, area_t in_area, int thruportal = false, bool isSpriteShadow = false);
 	void ProcessParticle(HWDrawInfo *di, particle_t *particle, sector_t *sector, class DVisualThinker *spr);//, int shade, int fakeside)
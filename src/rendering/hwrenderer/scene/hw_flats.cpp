@@ -157,6 +157,11 @@ void HWFlat::SetupLights(HWDrawInfo *di, FLightNode * node, FDynLightData &light
 		dynlightindex = -1;
 		return;	// no lights on additively blended surfaces.
 	}
+	if (di->VPUniforms.mLightGridIndex >= 0)
+	{
+		dynlightindex = di->VPUniforms.mLightGridIndex;
+		return;
+	}
 	while (node)
 	{
 		FDynamicLight * light = node->lightsource;
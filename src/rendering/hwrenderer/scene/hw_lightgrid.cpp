@@ -0,0 +1,383 @@
+/*
+** hw_lightgrid.cpp
+** Clustered light grid for the dynamic lights of a scene
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 GZDoom Maintainers and Contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+*/
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+#include <future>
+#ifndef NO_SSE
+#include <immintrin.h>
+#endif
+#include "c_cvars.h"
+#include "stats.h"
+#include "ctpl.h"
+#include "g_levellocals.h"
+#include "a_dynlight.h"
+#include "v_video.h"
+#include "hw_lightbuffer.h"
+#include "hw_viewpointbuffer.h"
+#include "hwrenderer/scene/hw_drawinfo.h"
+#include "hwrenderer/scene/hw_drawstructs.h"
+#include "hw_lightgrid.h"
+
+CVAR(Bool, gl_light_grid, false, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+
+extern ctpl::thread_pool renderPool;
+
+HWLightGrid lightGrid;
+static cycle_t LightGridTime;
+
+// The last slice catches everything beyond FarZ.
+static const float MaxDepth = 1000000.f;
+
+// Below this the culling is not worth handing out to the workers.
+static const int MinThreadedLights = 64;
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+float HWLightGrid::GetSliceScale() const
+{
+	return Slices / logf(FarZ / NearZ);
+}
+
+static inline int SliceForDepth(float depth, float scale)
+{
+	if (depth <= HWLightGrid::NearZ) return 0;
+	return min(int(logf(depth / HWLightGrid::NearZ) * scale), (int)HWLightGrid::Slices - 1);
+}
+
+//==========================================================================
+//
+// Only lights that touch a section the BSP traversal rendered can reach
+// anything visible. The lights are grouped by type because the shaders
+// expect the modulated, subtractive and additive lights in that order.
+//
+//==========================================================================
+
+void HWLightGrid::CollectLights(HWDrawInfo *di)
+{
+	auto Level = di->Level;
+	int count = 0;
+
+	for (auto &list : lights) list.Clear();
+
+	for (auto light = Level->lights; light && count < MaxLights; light = light->next)
+	{
+		if (!light->IsActive() || light->DontLightMap() || light->GetRadius() <= 0.f) continue;
+
+		FSection *section = nullptr;
+		for (auto node = light->touching_sector; node; node = node->nextTarget)
+		{
+			auto sect = (FSection *)node->targ;
+			if (di->section_renderflags[Level->sections.SectionIndex(sect)] & SSRF_PROCESSED)
+			{
+				section = sect;
+				break;
+			}
+		}
+		if (section == nullptr) continue;
+
+		int type = light->IsSubtractive() ? 1 : light->IsAdditive() ? 2 : 0;
+		lights[type].Push({ light, section->sector->PortalGroup });
+		count++;
+	}
+}
+
+//==========================================================================
+//
+// The cluster bounds only depend on the projection.
+// With z = -depth a point projects to ndc.x = x * m[0] / depth - m[8].
+//
+//==========================================================================
+
+void HWLightGrid::CalcClusterBounds(const VSMatrix &projection)
+{
+	auto m = projection.get();
+	float scale = GetSliceScale();
+
+	for (int s = 0; s < Slices; s++)
+	{
+		float d0 = s == 0 ? 0.f : NearZ * expf(s / scale);
+		float d1 = s == Slices - 1 ? MaxDepth : NearZ * expf((s + 1) / scale);
+		slicenear[s] = d0;
+		slicefar[s] = d1;
+
+		auto setbounds = [&](float *mins, float *maxs, int count, float skew, float factor)
+		{
+			for (int t = 0; t < count; t++)
+			{
+				float n0 = -1.f + 2.f * t / count + skew;
+				float n1 = -1.f + 2.f * (t + 1) / count + skew;
+				float a = d0 * n0 / factor, b = d1 * n0 / factor, c = d0 * n1 / factor, d = d1 * n1 / factor;
+				mins[t] = min(min(a, b), min(c, d));
+				maxs[t] = max(max(a, b), max(c, d));
+			}
+		};
+		setbounds(tileminx[s], tilemaxx[s], TilesX, (float)m[8], (float)m[0]);
+		setbounds(tileminy[s], tilemaxy[s], TilesY, (float)m[9], (float)m[5]);
+	}
+}
+
+//==========================================================================
+//
+// Sets the mask bit of every cluster in the given slices that a light's
+// sphere touches. Each slice is only ever written by one thread.
+//
+//==========================================================================
+
+void HWLightGrid::CullSlices(int first, int last)
+{
+	float scale = GetSliceScale();
+
+	for (unsigned k = 0; k < spheres.Size(); k++)
+	{
+		const LightSphere &sphere = spheres[k];
+		float depth = -sphere.Z;
+		float r2 = sphere.Radius * sphere.Radius;
+		if (depth + sphere.Radius <= 0.f) continue;
+
+		int s0 = max(SliceForDepth(depth - sphere.Radius, scale), first);
+		int s1 = min(SliceForDepth(depth + sphere.Radius, scale), last);
+		uint32_t bit = 1u << (k & 31);
+		uint32_t *lightmask = &masks[k >> 5];
+
+		for (int s = s0; s <= s1; s++)
+		{
+			float dz = max(max(slicenear[s] - depth, depth - slicefar[s]), 0.f);
+			float remz = r2 - dz * dz;
+			if (remz < 0.f) continue;
+
+			for (int ty = 0; ty < TilesY; ty++)
+			{
+				float dy = max(max(tileminy[s][ty] - sphere.Y, sphere.Y - tilemaxy[s][ty]), 0.f);
+				float rem = remz - dy * dy;
+				if (rem < 0.f) continue;
+
+				uint32_t *clustermask = lightmask + ((s * TilesY + ty) * TilesX) * maskwords;
+#ifndef NO_SSE
+				__m128 cx = _mm_set1_ps(sphere.X);
+				__m128 limit = _mm_set1_ps(rem);
+				__m128 zero = _mm_setzero_ps();
+				for (int tx = 0; tx < TilesX; tx += 4)
+				{
+					__m128 mins = _mm_loadu_ps(&tileminx[s][tx]);
+					__m128 maxs = _mm_loadu_ps(&tilemaxx[s][tx]);
+					__m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(mins, cx), _mm_sub_ps(cx, maxs)), zero);
+					int hits = _mm_movemask_ps(_mm_cmple_ps(_mm_mul_ps(dx, dx), limit));
+					for (int i = 0; hits; i++, hits >>= 1)
+					{
+						if (hits & 1) clustermask[(tx + i) * maskwords] |= bit;
+					}
+				}
+#else
+				for (int tx = 0; tx < TilesX; tx++)
+				{
+					float dx = max(max(tileminx[s][tx] - sphere.X, sphere.X - tilemaxx[s][tx]), 0.f);
+					if (dx * dx <= rem) clustermask[tx * maskwords] |= bit;
+				}
+#endif
+			}
+		}
+	}
+}
+
+//==========================================================================
+//
+// Turns the masks into the light lists and packs everything into the
+// layout described in the header.
+//
+//==========================================================================
+
+void HWLightGrid::WriteGrid()
+{
+	unsigned firstsub = lights[0].Size();
+	unsigned firstadd = firstsub + lights[1].Size();
+
+	entries.Clear();
+	griddata.Resize(NumClusters * 4);
+	for (int c = 0; c < NumClusters; c++)
+	{
+		int start = entries.Size();
+		int counts[3] = {};
+		const uint32_t *mask = &masks[c * maskwords];
+		for (int w = 0; w < maskwords; w++)
+		{
+			uint32_t bits = mask[w];
+			for (unsigned k = w * 32; bits; k++, bits >>= 1)
+			{
+				if (bits & 1)
+				{
+					entries.Push(k);
+					counts[(k >= firstsub) + (k >= firstadd)]++;
+				}
+			}
+		}
+		float *header = &griddata[c * 4];
+		header[0] = float(NumClusters * 4 + start);
+		header[1] = float(counts[0]);
+		header[2] = float(counts[0] + counts[1]);
+		header[3] = float(counts[0] + counts[1] + counts[2]);
+	}
+
+	// Everything is addressed in vec4s relative to the start of the grid.
+	unsigned listsize = (entries.Size() + 3) / 4;
+	int lightstart = NumClusters + listsize;
+	griddata.Resize((NumClusters + listsize) * 4);
+	for (unsigned i = 0; i < entries.Size(); i++)
+	{
+		griddata[NumClusters * 4 + i] = float(lightstart + entries[i] * 4);
+	}
+	for (unsigned i = entries.Size(); i < listsize * 4; i++)
+	{
+		griddata[NumClusters * 4 + i] = 0.f;
+	}
+	for (auto &data : lightdata.arrays)
+	{
+		griddata.Append(data);
+	}
+	gridentries += entries.Size();
+}
+
+//==========================================================================
+//
+// Returns the light buffer index of the grid, or -1 if there is nothing
+// to light or the grid does not fit.
+//
+//==========================================================================
+
+int HWLightGrid::Build(HWDrawInfo *di)
+{
+	CollectLights(di);
+	int numlights = lights[0].Size() + lights[1].Size() + lights[2].Size();
+	if (numlights == 0) return -1;
+
+	auto view = di->VPUniforms.mViewMatrix.get();
+	// The view matrix stretches y by the level's pixel ratio so the spheres must grow accordingly.
+	float stretch = max(1.f, fabsf((float)di->Level->info->pixelstretch));
+
+	lightdata.Clear();
+	spheres.Clear();
+	for (auto &list : lights)
+	{
+		for (auto &gl : list)
+		{
+			DVector3 pos = gl.light->PosRelative(gl.portalgroup);
+			float x = (float)pos.X, y = (float)pos.Z, z = (float)pos.Y;
+			LightSphere sphere;
+			sphere.X = float(view[0] * x + view[4] * y + view[8] * z + view[12]);
+			sphere.Y = float(view[1] * x + view[5] * y + view[9] * z + view[13]);
+			sphere.Z = float(view[2] * x + view[6] * y + view[10] * z + view[14]);
+			sphere.Radius = gl.light->GetRadius() * stretch;
+			spheres.Push(sphere);
+			AddLightToList(lightdata, gl.portalgroup, gl.light, false);
+		}
+	}
+
+	CalcClusterBounds(di->VPUniforms.mProjectionMatrix);
+	maskwords = (numlights + 31) / 32;
+	masks.Resize(NumClusters * maskwords);
+	memset(masks.Data(), 0, masks.Size() * sizeof(uint32_t));
+
+	int numthreads = numlights >= MinThreadedLights ? min((int)renderPool.size() + 1, 4) : 1;
+	if (numthreads > 1)
+	{
+		std::future<void> futures[3];
+		int perthread = (Slices + numthreads - 1) / numthreads;
+		for (int i = 1; i < numthreads; i++)
+		{
+			int first = i * perthread, last = min(first + perthread, (int)Slices) - 1;
+			futures[i - 1] = renderPool.push([this, first, last](int id) {
+				CullSlices(first, last);
+			});
+		}
+		CullSlices(0, perthread - 1);
+		for (int i = 1; i < numthreads; i++)
+		{
+			futures[i - 1].wait();
+		}
+	}
+	else
+	{
+		CullSlices(0, Slices - 1);
+	}
+
+	WriteGrid();
+	griddedlights += numlights;
+	return screen->mLights->UploadLightGrid(griddata);
+}
+
+//==========================================================================
+//
+// Builds the light grid of the scene once the BSP traversal found all
+// visible sections. The viewpoint gets uploaded again so that the shaders
+// can find the grid. The grid needs the whole light buffer to be
+// addressable and the lights to be set up at draw time, which is only the
+// case with shader storage buffers and persistent buffers.
+//
+//==========================================================================
+
+void HWDrawInfo::BuildLightGrid(FRenderState &state)
+{
+	VPUniforms.mLightGridIndex = -1;
+	if (!gl_light_grid || !screen->useSSBO() || !screen->BuffersArePersistent() || !Level->HasDynamicLights || isFullbrightScene())
+	{
+		return;
+	}
+
+	LightGridTime.Clock();
+	int index = lightGrid.Build(this);
+	LightGridTime.Unclock();
+	if (index < 0) return;
+
+	VPUniforms.mLightGridIndex = index;
+	VPUniforms.mLightGridWidth = HWLightGrid::TilesX;
+	VPUniforms.mLightGridHeight = HWLightGrid::TilesY;
+	VPUniforms.mLightGridSlices = HWLightGrid::Slices;
+	VPUniforms.mLightGridNear = HWLightGrid::NearZ;
+	VPUniforms.mLightGridScale = lightGrid.GetSliceScale();
+	vpIndex = screen->mViewpoints->SetViewpoint(state, &VPUniforms);
+}
+
+ADD_STAT(lightgrid)
+{
+	FString out;
+	out.Format("Light grid: lights=%d, entries=%d, time=%2.3f ms", lightGrid.griddedlights, lightGrid.gridentries, LightGridTime.TimeMS());
+	lightGrid.griddedlights = lightGrid.gridentries = 0;
+	LightGridTime.Reset();
+	return out;
+}
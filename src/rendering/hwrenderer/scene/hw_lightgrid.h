@@ -0,0 +1,109 @@
+/*
+** hw_lightgrid.h
+** Clustered light grid for the dynamic lights of a scene
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 GZDoom Maintainers and Contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+*/
+#pragma once
+
+#include "tarray.h"
+#include "hw_dynlightdata.h"
+
+struct HWDrawInfo;
+struct FDynamicLight;
+class VSMatrix;
+
+//==========================================================================
+//
+// Splits the view frustum into clusters of screen tiles and exponential
+// depth slices and stores which of the scene's dynamic lights reach each
+// cluster. Walls and flats then look up their lights per fragment instead
+// of collecting and uploading a list for every surface.
+//
+// The grid gets stored in the light buffer as one block:
+// one header per cluster with the start of its light list and the end of
+// the modulated, subtractive and additive lights, followed by the lists
+// (4 entries per vec4) and the data of all lights in the grid.
+//
+//==========================================================================
+
+class HWLightGrid
+{
+public:
+	enum
+	{
+		TilesX = 16,		// must be a multiple of 4
+		TilesY = 8,
+		Slices = 24,
+		NumClusters = TilesX * TilesY * Slices,
+		MaxLights = 1024,
+	};
+
+	static constexpr float NearZ = 4.f;
+	static constexpr float FarZ = 8192.f;
+
+	int griddedlights = 0;
+	int gridentries = 0;
+
+	int Build(HWDrawInfo *di);
+	float GetSliceScale() const;
+
+private:
+	struct GridLight
+	{
+		FDynamicLight *light;
+		int portalgroup;
+	};
+
+	struct LightSphere
+	{
+		float X, Y, Z, Radius;
+	};
+
+	TArray<GridLight> lights[3];
+	TArray<LightSphere> spheres;
+	TArray<uint32_t> masks;
+	TArray<int> entries;
+	TArray<float> griddata;
+	FDynLightData lightdata;
+	int maskwords = 0;
+
+	// View space bounds of the clusters.
+	float tileminx[Slices][TilesX], tilemaxx[Slices][TilesX];
+	float tileminy[Slices][TilesY], tilemaxy[Slices][TilesY];
+	float slicenear[Slices], slicefar[Slices];
+
+	void CollectLights(HWDrawInfo *di);
+	void CalcClusterBounds(const VSMatrix &projection);
+	void CullSlices(int first, int last);
+	void WriteGrid();
+};
+
+extern HWLightGrid lightGrid;
@@ -0,0 +1,475 @@
+/*
+** hw_occlusion.cpp
+** Low resolution depth buffer for culling hidden parts of the scene
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 GZDoom Maintainers and Contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+*/
+
+#include <float.h>
+#include <string.h>
+#ifndef NO_SSE
+#include <immintrin.h>
+#endif
+#include "c_cvars.h"
+#include "stats.h"
+#include "r_defs.h"
+#include "r_sky.h"
+#include "r_state.h"
+#include "p_lnspec.h"
+#include "g_levellocals.h"
+#include "actor.h"
+#include "texturemanager.h"
+#include "hwrenderer/scene/hw_drawinfo.h"
+#include "hwrenderer/scene/hw_drawstructs.h"
+#include "hw_occlusion.h"
+
+CVAR(Bool, gl_occlusion, false, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+
+HWOcclusionBuffer occlusionBuffer;
+
+// Anything closer to the view than this cannot be projected reliably.
+static const float NearW = 1.f;
+
+//==========================================================================
+//
+// Picks up the view and projection of the scene that is about to be
+// traversed and clears the buffer.
+//
+//==========================================================================
+
+void HWOcclusionBuffer::Begin(HWDrawInfo *di)
+{
+	VSMatrix m = di->VPUniforms.mProjectionMatrix;
+	m.multMatrix(di->VPUniforms.mViewMatrix);
+	auto src = m.get();
+	for (int i = 0; i < 16; i++) matrix[i] = (float)src[i];
+
+	height = clamp(Width * viewheight / max(viewwidth, 1), 16, Width * 2);
+	depth.Resize(Width * height);
+	memset(depth.Data(), 0, depth.Size() * sizeof(float));
+}
+
+//==========================================================================
+//
+// Map coordinates to clip space. The hardware renderer swaps y and z.
+//
+//==========================================================================
+
+FVector4 HWOcclusionBuffer::Transform(float x, float y, float z) const
+{
+	const float *m = matrix;
+	return FVector4(
+		m[0] * x + m[4] * z + m[8] * y + m[12],
+		m[1] * x + m[5] * z + m[9] * y + m[13],
+		m[2] * x + m[6] * z + m[10] * y + m[14],
+		m[3] * x + m[7] * z + m[11] * y + m[15]);
+}
+
+//==========================================================================
+//
+// Horizontal extent of a convex polygon at the given height.
+//
+//==========================================================================
+
+void HWOcclusionBuffer::GetSpan(const FVector3 *verts, int count, float y, float &left, float &right) const
+{
+	left = FLT_MAX;
+	right = -FLT_MAX;
+	for (int i = 0; i < count; i++)
+	{
+		const FVector3 &a = verts[i];
+		const FVector3 &b = verts[i + 1 < count ? i + 1 : 0];
+		if (y < min(a.Y, b.Y) || y > max(a.Y, b.Y)) continue;
+
+		if (a.Y == b.Y)
+		{
+			left = min(left, min(a.X, b.X));
+			right = max(right, max(a.X, b.X));
+		}
+		else
+		{
+			float x = a.X + (y - a.Y) * (b.X - a.X) / (b.Y - a.Y);
+			left = min(left, x);
+			right = max(right, x);
+		}
+	}
+}
+
+//==========================================================================
+//
+// The span functions process 4 pixels at once when SSE is available.
+//
+//==========================================================================
+
+void HWOcclusionBuffer::FillSpan(float *dest, int x1, int x2, float start, float step)
+{
+	int x = x1;
+#ifndef NO_SSE
+	__m128 value = _mm_setr_ps(start, start + step, start + 2 * step, start + 3 * step);
+	__m128 step4 = _mm_set1_ps(step * 4);
+	for (; x + 4 <= x2; x += 4)
+	{
+		_mm_storeu_ps(dest + x, _mm_max_ps(_mm_loadu_ps(dest + x), value));
+		value = _mm_add_ps(value, step4);
+	}
+	start += step * (x - x1);
+#endif
+	for (; x < x2; x++, start += step)
+	{
+		dest[x] = max(dest[x], start);
+	}
+}
+
+bool HWOcclusionBuffer::IsSpanVisible(const float *src, int x1, int x2, float nearest) const
+{
+	int x = x1;
+#ifndef NO_SSE
+	__m128 n4 = _mm_set1_ps(nearest);
+	for (; x + 4 <= x2; x += 4)
+	{
+		if (_mm_movemask_ps(_mm_cmple_ps(_mm_loadu_ps(src + x), n4))) return true;
+	}
+#endif
+	for (; x < x2; x++)
+	{
+		if (src[x] <= nearest) return true;
+	}
+	return false;
+}
+
+//==========================================================================
+//
+// Draws a convex polygon given in clip space. Only pixels that are
+// covered completely get written, and each one gets the smallest 1/w
+// the polygon has inside it.
+//
+//==========================================================================
+
+void HWOcclusionBuffer::DrawPolygon(const FVector4 *clipverts, int count)
+{
+	FVector4 clipped[MaxVerts];
+	int n = 0;
+	for (int i = 0; i < count; i++)
+	{
+		const FVector4 &a = clipverts[i];
+		const FVector4 &b = clipverts[i + 1 < count ? i + 1 : 0];
+		bool ina = a.W >= NearW, inb = b.W >= NearW;
+		if (ina) clipped[n++] = a;
+		if (ina != inb) clipped[n++] = a + (b - a) * ((NearW - a.W) / (b.W - a.W));
+	}
+	if (n < 3) return;
+
+	FVector3 verts[MaxVerts];	// screen x, screen y, 1/w
+	float ymin = FLT_MAX, ymax = -FLT_MAX;
+	for (int i = 0; i < n; i++)
+	{
+		float iw = 1.f / clipped[i].W;
+		verts[i].X = (clipped[i].X * iw * 0.5f + 0.5f) * Width;
+		verts[i].Y = (0.5f - clipped[i].Y * iw * 0.5f) * height;
+		verts[i].Z = iw;
+		ymin = min(ymin, verts[i].Y);
+		ymax = max(ymax, verts[i].Y);
+	}
+
+	// 1/w is linear in screen space. Take its gradients from the largest triangle of the fan.
+	float area = 0;
+	int best = 0;
+	for (int i = 1; i < n - 1; i++)
+	{
+		float a = (verts[i].X - verts[0].X) * (verts[i + 1].Y - verts[0].Y) - (verts[i + 1].X - verts[0].X) * (verts[i].Y - verts[0].Y);
+		if (fabs(a) > fabs(area))
+		{
+			area = a;
+			best = i;
+		}
+	}
+	if (fabs(area) < 0.01f) return;
+
+	const FVector3 &p0 = verts[0], &p1 = verts[best], &p2 = verts[best + 1];
+	float dx1 = p1.X - p0.X, dy1 = p1.Y - p0.Y, dz1 = p1.Z - p0.Z;
+	float dx2 = p2.X - p0.X, dy2 = p2.Y - p0.Y, dz2 = p2.Z - p0.Z;
+	float stepx = (dz1 * dy2 - dz2 * dy1) / area;
+	float stepy = (dx1 * dz2 - dx2 * dz1) / area;
+	// value at the pixel's center minus what it can drop towards the pixel's corners.
+	float base = p0.Z + stepx * (0.5f - p0.X) + stepy * (0.5f - p0.Y) - 0.5f * (fabs(stepx) + fabs(stepy));
+
+	int y1 = (int)ceilf(clamp(ymin, 0.f, (float)height));
+	int y2 = (int)floorf(clamp(ymax, 0.f, (float)height));
+	for (int y = y1; y < y2; y++)
+	{
+		float l1, r1, l2, r2;
+		GetSpan(verts, n, (float)y, l1, r1);
+		GetSpan(verts, n, (float)(y + 1), l2, r2);
+		int x1 = (int)ceilf(clamp(max(l1, l2), 0.f, (float)Width));
+		int x2 = (int)floorf(clamp(min(r1, r2), 0.f, (float)Width));
+		if (x1 < x2)
+		{
+			FillSpan(&depth[y * Width], x1, x2, base + stepy * y + stepx * x1, stepx);
+		}
+	}
+}
+
+//==========================================================================
+//
+// Adds a vertical quad. Heights are given for both ends of the wall.
+//
+//==========================================================================
+
+void HWOcclusionBuffer::AddWall(const DVector2 &v1, const DVector2 &v2, float bottom1, float top1, float bottom2, float top2)
+{
+	FVector4 verts[4] =
+	{
+		Transform((float)v1.X, (float)v1.Y, bottom1),
+		Transform((float)v1.X, (float)v1.Y, top1),
+		Transform((float)v2.X, (float)v2.Y, top2),
+		Transform((float)v2.X, (float)v2.Y, bottom2),
+	};
+	DrawPolygon(verts, 4);
+}
+
+//==========================================================================
+//
+// Tests the screen rectangle of a bounding box with the nearest 1/w of
+// its corners. Boxes that reach the near plane are always visible.
+//
+//==========================================================================
+
+bool HWOcclusionBuffer::IsBoxVisible(const FVector3 &mins, const FVector3 &maxs)
+{
+	float xmin = FLT_MAX, xmax = -FLT_MAX, ymin = FLT_MAX, ymax = -FLT_MAX;
+	float nearest = 0;
+	for (int i = 0; i < 8; i++)
+	{
+		FVector4 c = Transform((i & 1) ? maxs.X : mins.X, (i & 2) ? maxs.Y : mins.Y, (i & 4) ? maxs.Z : mins.Z);
+		if (c.W < NearW) return true;
+
+		float iw = 1.f / c.W;
+		float sx = (c.X * iw * 0.5f + 0.5f) * Width;
+		float sy = (0.5f - c.Y * iw * 0.5f) * height;
+		xmin = min(xmin, sx);
+		xmax = max(xmax, sx);
+		ymin = min(ymin, sy);
+		ymax = max(ymax, sy);
+		nearest = max(nearest, iw);
+	}
+
+	int x1 = (int)clamp(floorf(xmin) - 1.f, 0.f, (float)Width);
+	int x2 = (int)clamp(ceilf(xmax) + 1.f, 0.f, (float)Width);
+	int y1 = (int)clamp(floorf(ymin) - 1.f, 0.f, (float)height);
+	int y2 = (int)clamp(ceilf(ymax) + 1.f, 0.f, (float)height);
+	if (x1 >= x2 || y1 >= y2) return true;
+
+	for (int y = y1; y < y2; y++)
+	{
+		if (IsSpanVisible(&depth[y * Width], x1, x2, nearest)) return true;
+	}
+	return false;
+}
+
+//==========================================================================
+//
+// Sprites can be rotated around their origin, so they get tested with a
+// cube that contains them in any orientation. Models are only known by
+// their actor's render radius.
+//
+//==========================================================================
+
+bool HWOcclusionBuffer::IsSpriteVisible(HWSprite *sprite)
+{
+	if (sprite->modelframe != nullptr && sprite->actor != nullptr)
+	{
+		float r = (float)max(sprite->actor->RenderRadius(), sprite->actor->Height);
+		return IsBoxVisible(FVector3(sprite->x - r, sprite->y - r, sprite->z - r), FVector3(sprite->x + r, sprite->y + r, sprite->z + 2 * r));
+	}
+
+	FVector3 center((sprite->x1 + sprite->x2) * 0.5f, (sprite->y1 + sprite->y2) * 0.5f, (sprite->z1 + sprite->z2) * 0.5f);
+	FVector3 extent(sprite->x2 - sprite->x1, sprite->y2 - sprite->y1, sprite->z2 - sprite->z1);
+	float r = extent.Length() + (FVector3(sprite->x, sprite->y, sprite->z) - center).Length();
+	return IsBoxVisible(center - FVector3(r, r, r), center + FVector3(r, r, r));
+}
+
+//==========================================================================
+//
+// Draws the solid parts of a seg that just passed the clipper:
+// one-sided walls, upper and lower textures and the sides of
+// opaque 3D floors in the back sector.
+//
+//==========================================================================
+
+static bool IsSolidTexture(FTextureID texid)
+{
+	auto tex = TexMan.GetGameTexture(texid, true);
+	return tex != nullptr && tex->isValid() && !tex->isMasked();
+}
+
+void HWDrawInfo::AddOccluders(seg_t *seg, sector_t *front, sector_t *back)
+{
+	auto line = seg->linedef;
+	if (line->isVisualPortal() || line->special == Line_Horizon || line->special == Line_Mirror) return;
+
+	DVector2 v1 = seg->v1->fPos(), v2 = seg->v2->fPos();
+	float ff1 = (float)front->floorplane.ZatPoint(v1), ff2 = (float)front->floorplane.ZatPoint(v2);
+	float fc1 = (float)front->ceilingplane.ZatPoint(v1), fc2 = (float)front->ceilingplane.ZatPoint(v2);
+
+	if (back == nullptr)
+	{
+		if (fc1 >= ff1 && fc2 >= ff2) mOcclusion->AddWall(v1, v2, ff1, fc1, ff2, fc2);
+		return;
+	}
+
+	float bf1 = (float)back->floorplane.ZatPoint(v1), bf2 = (float)back->floorplane.ZatPoint(v2);
+	float bc1 = (float)back->ceilingplane.ZatPoint(v1), bc2 = (float)back->ceilingplane.ZatPoint(v2);
+	auto side = seg->sidedef;
+
+	if (front->GetTexture(sector_t::ceiling) != skyflatnum && back->GetTexture(sector_t::ceiling) != skyflatnum && IsSolidTexture(side->GetTexture(side_t::top)))
+	{
+		float b1 = max(bc1, ff1), b2 = max(bc2, ff2);
+		if (b1 <= fc1 && b2 <= fc2 && (b1 < fc1 || b2 < fc2)) mOcclusion->AddWall(v1, v2, b1, fc1, b2, fc2);
+	}
+
+	if (front->GetTexture(sector_t::floor) != skyflatnum && back->GetTexture(sector_t::floor) != skyflatnum && IsSolidTexture(side->GetTexture(side_t::bottom)))
+	{
+		float t1 = min(bf1, fc1), t2 = min(bf2, fc2);
+		if (t1 >= ff1 && t2 >= ff2 && (t1 > ff1 || t2 > ff2)) mOcclusion->AddWall(v1, v2, ff1, t1, ff2, t2);
+	}
+
+	if (front->sectornum == back->sectornum) return;
+
+	float bottom1 = max(ff1, bf1), bottom2 = max(ff2, bf2);
+	float top1 = min(fc1, bc1), top2 = min(fc2, bc2);
+	for (auto rover : back->e->XFloor.ffloors)
+	{
+		if ((rover->flags & (FF_EXISTS | FF_RENDERSIDES)) != (FF_EXISTS | FF_RENDERSIDES)) continue;
+		if (rover->flags & (FF_THISINSIDE | FF_INVERTSIDES | FF_SWIMMABLE | FF_TRANSLUCENT | FF_FOG | FF_ADDITIVETRANS)) continue;
+		if (rover->alpha < 255 || rover->master == nullptr) continue;
+
+		bool shared = false;
+		for (auto frontrover : front->e->XFloor.ffloors)
+		{
+			if (frontrover->model == rover->model) shared = true;
+		}
+		if (shared) continue;
+
+		FTextureID texid = (rover->flags & FF_UPPERTEXTURE) ? side->GetTexture(side_t::top) :
+			(rover->flags & FF_LOWERTEXTURE) ? side->GetTexture(side_t::bottom) : rover->master->sidedef[0]->GetTexture(side_t::mid);
+		if (!IsSolidTexture(texid)) continue;
+
+		float rb1 = max((float)rover->bottom.plane->ZatPoint(v1), bottom1), rb2 = max((float)rover->bottom.plane->ZatPoint(v2), bottom2);
+		float rt1 = min((float)rover->top.plane->ZatPoint(v1), top1), rt2 = min((float)rover->top.plane->ZatPoint(v2), top2);
+		if (rt1 >= rb1 && rt2 >= rb2 && (rt1 > rb1 || rt2 > rb2)) mOcclusion->AddWall(v1, v2, rb1, rt1, rb2, rt2);
+	}
+}
+
+//==========================================================================
+//
+// A subsector is bounded by its segs and by the planes of the sectors on
+// both sides of them. Skies, sector portals and deep water can show
+// things outside these bounds so such subsectors are never culled.
+//
+//==========================================================================
+
+static bool IsBoundedSector(sector_t *sec)
+{
+	for (int plane = sector_t::floor; plane <= sector_t::ceiling; plane++)
+	{
+		if (sec->GetTexture(plane) == skyflatnum || sec->Portals[plane] != 0) return false;
+	}
+	return true;
+}
+
+bool HWDrawInfo::IsSubsectorOccluded(subsector_t *sub, sector_t *sector)
+{
+	if (sub->hacked || sub->sector->GetHeightSec() || !IsBoundedSector(sector)) return false;
+
+	FVector3 mins(FLT_MAX, FLT_MAX, FLT_MAX), maxs(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (uint32_t i = 0; i < sub->numlines; i++)
+	{
+		seg_t *seg = sub->firstline + i;
+		if (seg->linedef && seg->linedef->special == Line_Horizon) return false;
+
+		sector_t *back = seg->backsector;
+		if (back != nullptr && back != sub->sector && (back->GetHeightSec() || !IsBoundedSector(back))) return false;
+
+		for (auto v : { seg->v1, seg->v2 })
+		{
+			DVector2 pos = v->fPos();
+			mins.X = min(mins.X, (float)pos.X);
+			mins.Y = min(mins.Y, (float)pos.Y);
+			maxs.X = max(maxs.X, (float)pos.X);
+			maxs.Y = max(maxs.Y, (float)pos.Y);
+			mins.Z = min(mins.Z, (float)sector->floorplane.ZatPoint(pos));
+			maxs.Z = max(maxs.Z, (float)sector->ceilingplane.ZatPoint(pos));
+			if (back != nullptr)
+			{
+				mins.Z = min(mins.Z, (float)back->floorplane.ZatPoint(pos));
+				maxs.Z = max(maxs.Z, (float)back->ceilingplane.ZatPoint(pos));
+			}
+		}
+	}
+	if (mins.X > maxs.X || mins.Z > maxs.Z) return false;
+
+	if (mOcclusion->IsBoxVisible(mins, maxs)) return false;
+	mOcclusion->culledsubsectors++;
+	return true;
+}
+
+//==========================================================================
+//
+// Sprites are collected for whole sectors and may extend beyond them,
+// so they get tested individually once the buffer is complete.
+//
+//==========================================================================
+
+void HWDrawInfo::CullOccludedSprites()
+{
+	for (auto &list : drawlists)
+	{
+		unsigned count = 0;
+		for (unsigned i = 0; i < list.drawitems.Size(); i++)
+		{
+			auto &item = list.drawitems[i];
+			if (item.rendertype == DrawType_SPRITE && !mOcclusion->IsSpriteVisible(list.sprites[item.index]))
+			{
+				mOcclusion->culledsprites++;
+				continue;
+			}
+			list.drawitems[count++] = item;
+		}
+		list.drawitems.Clamp(count);
+	}
+}
+
+ADD_STAT(occlusion)
+{
+	FString out;
+	out.Format("Occlusion culled: subsectors=%d, sprites=%d", occlusionBuffer.culledsubsectors, occlusionBuffer.culledsprites);
+	occlusionBuffer.culledsubsectors = occlusionBuffer.culledsprites = 0;
+	return out;
+}
@@ -0,0 +1,83 @@
+/*
+** hw_occlusion.h
+** Low resolution depth buffer for culling hidden parts of the scene
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 GZDoom Maintainers and Contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+*/
+#pragma once
+
+#include "tarray.h"
+#include "vectors.h"
+
+struct HWDrawInfo;
+class HWSprite;
+
+//==========================================================================
+//
+// Walls that got processed by the BSP traversal are drawn into this
+// buffer so that subsectors and sprites behind them can be rejected
+// before any render data gets created for them.
+//
+// Each pixel holds the 1/w of the farthest point of the nearest occluder
+// covering it completely, so all tests are conservative. Only the thread
+// that walks the BSP may draw into it or test against it.
+//
+//==========================================================================
+
+class HWOcclusionBuffer
+{
+public:
+	enum
+	{
+		Width = 256,		// must be a multiple of 4
+		MaxVerts = 8,
+	};
+
+	int culledsubsectors = 0;
+	int culledsprites = 0;
+
+	void Begin(HWDrawInfo *di);
+	void AddWall(const DVector2 &v1, const DVector2 &v2, float bottom1, float top1, float bottom2, float top2);
+	bool IsBoxVisible(const FVector3 &mins, const FVector3 &maxs);
+	bool IsSpriteVisible(HWSprite *sprite);
+
+private:
+	TArray<float> depth;
+	int height = 0;
+	float matrix[16];
+
+	FVector4 Transform(float x, float y, float z) const;
+	void DrawPolygon(const FVector4 *clipverts, int count);
+	void GetSpan(const FVector3 *verts, int count, float y, float &left, float &right) const;
+	void FillSpan(float *dest, int x1, int x2, float start, float step);
+	bool IsSpanVisible(const float *src, int x1, int x2, float nearest) const;
+};
+
+extern HWOcclusionBuffer occlusionBuffer;
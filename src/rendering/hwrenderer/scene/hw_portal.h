@@ -66,6 +66,8 @@ public:
 	TArray<HWWall> lines;
 	BoundingRect boundingBox;
 	int planesused = 0;
+	int Sequence = INT_MAX;		// earliest BSP job that used this portal
+	TArray<int> lineSequence;	// BSP job of each line
 
     HWPortal(FPortalSceneState *s, bool local = false) : mState(s), boundingBox(false)
     {
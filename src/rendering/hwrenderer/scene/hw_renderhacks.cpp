@@ -195,6 +195,8 @@ void HWDrawInfo::AddOtherCeilingPlane(int sector, gl_subsectorrendernode * node)
 //==========================================================================
 void HWDrawInfo::AddUpperMissingTexture(side_t * side, subsector_t *sub, float Backheight)
 {
+	std::lock_guard<std::mutex> lock(SharedStateLock);
+
 	if (!side->segs[0]->backsector) return;
 
 	for (int i = 0; i < side->numsegs; i++)
@@ -247,6 +249,8 @@ void HWDrawInfo::AddUpperMissingTexture(side_t * side, subsector_t *sub, float B
 //==========================================================================
 void HWDrawInfo::AddLowerMissingTexture(side_t * side, subsector_t *sub, float Backheight)
 {
+	std::lock_guard<std::mutex> lock(SharedStateLock);
+
 	sector_t *backsec = side->segs[0]->backsector;
 	if (!backsec) return;
 	if (backsec->transdoor)
@@ -25,6 +25,9 @@
 **
 */
 
+#ifndef NO_SSE
+#include <immintrin.h>
+#endif
 #include "p_local.h"
 #include "p_effect.h"
 #include "g_level.h"
@@ -272,7 +275,8 @@ void HWSprite::DrawSprite(HWDrawInfo *di, FRenderState &state, bool translucent)
 			state.SetNormal(0, 0, 0);
 
 
-			if (screen->BuffersArePersistent())
+			// Sprites split while sorting need new vertices
+			if (vertexindex == -1)
 			{
 				CreateVertices(di);
 			}
@@ -353,6 +357,44 @@ void HandleSpriteOffsets(Matrix3x4 *mat, const FRotator *HW, FVector2 *offset, b
 	mat->Translate(res.X, res.Z, res.Y);
 }
 
+bool HWSprite::UseXYBillboard() const
+{
+	return ((particle && gl_billboard_particles && !(particle->flags & SPF_NO_XY_BILLBOARD)) || (!(actor && actor->renderflags & RF_FORCEYBILLBOARD)
+		//&& di->mViewActor != nullptr
+		&& (gl_billboard_mode == 1 || (actor && actor->renderflags & RF_FORCEXYBILLBOARD))));
+}
+
+bool HWSprite::BillboardFacesCamera() const
+{
+	return hw_force_cambbpref ? gl_billboard_faces_camera :
+		gl_billboard_faces_camera
+		&& ((actor && (!(actor->renderflags2 & RF2_BILLBOARDNOFACECAMERA) || (actor->renderflags2 & RF2_BILLBOARDFACECAMERA)))
+		|| (particle && particle->texture.isValid() && (!(particle->flags & SPF_NOFACECAMERA) || (particle->flags & SPF_FACECAMERA))));
+}
+
+//==========================================================================
+//
+// Sprites which CalculateVertices would only billboard, without any
+// roll, offsets or special sprite type, can be set up in batches.
+//
+//==========================================================================
+
+HWSprite::EBillboard HWSprite::GetBillboard() const
+{
+	if (actor != nullptr)
+	{
+		uint32_t spritetype = actor->renderflags & RF_SPRITETYPEMASK;
+		if (spritetype == RF_FLATSPRITE || spritetype == RF_WALLSPRITE || (actor->renderflags & RF_ROLLSPRITE))
+			return BILLBOARD_Other;
+	}
+	if ((particle != nullptr && (particle->flags & SPF_ROLL)) || offx != 0 || offy != 0)
+		return BILLBOARD_Other;
+
+	if (!UseXYBillboard())
+		return BILLBOARD_Upright;
+	return BillboardFacesCamera() ? BILLBOARD_XYFaceCamera : BILLBOARD_XY;
+}
+
 bool HWSprite::CalculateVertices(HWDrawInfo* di, FVector3* v, DVector3* vp)
 {
 	float pixelstretch = di->Level->pixelstretch;
@@ -395,14 +437,8 @@ bool HWSprite::CalculateVertices(HWDrawInfo* di, FVector3* v, DVector3* vp)
 	}
 	
 	// [BB] Billboard stuff
-	const bool drawWithXYBillboard = ((particle && gl_billboard_particles && !(particle->flags & SPF_NO_XY_BILLBOARD)) || (!(actor && actor->renderflags & RF_FORCEYBILLBOARD)
-		//&& di->mViewActor != nullptr
-		&& (gl_billboard_mode == 1 || (actor && actor->renderflags & RF_FORCEXYBILLBOARD))));
-
-	const bool drawBillboardFacingCamera = hw_force_cambbpref ? gl_billboard_faces_camera :
-		gl_billboard_faces_camera
-		&& ((actor && (!(actor->renderflags2 & RF2_BILLBOARDNOFACECAMERA) || (actor->renderflags2 & RF2_BILLBOARDFACECAMERA)))
-		|| (particle && particle->texture.isValid() && (!(particle->flags & SPF_NOFACECAMERA) || (particle->flags & SPF_FACECAMERA))));
+	const bool drawWithXYBillboard = UseXYBillboard();
+	const bool drawBillboardFacingCamera = BillboardFacesCamera();
 
 	// [Nash] has +ROLLSPRITE
 	const bool drawRollSpriteActor = (actor != nullptr && actor->renderflags & RF_ROLLSPRITE);
@@ -549,11 +585,8 @@ inline void HWSprite::PutSprite(HWDrawInfo *di, bool translucent)
 	else
 		dynlightindex = -1;
 
+	// The vertices get created for all sprites at once by HWDrawInfo::CreateSpriteVertices.
 	vertexindex = -1;
-	if (!screen->BuffersArePersistent())
-	{
-		CreateVertices(di);
-	}
 	di->AddSprite(this, translucent);
 }
 
@@ -567,18 +600,272 @@ void HWSprite::CreateVertices(HWDrawInfo *di)
 {
 	if (modelframe == nullptr)
 	{
-		FVector3 v[4];
-		polyoffset = CalculateVertices(di, v, &di->Viewpoint.Pos);
 		auto vert = screen->mVertexData->AllocVertices(4);
-		auto vp = vert.first;
-		vertexindex = vert.second;
+		CreateVertices(di, vert.first, vert.second);
+	}
+
+}
+
+void HWSprite::CreateVertices(HWDrawInfo *di, FFlatVertex *vp, unsigned int index)
+{
+	FVector3 v[4];
+	polyoffset = CalculateVertices(di, v, &di->Viewpoint.Pos);
+	vertexindex = index;
+
+	vp[0].Set(v[0][0], v[0][1], v[0][2], ul, vt);
+	vp[1].Set(v[1][0], v[1][1], v[1][2], ur, vt);
+	vp[2].Set(v[2][0], v[2][1], v[2][2], ul, vb);
+	vp[3].Set(v[3][0], v[3][1], v[3][2], ur, vb);
+}
+
+//==========================================================================
+//
+// Billboards in structure of arrays form. A billboard's corners are
+// center -/+ a -/+ b, with a and b the half extents along the sprite's
+// width and height after rotating them by the billboard transform.
+//
+//==========================================================================
+
+struct FBillboardBatch
+{
+	TArray<HWSprite *> Sprites;
+	TArray<float> CX, CY, CZ;	// center
+	TArray<float> HX, HY, HZ;	// half extents
+	TArray<float> Cos, Sin;		// rotation towards the camera
+	TArray<float> UL, UR, VT, VB;
+
+	void Clear()
+	{
+		Sprites.Clear();
+		for (auto arr : { &CX, &CY, &CZ, &HX, &HY, &HZ, &Cos, &Sin, &UL, &UR, &VT, &VB })
+			arr->Clear();
+	}
+
+	void Add(HWSprite *sprite, float cosangle, float sinangle)
+	{
+		Sprites.Push(sprite);
+		CX.Push((sprite->x1 + sprite->x2) * 0.5f);
+		CY.Push((sprite->y1 + sprite->y2) * 0.5f);
+		CZ.Push((sprite->z1 + sprite->z2) * 0.5f);
+		HX.Push((sprite->x2 - sprite->x1) * 0.5f);
+		HY.Push((sprite->y2 - sprite->y1) * 0.5f);
+		HZ.Push((sprite->z2 - sprite->z1) * 0.5f);
+		Cos.Push(cosangle);
+		Sin.Push(sinangle);
+		UL.Push(sprite->ul);
+		UR.Push(sprite->ur);
+		VT.Push(sprite->vt);
+		VB.Push(sprite->vb);
+	}
+
+	// Fills the last group of four so that it can be loaded as a whole
+	void Pad()
+	{
+		while (CX.Size() & 3)
+		{
+			for (auto arr : { &CX, &CY, &CZ, &HX, &HY, &HZ, &Cos, &Sin, &UL, &UR, &VT, &VB })
+				arr->Push(0.0f);
+		}
+	}
+
+	void CreateVertices(FFlatVertex *vp, const FVector3 *axes, float invstretch);
+};
+
+static FBillboardBatch uprightBillboards, xyBillboards;
+static TArray<HWSprite *> otherSprites;
+
+//==========================================================================
+//
+// Writes four vertices per billboard to vp. axes are the columns of the
+// pitch and stretch part of the billboard transform, which is the same
+// for all of them.
+//
+//==========================================================================
+
+void FBillboardBatch::CreateVertices(FFlatVertex *vp, const FVector3 *axes, float invstretch)
+{
+	unsigned count = Sprites.Size();
+	Pad();
+
+#ifndef NO_SSE
+	const __m128 a0x = _mm_set1_ps(axes[0].X), a0y = _mm_set1_ps(axes[0].Y), a0z = _mm_set1_ps(axes[0].Z);
+	const __m128 a1x = _mm_set1_ps(axes[1].X), a1y = _mm_set1_ps(axes[1].Y), a1z = _mm_set1_ps(axes[1].Z);
+	const __m128 a2x = _mm_set1_ps(axes[2].X), a2y = _mm_set1_ps(axes[2].Y), a2z = _mm_set1_ps(axes[2].Z);
+	const __m128 stretch = _mm_set1_ps(invstretch);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 noLightmap = _mm_set1_ps(-1.0f);
+
+	for (unsigned i = 0; i < count; i += 4)
+	{
+		__m128 hx = _mm_loadu_ps(&HX[i]), hy = _mm_loadu_ps(&HY[i]), hz = _mm_loadu_ps(&HZ[i]);
+		__m128 c = _mm_loadu_ps(&Cos[i]), s = _mm_loadu_ps(&Sin[i]);
+
+		// The map's Y axis is Z in the vertex buffer
+		__m128 wx = _mm_add_ps(_mm_mul_ps(hx, a0x), _mm_mul_ps(hy, a2x));
+		__m128 wy = _mm_add_ps(_mm_mul_ps(hx, a0y), _mm_mul_ps(hy, a2y));
+		__m128 wz = _mm_add_ps(_mm_mul_ps(hx, a0z), _mm_mul_ps(hy, a2z));
+		__m128 ax = _mm_add_ps(_mm_mul_ps(c, wx), _mm_mul_ps(s, wz));
+		__m128 ay = _mm_mul_ps(wy, stretch);
+		__m128 az = _mm_sub_ps(_mm_mul_ps(c, wz), _mm_mul_ps(s, wx));
+
+		__m128 ux = _mm_mul_ps(hz, a1x), uy = _mm_mul_ps(hz, a1y), uz = _mm_mul_ps(hz, a1z);
+		__m128 bx = _mm_add_ps(_mm_mul_ps(c, ux), _mm_mul_ps(s, uz));
+		__m128 by = _mm_mul_ps(uy, stretch);
+		__m128 bz = _mm_sub_ps(_mm_mul_ps(c, uz), _mm_mul_ps(s, ux));
+
+		__m128 cx = _mm_loadu_ps(&CX[i]), cy = _mm_loadu_ps(&CZ[i]), cz = _mm_loadu_ps(&CY[i]);
+		__m128 lox = _mm_sub_ps(cx, bx), loy = _mm_sub_ps(cy, by), loz = _mm_sub_ps(cz, bz);
+		__m128 hix = _mm_add_ps(cx, bx), hiy = _mm_add_ps(cy, by), hiz = _mm_add_ps(cz, bz);
+		__m128 ul = _mm_loadu_ps(&UL[i]), ur = _mm_loadu_ps(&UR[i]);
+		__m128 vt = _mm_loadu_ps(&VT[i]), vb = _mm_loadu_ps(&VB[i]);
+
+		// Same corner order as CalculateVertices
+		__m128 corners[4][5] =
+		{
+			{ _mm_sub_ps(lox, ax), _mm_sub_ps(loy, ay), _mm_sub_ps(loz, az), ul, vt },
+			{ _mm_add_ps(lox, ax), _mm_add_ps(loy, ay), _mm_add_ps(loz, az), ur, vt },
+			{ _mm_sub_ps(hix, ax), _mm_sub_ps(hiy, ay), _mm_sub_ps(hiz, az), ul, vb },
+			{ _mm_add_ps(hix, ax), _mm_add_ps(hiy, ay), _mm_add_ps(hiz, az), ur, vb },
+		};
+
+		unsigned lanes = std::min(count - i, 4u);
+		for (int k = 0; k < 4; k++)
+		{
+			__m128 r0 = corners[k][0], r1 = corners[k][1], r2 = corners[k][2], r3 = corners[k][3];
+			__m128 s0 = corners[k][4], s1 = zero, s2 = zero, s3 = noLightmap;
+			_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+			_MM_TRANSPOSE4_PS(s0, s1, s2, s3);
+			__m128 pos[4] = { r0, r1, r2, r3 }, rest[4] = { s0, s1, s2, s3 };
+			for (unsigned j = 0; j < lanes; j++)
+			{
+				float *dest = &vp[(i + j) * 4 + k].x;
+				_mm_storeu_ps(dest, pos[j]);
+				_mm_storeu_ps(dest + 4, rest[j]);
+			}
+		}
+	}
+#else
+	for (unsigned i = 0; i < count; i++)
+	{
+		FVector3 w = axes[0] * HX[i] + axes[2] * HY[i];
+		FVector3 u = axes[1] * HZ[i];
+		FVector3 a(Cos[i] * w.X + Sin[i] * w.Z, w.Y * invstretch, Cos[i] * w.Z - Sin[i] * w.X);
+		FVector3 b(Cos[i] * u.X + Sin[i] * u.Z, u.Y * invstretch, Cos[i] * u.Z - Sin[i] * u.X);
+		FVector3 center(CX[i], CZ[i], CY[i]);
+		FVector3 v0 = center - a - b, v1 = center + a - b, v2 = center - a + b, v3 = center + a + b;
+
+		vp[i * 4 + 0].Set(v0.X, v0.Y, v0.Z, UL[i], VT[i]);
+		vp[i * 4 + 1].Set(v1.X, v1.Y, v1.Z, UR[i], VT[i]);
+		vp[i * 4 + 2].Set(v2.X, v2.Y, v2.Z, UL[i], VB[i]);
+		vp[i * 4 + 3].Set(v3.X, v3.Y, v3.Z, UR[i], VB[i]);
+	}
+#endif
+}
+
+//==========================================================================
+//
+// Creates the vertices of all sprites in the draw lists with a single
+// allocation. Billboards, which are the bulk of them, are processed as
+// batches; everything else goes through CalculateVertices.
+//
+//==========================================================================
+
+void HWDrawInfo::CreateSpriteVertices()
+{
+	uprightBillboards.Clear();
+	xyBillboards.Clear();
+	otherSprites.Clear();
+
+	const auto &HWAngles = Viewpoint.HWAngles;
+	float counterRotation = (FAngle::fromDeg(270.) - HWAngles.Yaw).Radians();
+	float counterCos = cosf(counterRotation), counterSin = sinf(counterRotation);
+
+	for (auto &list : drawlists)
+	{
+		for (HWSprite *sprite : list.sprites)
+		{
+			if (sprite->modelframe != nullptr || sprite->vertexindex != -1)
+				continue;
+
+			switch (sprite->GetBillboard())
+			{
+			case HWSprite::BILLBOARD_Upright:
+				uprightBillboards.Add(sprite, 1.0f, 0.0f);
+				break;
+
+			case HWSprite::BILLBOARD_XY:
+				xyBillboards.Add(sprite, 1.0f, 0.0f);
+				break;
+
+			case HWSprite::BILLBOARD_XYFaceCamera:
+			{
+				// The rotation by atan2(-yrel, xrel) that CalculateVertices adds to the counter rotation
+				float xrel = (sprite->x1 + sprite->x2) * 0.5f - (float)Viewpoint.Pos.X;
+				float yrel = (sprite->y1 + sprite->y2) * 0.5f - (float)Viewpoint.Pos.Y;
+				float len = sqrtf(xrel * xrel + yrel * yrel);
+				float relCos = len > 0.0f ? xrel / len : 1.0f;
+				float relSin = len > 0.0f ? -yrel / len : 0.0f;
+				xyBillboards.Add(sprite, counterCos * relCos - counterSin * relSin, counterSin * relCos + counterCos * relSin);
+				break;
+			}
 
-		vp[0].Set(v[0][0], v[0][1], v[0][2], ul, vt);
-		vp[1].Set(v[1][0], v[1][1], v[1][2], ur, vt);
-		vp[2].Set(v[2][0], v[2][1], v[2][2], ul, vb);
-		vp[3].Set(v[3][0], v[3][1], v[3][2], ur, vb);
+			default:
+				otherSprites.Push(sprite);
+				break;
+			}
+		}
 	}
 
+	unsigned numUpright = uprightBillboards.Sprites.Size();
+	unsigned numXY = xyBillboards.Sprites.Size();
+	unsigned count = numUpright + numXY + otherSprites.Size();
+	if (count == 0)
+		return;
+
+	auto vert = screen->mVertexData->AllocVertices(count * 4);
+	FFlatVertex *vp = vert.first;
+	unsigned int index = vert.second;
+
+	if (numUpright > 0)
+	{
+		static const FVector3 identity[3] = { { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f } };
+		uprightBillboards.CreateVertices(vp, identity, 1.0f);
+		for (unsigned i = 0; i < numUpright; i++)
+		{
+			uprightBillboards.Sprites[i]->vertexindex = index + i * 4;
+			uprightBillboards.Sprites[i]->polyoffset = false;
+		}
+		vp += numUpright * 4;
+		index += numUpright * 4;
+	}
+
+	if (numXY > 0)
+	{
+		// Tilt about the axis orthogonal to the view direction, compensating for the level's pixel stretch
+		float pixelstretch = Level->pixelstretch;
+		float angleRad = (FAngle::fromDeg(270.) - HWAngles.Yaw).Radians();
+		Matrix3x4 mat;
+		mat.MakeIdentity();
+		mat.Rotate(-sin(angleRad), 0, cos(angleRad), -HWAngles.Pitch.Degrees());
+		mat.Scale(1.0, pixelstretch, 1.0);
+		FVector3 axes[3] = { mat * FVector3(1.0f, 0.0f, 0.0f), mat * FVector3(0.0f, 1.0f, 0.0f), mat * FVector3(0.0f, 0.0f, 1.0f) };
+
+		xyBillboards.CreateVertices(vp, axes, 1.0f / pixelstretch);
+		for (unsigned i = 0; i < numXY; i++)
+		{
+			xyBillboards.Sprites[i]->vertexindex = index + i * 4;
+			xyBillboards.Sprites[i]->polyoffset = false;
+		}
+		vp += numXY * 4;
+		index += numXY * 4;
+	}
+
+	for (HWSprite *sprite : otherSprites)
+	{
+		sprite->CreateVertices(this, vp, index);
+		vp += 4;
+		index += 4;
+	}
 }
 
 
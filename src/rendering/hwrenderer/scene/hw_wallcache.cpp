@@ -0,0 +1,335 @@
+/*
+** hw_wallcache.cpp
+** Per-seg cache of processed wall pieces
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 GZDoom Maintainers and Contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+*/
+
+#include <string.h>
+#include "c_cvars.h"
+#include "stats.h"
+#include "r_defs.h"
+#include "r_sky.h"
+#include "p_lnspec.h"
+#include "g_levellocals.h"
+#include "texturemanager.h"
+#include "hw_cvars.h"
+#include "hwrenderer/scene/hw_drawinfo.h"
+#include "hwrenderer/scene/hw_drawstructs.h"
+#include "hw_walldispatcher.h"
+#include "hw_wallcache.h"
+
+CVAR(Bool, gl_wallcache, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+EXTERN_CVAR(Int, r_fakecontrast)
+EXTERN_CVAR(Int, topskew)
+EXTERN_CVAR(Int, midskew)
+EXTERN_CVAR(Int, bottomskew)
+
+HWWallCache wallCache;
+
+//==========================================================================
+//
+// Accumulates everything a seg's wall pieces depend on into one
+// 64 bit value. A collision merely shows one stale frame of a wall.
+//
+//==========================================================================
+
+struct FWallKey
+{
+	uint64_t hash;
+
+	FWallKey(uint64_t seed) : hash(seed) {}
+
+	void Add(uint64_t v)
+	{
+		hash ^= v;
+		hash *= 0x9E3779B97F4A7C15ull;
+		hash ^= hash >> 29;
+	}
+
+	void Add(const void *p)
+	{
+		Add((uint64_t)(uintptr_t)p);
+	}
+
+	void Add(double v)
+	{
+		uint64_t bits;
+		memcpy(&bits, &v, sizeof(bits));
+		Add(bits);
+	}
+
+	void Add(float v)
+	{
+		uint32_t bits;
+		memcpy(&bits, &v, sizeof(bits));
+		Add((uint64_t)bits);
+	}
+
+	void Add(const secplane_t &plane)
+	{
+		Add(plane.Normal().X);
+		Add(plane.Normal().Y);
+		Add(plane.Normal().Z);
+		Add(plane.fD());
+	}
+
+	void Add(const FColormap &cm)
+	{
+		Add((uint64_t)cm.LightColor.d | ((uint64_t)cm.FadeColor.d << 32));
+		Add((uint64_t)cm.Desaturation | ((uint64_t)cm.BlendFactor << 8) | ((uint64_t)cm.FogDensity << 16));
+	}
+
+	void Add(const FTextureID &tex)
+	{
+		// Animated textures are resolved here so that animation frames count as a change.
+		Add(TexMan.GetGameTexture(tex, true));
+	}
+
+	void Add(const side_t::part &part)
+	{
+		Add(part.texture);
+		Add(part.xOffset);
+		Add(part.yOffset);
+		Add(part.xScale);
+		Add(part.yScale);
+		Add((uint64_t)(uint16_t)part.flags | ((uint64_t)(uint8_t)part.skew << 16));
+	}
+
+	void Add(const side_t *side)
+	{
+		for (auto &part : side->textures) Add(part);
+		Add((uint64_t)side->Flags | ((uint64_t)(uint16_t)side->Light << 16));
+		Add((uint64_t)(uint16_t)side->TierLights[0] | ((uint64_t)(uint16_t)side->TierLights[1] << 16) | ((uint64_t)(uint16_t)side->TierLights[2] << 32));
+	}
+
+	void Add(sector_t *sec)
+	{
+		Add((uint64_t)sec->sectornum | ((uint64_t)(uint32_t)sec->lightlevel << 32));
+		Add(sec->floorplane);
+		Add(sec->ceilingplane);
+		for (auto &plane : sec->planes)
+		{
+			Add(plane.Texture);
+			Add(plane.TexZ);
+			Add((uint64_t)plane.GlowColor.d);
+			Add(plane.GlowHeight);
+		}
+		Add(sec->Colormap);
+		Add((uint64_t)sec->MoreFlags | ((uint64_t)sec->Flags << 32));
+
+		auto &x = sec->e->XFloor;
+		Add((uint64_t)x.ffloors.Size() | ((uint64_t)x.lightlist.Size() << 32));
+		for (auto rover : x.ffloors)
+		{
+			Add((uint64_t)rover->flags | ((uint64_t)(uint32_t)rover->alpha << 32));
+			Add(*rover->top.plane);
+			Add(*rover->bottom.plane);
+			Add(*rover->top.texture);
+			Add(*rover->bottom.texture);
+			Add((const void *)rover->model);
+			Add((uint64_t)(uint16_t)*rover->toplightlevel);
+			if (rover->model != nullptr) Add(rover->model->Colormap);
+			if (rover->master != nullptr && rover->master->sidedef[0] != nullptr) Add(rover->master->sidedef[0]);
+		}
+		for (auto &light : x.lightlist)
+		{
+			Add(light.plane);
+			Add((uint64_t)(uint16_t)*light.p_lightlevel | ((uint64_t)light.blend.d << 32));
+			Add(light.extra_colormap);
+			Add((uint64_t)(uint32_t)light.flags);
+			Add(light.lightsource);
+			Add(light.caster);
+		}
+	}
+};
+
+//==========================================================================
+//
+// Called after a level got loaded. Seg indices are meaningless after that.
+//
+//==========================================================================
+
+void HWWallCache::Clear()
+{
+	entries.Reset();
+	Level = nullptr;
+}
+
+void hw_ClearWallCache()
+{
+	wallCache.Clear();
+}
+
+//==========================================================================
+//
+// Called from the main thread before the BSP gets traversed.
+// Collects the global settings that affect all walls alike.
+//
+//==========================================================================
+
+void HWWallCache::BeginPass(HWDrawInfo *di)
+{
+	active = gl_wallcache;
+	if (!active)
+	{
+		if (entries.Size() > 0) Clear();
+		return;
+	}
+	if (Level != di->Level || entries.Size() != di->Level->segs.Size())
+	{
+		Clear();
+		Level = di->Level;
+		entries.Resize(Level->segs.Size());
+	}
+
+	FWallKey key(0x5745414C4C434143ull);
+	key.Add((uint64_t)di->isFullbrightScene() | ((uint64_t)di->lightmode << 8) | ((uint64_t)skyflatnum.GetIndex() << 32));
+	key.Add((uint64_t)Level->flags | ((uint64_t)Level->flags2 << 32));
+	key.Add((uint64_t)Level->flags3 | ((uint64_t)(uint32_t)Level->i_compatflags << 32));
+	key.Add((uint64_t)(uint32_t)Level->ib_compatflags | ((uint64_t)(uint8_t)Level->WallHorizLight << 32) | ((uint64_t)(uint8_t)Level->WallVertLight << 40));
+	key.Add((uint64_t)*r_fakecontrast | ((uint64_t)*gl_fogmode << 8) | ((uint64_t)*gl_mirrors << 16) | ((uint64_t)*gl_seamless << 24));
+	key.Add((uint64_t)(uint8_t)*topskew | ((uint64_t)(uint8_t)*midskew << 8) | ((uint64_t)(uint8_t)*bottomskew << 16));
+	framekey = key.hash;
+}
+
+//==========================================================================
+//
+// Only walls whose output does not depend on the view can be cached.
+// Skies, portals and mirrors are all handled by PutPortal, which also
+// throws away an entry that is being recorded, but some of them decide
+// on the view position whether to emit anything at all.
+//
+//==========================================================================
+
+static bool IsStaticSector(sector_t *sec)
+{
+	for (int plane = sector_t::floor; plane <= sector_t::ceiling; plane++)
+	{
+		if (sec->GetTexture(plane) == skyflatnum || sec->Portals[plane] != 0 || sec->GetReflect(plane) > 0) return false;
+	}
+	return true;
+}
+
+bool HWWallCache::IsCacheable(HWWallDispatcher *di, seg_t *seg, sector_t *front, sector_t *back)
+{
+	if (!active || di->di == nullptr) return false;
+	if ((seg->sidedef->Flags & WALLF_POLYOBJ) || unsigned(seg->Index()) >= entries.Size()) return false;
+
+	auto line = seg->linedef;
+	if (line->special == Line_Horizon || line->special == Line_Mirror) return false;
+	if (line->isVisualPortal() || line->GetTransferredPortal()) return false;
+	return IsStaticSector(front) && (back == nullptr || IsStaticSector(back));
+}
+
+uint64_t HWWallCache::MakeKey(seg_t *seg, sector_t *front, sector_t *back)
+{
+	FWallKey key(framekey);
+	auto line = seg->linedef;
+	key.Add(seg->sidedef);
+	key.Add((uint64_t)line->flags | ((uint64_t)(uint32_t)line->special << 32));
+	key.Add(line->alpha);
+	key.Add(front);
+	if (back != nullptr) key.Add(back);
+	else key.Add(uint64_t(0));
+	return key.hash;
+}
+
+//==========================================================================
+//
+// The recorded pieces still point to the fake sectors of the frame
+// they were created in and need the current ones.
+//
+//==========================================================================
+
+void HWWallCache::Replay(HWWallDispatcher *di, HWWallCacheEntry &entry, HWWall &wall, seg_t *seg, sector_t *front, sector_t *back)
+{
+	if (gl_seamless)
+	{
+		auto v1 = seg->linedef->v1, v2 = seg->linedef->v2;
+		if (v1->dirty) v1->RecalcVertexHeights();
+		if (v2->dirty) v2->RecalcVertexHeights();
+	}
+
+	for (auto &piece : entry.walls)
+	{
+		wall = piece.wall;
+		wall.frontsector = front;
+		wall.backsector = back;
+		wall.PutWall(di, piece.translucent);
+	}
+	for (auto &missing : entry.missing)
+	{
+		if (missing.upper) di->di->AddUpperMissingTexture(missing.side, wall.sub, missing.height);
+		else di->di->AddLowerMissingTexture(missing.side, wall.sub, missing.height);
+	}
+}
+
+//==========================================================================
+//
+// Replacement for HWWall::Process. Each seg is only ever handled by
+// one BSP worker per pass, so the entries need no locking.
+//
+//==========================================================================
+
+void HWWallCache::ProcessWall(HWWallDispatcher *di, HWWall &wall, seg_t *seg, sector_t *front, sector_t *back)
+{
+	if (!IsCacheable(di, seg, front, back))
+	{
+		wall.Process(di, seg, front, back);
+		return;
+	}
+
+	auto &entry = entries[seg->Index()];
+	uint64_t key = MakeKey(seg, front, back);
+	if (entry.valid && entry.key == key)
+	{
+		hits++;
+		Replay(di, entry, wall, seg, front, back);
+		return;
+	}
+
+	misses++;
+	entry.key = key;
+	entry.valid = true;
+	entry.walls.Clear();
+	entry.missing.Clear();
+	di->cache = &entry;
+	wall.Process(di, seg, front, back);
+	di->cache = nullptr;
+}
+
+ADD_STAT(wallcache)
+{
+	FString out;
+	int h = wallCache.hits.exchange(0), m = wallCache.misses.exchange(0);
+	out.Format("Wall cache: hits=%d, misses=%d", h, m);
+	return out;
+}
@@ -0,0 +1,94 @@
+/*
+** hw_wallcache.h
+** Per-seg cache of processed wall pieces
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 GZDoom Maintainers and Contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+*/
+#pragma once
+
+#include <atomic>
+#include "tarray.h"
+#include "hw_drawstructs.h"
+
+struct HWDrawInfo;
+struct HWWallDispatcher;
+
+//==========================================================================
+//
+// The pieces HWWall::Process produced for one seg, captured on their
+// way into PutWall, plus the missing texture hacks it requested.
+// Replaying them skips all the texture positioning and 3D floor
+// splitting as long as nothing that went into them has changed.
+//
+//==========================================================================
+
+struct HWCachedWall
+{
+	HWWall wall;
+	bool translucent;
+};
+
+struct HWCachedMissing
+{
+	side_t *side;
+	float height;
+	bool upper;
+};
+
+struct HWWallCacheEntry
+{
+	uint64_t key = 0;
+	bool valid = false;
+	TArray<HWCachedWall> walls;
+	TArray<HWCachedMissing> missing;
+};
+
+class HWWallCache
+{
+	FLevelLocals *Level = nullptr;
+	TArray<HWWallCacheEntry> entries;
+	uint64_t framekey = 0;
+	bool active = false;
+
+	bool IsCacheable(HWWallDispatcher *di, seg_t *seg, sector_t *front, sector_t *back);
+	uint64_t MakeKey(seg_t *seg, sector_t *front, sector_t *back);
+	void Replay(HWWallDispatcher *di, HWWallCacheEntry &entry, HWWall &wall, seg_t *seg, sector_t *front, sector_t *back);
+
+public:
+	std::atomic<int> hits{ 0 }, misses{ 0 };
+
+	void Clear();
+	void BeginPass(HWDrawInfo *di);
+	void ProcessWall(HWWallDispatcher *di, HWWall &wall, seg_t *seg, sector_t *front, sector_t *back);
+};
+
+extern HWWallCache wallCache;
+
+void hw_ClearWallCache();
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "hw_wallcache.h"
+
 struct HWMissing
 {
 	side_t* side;
@@ -22,6 +24,7 @@ struct HWWallDispatcher
 	FLevelLocals* Level;
 	HWDrawInfo* di;
 	HWMeshHelper* mh;
+	HWWallCacheEntry* cache;	// records the output of HWWall::Process when set
 	ELightMode lightmode;
 
 	HWWallDispatcher(HWDrawInfo* info)
@@ -29,6 +32,7 @@ struct HWWallDispatcher
 		Level = info->Level;
 		di = info;
 		mh = nullptr;
+		cache = nullptr;
 		lightmode = info->lightmode;
 	}
 
@@ -37,11 +41,13 @@ struct HWWallDispatcher
 		Level = lev;
 		di = nullptr;
 		mh = help;
+		cache = nullptr;
 		lightmode = lm;
 	}
 
 	void AddUpperMissingTexture(side_t* side, subsector_t* sub, float height)
 	{
+		if (cache) cache->missing.Push({ side, height, true });
 		if (di) di->AddUpperMissingTexture(side, sub, height);
 		else
 		{
@@ -51,6 +57,7 @@ struct HWWallDispatcher
 	}
 	void AddLowerMissingTexture(side_t* side, subsector_t* sub, float height)
 	{
+		if (cache) cache->missing.Push({ side, height, false });
 		if (di) di->AddLowerMissingTexture(side, sub, height);
 		else
 		{
@@ -395,6 +395,13 @@ void HWWall::SetupLights(HWDrawInfo*di, FDynLightData &lightdata)
 		return;
 	}
 
+	// With the light grid all lights get looked up per fragment.
+	if (di->VPUniforms.mLightGridIndex >= 0)
+	{
+		dynlightindex = di->VPUniforms.mLightGridIndex;
+		return;
+	}
+
 	float vtx[]={glseg.x1,zbottom[0],glseg.y1, glseg.x1,ztop[0],glseg.y1, glseg.x2,ztop[1],glseg.y2, glseg.x2,zbottom[1],glseg.y2};
 	Plane p;
 
@@ -496,6 +503,8 @@ const char HWWall::passflag[] = {
 //==========================================================================
 void HWWall::PutWall(HWWallDispatcher *di, bool translucent)
 {
+	if (di->cache) di->cache->walls.Push({ *this, translucent });
+
 	if (texture && texture->GetTranslucency() && passflag[type] == 2)
 	{
 		translucent = true;
@@ -577,10 +586,16 @@ void HWWall::PutPortal(HWWallDispatcher *di, int ptype, int plane)
 {
 	HWPortal * portal = nullptr;
 
+	// Portals are view dependent so anything that creates one cannot be cached.
+	if (di->cache) di->cache->valid = false;
+
 	auto ddi = di->di;
 	if (ddi)
 	{
 		MakeVertices(false);
+
+		// The portal list is shared by all BSP workers.
+		std::lock_guard<std::mutex> lock(ddi->SharedStateLock);
 		switch (ptype)
 		{
 			// portals don't go into the draw list.
@@ -680,9 +695,13 @@ void HWWall::PutPortal(HWWallDispatcher *di, int ptype, int plane)
 		}
 		vertcount = 0;
 
-		if (plane != -1 && portal)
+		if (portal)
 		{
-			portal->planesused |= (1 << plane);
+			// Remember where in BSP order this line came from so that the portal list can be put back into it.
+			int seq = GetBSPJobSequence();
+			portal->lineSequence.Push(seq);
+			portal->Sequence = min(portal->Sequence, seq);
+			if (plane != -1) portal->planesused |= (1 << plane);
 		}
 	}
 	else
@@ -0,0 +1,107 @@
+/*
+** r_draw_lights32.h
+** Per-tile dynamic light culling for the truecolor drawers
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 GZDoom Maintainers and Contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+** A light only touches the part of a wall column or span that lies within
+** its radius, but the drawers used to evaluate every light of the column
+** or span for every pixel. The drawers now walk their pixels in tiles and
+** only evaluate the lights that can reach the current tile.
+**
+** The reach of a light is padded a little, so that a skipped pixel would
+** have received zero light from it anyway and the output stays the same.
+**
+*/
+
+#pragma once
+
+#include <math.h>
+#include "swrenderer/viewport/r_shadeconstants.h"
+
+namespace swrenderer
+{
+	class DrawerLightTiles
+	{
+	public:
+		enum
+		{
+			TileSize = 16,		// pixels
+			MaxLights = 32		// with more lights than this all of them are used for every tile
+		};
+
+		// center is the member holding the light's position along the drawer's axis,
+		// dist2 the one holding its squared distance from that axis.
+		DrawerLightTiles(const DrawerLight *lights, int num_lights, float DrawerLight::*center, float DrawerLight::*dist2) : AllLights(lights), NumAllLights(num_lights)
+		{
+			if (num_lights > MaxLights)
+				return;
+
+			for (int i = 0; i < num_lights; i++)
+			{
+				float radius = 256.0f / lights[i].radius;
+				float reach2 = radius * radius - lights[i].*dist2;
+				float reach = reach2 > 0.0f ? sqrtf(reach2) + radius * (1.0f / 512.0f) : 0.0f;
+				Min[i] = lights[i].*center - reach;
+				Max[i] = lights[i].*center + reach;
+			}
+		}
+
+		// Collects the lights that can reach any position between pos0 and pos1. step is the
+		// distance between two pixels and covers the rounding of the drawer's stepping.
+		int Gather(float pos0, float pos1, float step)
+		{
+			if (NumAllLights > MaxLights)
+				return NumAllLights;
+
+			float pad = fabsf(step);
+			float lo = (pos0 < pos1 ? pos0 : pos1) - pad;
+			float hi = (pos0 < pos1 ? pos1 : pos0) + pad;
+			int count = 0;
+			for (int i = 0; i < NumAllLights; i++)
+			{
+				if (Max[i] >= lo && Min[i] <= hi)
+					TileLights[count++] = AllLights[i];
+			}
+			return count;
+		}
+
+		const DrawerLight *Lights() const { return NumAllLights > MaxLights ? AllLights : TileLights; }
+
+		// Reach of each light along the drawer's axis, or null when every tile uses all lights
+		const float *MinPositions() const { return NumAllLights > MaxLights ? nullptr : Min; }
+		const float *MaxPositions() const { return NumAllLights > MaxLights ? nullptr : Max; }
+
+	private:
+		const DrawerLight *AllLights;
+		int NumAllLights;
+		float Min[MaxLights], Max[MaxLights];
+		DrawerLight TileLights[MaxLights];
+	};
+}
@@ -43,12 +43,15 @@
 #include "r_draw.h"
 #include "v_video.h"
 #include "r_draw_pal.h"
+#include "r_draw_pal_avx2.h"
 #include "swrenderer/viewport/r_viewport.h"
 #include "swrenderer/scene/r_light.h"
+#include "x86.h"
 
 // [SP] r_blendmethod - false = rgb555 matching (ZDoom classic), true = rgb666 (refactored)
 CVAR(Bool, r_blendmethod, false, CVAR_GLOBALCONFIG | CVAR_ARCHIVE)
 EXTERN_CVAR(Int, gl_particles_style)
+EXTERN_CVAR(Bool, r_avx2drawers)
 
 /*
 	[RH] This translucency algorithm is based on DOSDoom 0.65's, but uses
@@ -93,6 +96,95 @@ EXTERN_CVAR(Int, gl_particles_style)
 
 namespace swrenderer
 {
+	// These return false if the AVX2 drawers can not do the job, so that the caller can use the scalar code instead.
+	// They are only used for the RGB555 blending tables and without dynamic lights.
+
+	static bool DrawPalWallColumnAVX2(const WallColumnDrawerArgs &args, int blendmode, bool masked)
+	{
+#ifdef SW_AVX2_DRAWERS
+		if (!r_avx2drawers || !CPU.bAVX2 || args.dc_num_lights != 0 || (blendmode != AVX2PalParams::Opaque && r_blendmethod))
+			return false;
+
+		AVX2PalParams params = {};
+		params.BlendMode = blendmode;
+		params.Sampler = AVX2PalParams::WallColumn;
+		params.Masked = masked;
+		params.Dest = args.Dest();
+		params.Pitch = args.Viewport()->RenderTarget->GetPitch();
+		params.Count = args.Count();
+		params.Source = args.TexturePixels();
+		params.Colormap = args.Colormap(args.Viewport());
+		params.Frac = args.TextureVPos();
+		params.FracStep = args.TextureVStep();
+		params.FracBits = args.TextureFracBits();
+		params.FgToRGB = args.SrcBlend();
+		params.BgToRGB = args.DestBlend();
+		params.RGB32k = RGB32k.All;
+		DrawPal8AVX2(params);
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	static bool DrawPalSpriteColumnAVX2(const SpriteDrawerArgs &args, int blendmode, bool translated)
+	{
+#ifdef SW_AVX2_DRAWERS
+		if (!r_avx2drawers || !CPU.bAVX2 || (blendmode != AVX2PalParams::Opaque && r_blendmethod))
+			return false;
+
+		AVX2PalParams params = {};
+		params.BlendMode = blendmode;
+		params.Sampler = AVX2PalParams::SpriteColumn;
+		params.Dest = args.Dest();
+		params.Pitch = args.Viewport()->RenderTarget->GetPitch();
+		params.Count = args.Count();
+		params.Source = args.TexturePixels();
+		params.Translation = translated ? args.TranslationMap() : nullptr;
+		params.Colormap = args.Colormap(args.Viewport());
+		params.Frac = args.TextureVPos();
+		params.FracStep = args.TextureVStep();
+		params.FgToRGB = args.SrcBlend();
+		params.BgToRGB = args.DestBlend();
+		params.RGB32k = RGB32k.All;
+		DrawPal8AVX2(params);
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	static bool DrawPalSpanAVX2(const SpanDrawerArgs &args, int blendmode, bool masked)
+	{
+#ifdef SW_AVX2_DRAWERS
+		if (!r_avx2drawers || !CPU.bAVX2 || args.dc_num_lights != 0 || (blendmode != AVX2PalParams::Opaque && r_blendmethod))
+			return false;
+
+		AVX2PalParams params = {};
+		params.BlendMode = blendmode;
+		params.Width = args.TextureWidth();
+		params.Height = args.TextureHeight();
+		params.Sampler = params.Width == 64 && params.Height == 64 ? AVX2PalParams::Span64x64 : AVX2PalParams::Span;
+		params.Masked = masked;
+		params.Dest = args.Viewport()->GetDest(args.DestX1(), args.DestY());
+		params.Pitch = 1;
+		params.Count = args.DestX2() - args.DestX1() + 1;
+		params.Source = args.TexturePixels();
+		params.Colormap = args.Colormap(args.Viewport());
+		params.XFrac = args.TextureUPos();
+		params.YFrac = args.TextureVPos();
+		params.XStep = args.TextureUStep();
+		params.YStep = args.TextureVStep();
+		params.FgToRGB = args.SrcBlend();
+		params.BgToRGB = args.DestBlend();
+		params.RGB32k = RGB32k.All;
+		DrawPal8AVX2(params);
+		return true;
+#else
+		return false;
+#endif
+	}
+
 	uint8_t SWPalDrawers::AddLightsColumn(const DrawerLight *lights, int num_lights, float viewpos_z, uint8_t fg, uint8_t material)
 	{
 		uint32_t lit_r = 0;
@@ -153,6 +245,9 @@ namespace swrenderer
 		if (count <= 0)
 			return;
 
+		if (DrawPalWallColumnAVX2(args, AVX2PalParams::Opaque, false))
+			return;
+
 		uint32_t fracstep = args.TextureVStep();
 		uint32_t frac = args.TextureVPos();
 		uint8_t *colormap = args.Colormap(args.Viewport());
@@ -196,6 +291,9 @@ namespace swrenderer
 		if (count <= 0)
 			return;
 
+		if (DrawPalWallColumnAVX2(args, AVX2PalParams::Opaque, true))
+			return;
+
 		uint32_t fracstep = args.TextureVStep();
 		uint32_t frac = args.TextureVPos();
 		uint8_t *colormap = args.Colormap(args.Viewport());
@@ -247,6 +345,9 @@ namespace swrenderer
 		if (count <= 0)
 			return;
 
+		if (DrawPalWallColumnAVX2(args, AVX2PalParams::Add, true))
+			return;
+
 		uint32_t fracstep = args.TextureVStep();
 		uint32_t frac = args.TextureVPos();
 		uint8_t *colormap = args.Colormap(args.Viewport());
@@ -304,6 +405,9 @@ namespace swrenderer
 		if (count <= 0)
 			return;
 
+		if (DrawPalWallColumnAVX2(args, AVX2PalParams::AddClamp, true))
+			return;
+
 		uint32_t fracstep = args.TextureVStep();
 		uint32_t frac = args.TextureVPos();
 		uint8_t *colormap = args.Colormap(args.Viewport());
@@ -371,6 +475,9 @@ namespace swrenderer
 		if (count <= 0)
 			return;
 
+		if (DrawPalWallColumnAVX2(args, AVX2PalParams::SubClamp, true))
+			return;
+
 		uint32_t fracstep = args.TextureVStep();
 		uint32_t frac = args.TextureVPos();
 		uint8_t *colormap = args.Colormap(args.Viewport());
@@ -437,6 +544,9 @@ namespace swrenderer
 		if (count <= 0)
 			return;
 
+		if (DrawPalWallColumnAVX2(args, AVX2PalParams::RevSubClamp, true))
+			return;
+
 		uint32_t fracstep = args.TextureVStep();
 		uint32_t frac = args.TextureVPos();
 		uint8_t *colormap = args.Colormap(args.Viewport());
@@ -803,6 +913,9 @@ namespace swrenderer
 		if (count <= 0)
 			return;
 
+		if (args.DynamicLight() == 0 && DrawPalSpriteColumnAVX2(args, AVX2PalParams::Opaque, false))
+			return;
+
 		// Framebuffer destination address.
 		dest = args.Dest();
 
@@ -1077,6 +1190,9 @@ namespace swrenderer
 		if (count <= 0)
 			return;
 
+		if (DrawPalSpriteColumnAVX2(args, AVX2PalParams::Add, false))
+			return;
+
 		uint8_t* dest = args.Dest();
 		int pitch = args.Viewport()->RenderTarget->GetPitch();
 
@@ -1129,6 +1245,9 @@ namespace swrenderer
 		if (count <= 0)
 			return;
 
+		if (DrawPalSpriteColumnAVX2(args, AVX2PalParams::Opaque, true))
+			return;
+
 		uint8_t* dest = args.Dest();
 		int pitch = args.Viewport()->RenderTarget->GetPitch();
 
@@ -1155,6 +1274,9 @@ namespace swrenderer
 		if (count <= 0)
 			return;
 
+		if (DrawPalSpriteColumnAVX2(args, AVX2PalParams::Add, true))
+			return;
+
 		uint8_t* dest = args.Dest();
 		int pitch = args.Viewport()->RenderTarget->GetPitch();
 
@@ -1294,6 +1416,9 @@ namespace swrenderer
 		if (count <= 0)
 			return;
 
+		if (DrawPalSpriteColumnAVX2(args, AVX2PalParams::AddClamp, false))
+			return;
+
 		uint8_t* dest = args.Dest();
 		int pitch = args.Viewport()->RenderTarget->GetPitch();
 
@@ -1347,6 +1472,9 @@ namespace swrenderer
 		if (count <= 0)
 			return;
 
+		if (DrawPalSpriteColumnAVX2(args, AVX2PalParams::AddClamp, true))
+			return;
+
 		uint8_t* dest = args.Dest();
 		int pitch = args.Viewport()->RenderTarget->GetPitch();
 
@@ -1401,6 +1529,9 @@ namespace swrenderer
 		if (count <= 0)
 			return;
 
+		if (DrawPalSpriteColumnAVX2(args, AVX2PalParams::SubClamp, false))
+			return;
+
 		uint8_t* dest = args.Dest();
 		int pitch = args.Viewport()->RenderTarget->GetPitch();
 
@@ -1453,6 +1584,9 @@ namespace swrenderer
 		if (count <= 0)
 			return;
 
+		if (DrawPalSpriteColumnAVX2(args, AVX2PalParams::SubClamp, true))
+			return;
+
 		uint8_t* dest = args.Dest();
 		int pitch = args.Viewport()->RenderTarget->GetPitch();
 
@@ -1506,6 +1640,9 @@ namespace swrenderer
 		if (count <= 0)
 			return;
 
+		if (DrawPalSpriteColumnAVX2(args, AVX2PalParams::RevSubClamp, false))
+			return;
+
 		uint8_t* dest = args.Dest();
 		int pitch = args.Viewport()->RenderTarget->GetPitch();
 
@@ -1558,6 +1695,9 @@ namespace swrenderer
 		if (count <= 0)
 			return;
 
+		if (DrawPalSpriteColumnAVX2(args, AVX2PalParams::RevSubClamp, true))
+			return;
+
 		uint8_t* dest = args.Dest();
 		int pitch = args.Viewport()->RenderTarget->GetPitch();
 
@@ -1883,6 +2023,9 @@ namespace swrenderer
 
 	void SWPalDrawers::DrawSpan(const SpanDrawerArgs& args)
 	{
+		if (DrawPalSpanAVX2(args, AVX2PalParams::Opaque, false))
+			return;
+
 		const uint8_t* _source = args.TexturePixels();
 		const uint8_t* _colormap = args.Colormap(args.Viewport());
 		uint32_t _xfrac = args.TextureUPos();
@@ -1989,6 +2132,9 @@ namespace swrenderer
 
 	void SWPalDrawers::DrawSpanMasked(const SpanDrawerArgs& args)
 	{
+		if (DrawPalSpanAVX2(args, AVX2PalParams::Opaque, true))
+			return;
+
 		const uint8_t* _source = args.TexturePixels();
 		const uint8_t* _colormap = args.Colormap(args.Viewport());
 		uint32_t _xfrac = args.TextureUPos();
@@ -2080,6 +2226,9 @@ namespace swrenderer
 
 	void SWPalDrawers::DrawSpanTranslucent(const SpanDrawerArgs& args)
 	{
+		if (DrawPalSpanAVX2(args, AVX2PalParams::Add, false))
+			return;
+
 		const uint8_t* _source = args.TexturePixels();
 		const uint8_t* _colormap = args.Colormap(args.Viewport());
 		uint32_t _xfrac = args.TextureUPos();
@@ -2215,6 +2364,9 @@ namespace swrenderer
 
 	void SWPalDrawers::DrawSpanMaskedTranslucent(const SpanDrawerArgs& args)
 	{
+		if (DrawPalSpanAVX2(args, AVX2PalParams::Add, true))
+			return;
+
 		const uint8_t* _source = args.TexturePixels();
 		const uint8_t* _colormap = args.Colormap(args.Viewport());
 		uint32_t _xfrac = args.TextureUPos();
@@ -2376,6 +2528,9 @@ namespace swrenderer
 
 	void SWPalDrawers::DrawSpanAddClamp(const SpanDrawerArgs& args)
 	{
+		if (DrawPalSpanAVX2(args, AVX2PalParams::AddClamp, false))
+			return;
+
 		const uint8_t* _source = args.TexturePixels();
 		const uint8_t* _colormap = args.Colormap(args.Viewport());
 		uint32_t _xfrac = args.TextureUPos();
@@ -2518,6 +2673,9 @@ namespace swrenderer
 
 	void SWPalDrawers::DrawSpanMaskedAddClamp(const SpanDrawerArgs& args)
 	{
+		if (DrawPalSpanAVX2(args, AVX2PalParams::AddClamp, true))
+			return;
+
 		const uint8_t* _source = args.TexturePixels();
 		const uint8_t* _colormap = args.Colormap(args.Viewport());
 		uint32_t _xfrac = args.TextureUPos();
@@ -0,0 +1,270 @@
+/*
+** r_draw_pal_avx2.cpp
+** AVX2 versions of the paletted wall, span and sprite column drawers
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 GZDoom Maintainers and Contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+** These process eight pixels per iteration and produce exactly the same
+** output as the scalar drawers in r_draw_pal.cpp. All table lookups are
+** done with gathers. Since there is no byte gather, bytes are fetched
+** from the aligned dword that contains them, which never reads outside
+** of the dwords the table occupies.
+**
+** This file must not include anything beyond r_draw_pal_avx2.h, see
+** the comment in r_draw_rgba_avx2.h.
+**
+*/
+
+#include "r_draw_pal_avx2.h"
+
+#ifdef SW_AVX2_DRAWERS
+
+#include <string.h>
+#include <immintrin.h>
+
+#if defined(_MSC_VER)
+#define AVX2INLINE __forceinline
+#else
+#define AVX2INLINE __attribute__((always_inline)) inline
+#endif
+
+namespace swrenderer
+{
+	namespace
+	{
+		AVX2INLINE __m256i GatherBytes(const uint8_t *table, __m256i index, __m256i mask)
+		{
+			uintptr_t misalign = uintptr_t(table) & 3;
+			index = _mm256_add_epi32(index, _mm256_set1_epi32(int(misalign)));
+			__m256i words = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), (const int *)(table - misalign), _mm256_srai_epi32(index, 2), mask, 4);
+			__m256i shift = _mm256_slli_epi32(_mm256_and_si256(index, _mm256_set1_epi32(3)), 3);
+			return _mm256_and_si256(_mm256_srlv_epi32(words, shift), _mm256_set1_epi32(0xff));
+		}
+
+		AVX2INLINE __m256i GatherBytes(const uint8_t *table, __m256i index)
+		{
+			return GatherBytes(table, index, _mm256_set1_epi32(-1));
+		}
+
+		AVX2INLINE __m256i GatherDwords(const uint32_t *table, __m256i index)
+		{
+			return _mm256_i32gather_epi32((const int *)table, index, 4);
+		}
+
+		// Packs eight values in the 0-255 range into the low eight bytes.
+		AVX2INLINE __m128i PackBytes(__m256i v)
+		{
+			v = _mm256_packus_epi32(v, v);
+			v = _mm256_packus_epi16(v, v);
+			return _mm_unpacklo_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+		}
+
+		//==========================================================================
+		//
+		// The RGB32k blends from the scalar drawers, one dword per lane.
+		//
+		//==========================================================================
+
+		template<int BlendMode>
+		AVX2INLINE __m256i Blend(const AVX2PalParams &params, __m256i lit, __m256i bg)
+		{
+			if (BlendMode == AVX2PalParams::Opaque)
+				return lit;
+
+			__m256i fg = GatherDwords(params.FgToRGB, lit);
+			bg = GatherDwords(params.BgToRGB, bg);
+			__m256i carrybits = _mm256_set1_epi32(0x40100400);
+			__m256i a;
+
+			if (BlendMode == AVX2PalParams::Add)
+			{
+				a = _mm256_or_si256(_mm256_add_epi32(fg, bg), _mm256_set1_epi32(0x1f07c1f));
+			}
+			else if (BlendMode == AVX2PalParams::AddClamp)
+			{
+				a = _mm256_add_epi32(fg, bg);
+				__m256i b = _mm256_and_si256(a, carrybits);
+				a = _mm256_and_si256(_mm256_or_si256(a, _mm256_set1_epi32(0x01f07c1f)), _mm256_set1_epi32(0x3fffffff));
+				b = _mm256_sub_epi32(b, _mm256_srli_epi32(b, 5));
+				a = _mm256_or_si256(a, b);
+			}
+			else
+			{
+				if (BlendMode == AVX2PalParams::SubClamp)
+					a = _mm256_sub_epi32(_mm256_or_si256(fg, carrybits), bg);
+				else
+					a = _mm256_sub_epi32(_mm256_or_si256(bg, carrybits), fg);
+				__m256i b = _mm256_and_si256(a, carrybits);
+				b = _mm256_sub_epi32(b, _mm256_srli_epi32(b, 5));
+				a = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_set1_epi32(0x01f07c1f));
+			}
+
+			return GatherBytes(params.RGB32k, _mm256_and_si256(a, _mm256_srli_epi32(a, 15)));
+		}
+
+		//==========================================================================
+		//
+		//
+		//
+		//==========================================================================
+
+		template<int Sampler, int BlendMode>
+		void DrawLoop(const AVX2PalParams &params)
+		{
+			const bool contiguous = Sampler == AVX2PalParams::Span || Sampler == AVX2PalParams::Span64x64;
+			const bool masked = params.Masked;
+			const bool readdest = BlendMode != AVX2PalParams::Opaque || (masked && contiguous);
+
+			__m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+			__m256i zero = _mm256_setzero_si256();
+
+			__m256i frac = _mm256_add_epi32(_mm256_set1_epi32(params.Frac), _mm256_mullo_epi32(lanes, _mm256_set1_epi32(params.FracStep)));
+			__m256i xfrac = _mm256_add_epi32(_mm256_set1_epi32(params.XFrac), _mm256_mullo_epi32(lanes, _mm256_set1_epi32(params.XStep)));
+			__m256i yfrac = _mm256_add_epi32(_mm256_set1_epi32(params.YFrac), _mm256_mullo_epi32(lanes, _mm256_set1_epi32(params.YStep)));
+			__m256i fracstep = _mm256_set1_epi32(params.FracStep * 8);
+			__m256i xstep = _mm256_set1_epi32(params.XStep * 8);
+			__m256i ystep = _mm256_set1_epi32(params.YStep * 8);
+			__m128i bits = _mm_cvtsi32_si128(params.FracBits);
+			__m256i width = _mm256_set1_epi32(params.Width);
+			__m256i height = _mm256_set1_epi32(params.Height);
+
+			uint8_t *dest = params.Dest;
+			int pitch = params.Pitch;
+			int count = params.Count;
+
+			for (int pos = 0; pos < count; pos += 8)
+			{
+				int n = count - pos < 8 ? count - pos : 8;
+				__m256i valid = _mm256_cmpgt_epi32(_mm256_set1_epi32(n), lanes);
+
+				__m256i index;
+				if (Sampler == AVX2PalParams::WallColumn)
+				{
+					index = _mm256_srl_epi32(frac, bits);
+				}
+				else if (Sampler == AVX2PalParams::SpriteColumn)
+				{
+					index = _mm256_srai_epi32(frac, 16);
+				}
+				else if (Sampler == AVX2PalParams::Span64x64)
+				{
+					index = _mm256_add_epi32(_mm256_and_si256(_mm256_srli_epi32(xfrac, 32 - 6 - 6), _mm256_set1_epi32(63 * 64)), _mm256_srli_epi32(yfrac, 32 - 6));
+				}
+				else
+				{
+					__m256i u = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_srli_epi32(xfrac, 16), width), 16);
+					__m256i v = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_srli_epi32(yfrac, 16), height), 16);
+					index = _mm256_add_epi32(_mm256_mullo_epi32(u, height), v);
+				}
+
+				__m256i texel = GatherBytes(params.Source, index, valid);
+				__m256i color = params.Translation ? GatherBytes(params.Translation, texel) : texel;
+				__m256i lit = GatherBytes(params.Colormap, color);
+
+				alignas(16) uint8_t bgbytes[8] = {};
+				if (readdest)
+				{
+					if (contiguous && n == 8)
+						memcpy(bgbytes, dest, 8);
+					else if (contiguous)
+						memcpy(bgbytes, dest, n);
+					else
+						for (int i = 0; i < n; i++) bgbytes[i] = dest[i * pitch];
+				}
+				__m256i bg = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)bgbytes));
+
+				__m256i result = Blend<BlendMode>(params, lit, bg);
+
+				alignas(16) uint8_t outbytes[8];
+				if (contiguous)
+				{
+					if (masked)
+						result = _mm256_blendv_epi8(result, bg, _mm256_cmpeq_epi32(texel, zero));
+					if (n == 8)
+					{
+						_mm_storel_epi64((__m128i *)dest, PackBytes(result));
+					}
+					else
+					{
+						_mm_storel_epi64((__m128i *)outbytes, PackBytes(result));
+						memcpy(dest, outbytes, n);
+					}
+					dest += 8;
+				}
+				else
+				{
+					_mm_storel_epi64((__m128i *)outbytes, PackBytes(result));
+					alignas(32) int32_t texels[8];
+					_mm256_store_si256((__m256i *)texels, texel);
+					for (int i = 0; i < n; i++)
+					{
+						if (!masked || texels[i] != 0)
+							dest[i * pitch] = outbytes[i];
+					}
+					dest += pitch * 8;
+				}
+
+				frac = _mm256_add_epi32(frac, fracstep);
+				xfrac = _mm256_add_epi32(xfrac, xstep);
+				yfrac = _mm256_add_epi32(yfrac, ystep);
+			}
+		}
+
+		template<int Sampler>
+		void DrawSampler(const AVX2PalParams &params)
+		{
+			switch (params.BlendMode)
+			{
+			default:
+			case AVX2PalParams::Opaque: DrawLoop<Sampler, AVX2PalParams::Opaque>(params); break;
+			case AVX2PalParams::Add: DrawLoop<Sampler, AVX2PalParams::Add>(params); break;
+			case AVX2PalParams::AddClamp: DrawLoop<Sampler, AVX2PalParams::AddClamp>(params); break;
+			case AVX2PalParams::SubClamp: DrawLoop<Sampler, AVX2PalParams::SubClamp>(params); break;
+			case AVX2PalParams::RevSubClamp: DrawLoop<Sampler, AVX2PalParams::RevSubClamp>(params); break;
+			}
+		}
+	}
+
+	void DrawPal8AVX2(const AVX2PalParams &params)
+	{
+		if (params.Count <= 0)
+			return;
+
+		switch (params.Sampler)
+		{
+		default:
+		case AVX2PalParams::WallColumn: DrawSampler<AVX2PalParams::WallColumn>(params); break;
+		case AVX2PalParams::SpriteColumn: DrawSampler<AVX2PalParams::SpriteColumn>(params); break;
+		case AVX2PalParams::Span: DrawSampler<AVX2PalParams::Span>(params); break;
+		case AVX2PalParams::Span64x64: DrawSampler<AVX2PalParams::Span64x64>(params); break;
+		}
+	}
+}
+
+#endif
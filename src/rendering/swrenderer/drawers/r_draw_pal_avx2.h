@@ -0,0 +1,76 @@
+/*
+** r_draw_pal_avx2.h
+** AVX2 versions of the paletted wall, span and sprite column drawers
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 GZDoom Maintainers and Contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+** Like the truecolor AVX2 drawers these live in their own translation
+** unit compiled with AVX2 code generation, see r_draw_rgba_avx2.h. Only
+** the classic blending tables are covered. The r_blendmethod path and
+** dynamic lights stay with the scalar drawers.
+**
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include "r_draw_rgba_avx2.h"
+
+namespace swrenderer
+{
+	struct AVX2PalParams
+	{
+		enum BlendModes { Opaque, Add, AddClamp, SubClamp, RevSubClamp };
+		enum Samplers { WallColumn, SpriteColumn, Span, Span64x64 };
+
+		int BlendMode;
+		int Sampler;
+		bool Masked;			// leaves the destination alone where the texel is 0
+		uint8_t *Dest;
+		int Pitch;
+		int Count;
+
+		const uint8_t *Source;
+		const uint8_t *Translation;	// optional
+		const uint8_t *Colormap;
+
+		// Columns. Walls shift the unsigned position by FracBits, sprites are signed 16.16.
+		uint32_t Frac, FracStep;
+		int FracBits;
+
+		// Spans
+		uint32_t XFrac, YFrac, XStep, YStep;
+		uint32_t Width, Height;
+
+		const uint32_t *FgToRGB, *BgToRGB;
+		const uint8_t *RGB32k;
+	};
+
+	void DrawPal8AVX2(const AVX2PalParams &params);
+}
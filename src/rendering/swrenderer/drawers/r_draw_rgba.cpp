@@ -47,6 +47,7 @@
 #include "v_palette.h"
 #include "r_data/colormaps.h"
 #include "r_draw_rgba.h"
+#include "r_draw_rgba_avx2.h"
 #include "swrenderer/viewport/r_viewport.h"
 #include "swrenderer/scene/r_light.h"
 #ifdef NO_SSE
@@ -63,6 +64,7 @@
 
 #include "gi.h"
 #include "stats.h"
+#include "x86.h"
 #include <vector>
 
 ;
@@ -78,8 +80,105 @@ CVAR(Bool, r_mipmap, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG);
 // Level of detail texture bias
 CVAR(Float, r_lod_bias, -1.5, 0); // To do: add CVAR_ARCHIVE | CVAR_GLOBALCONFIG when a good default has been decided
 
+// Use the AVX2 span and sprite drawers if the CPU supports them
+CVAR(Bool, r_avx2drawers, true, 0);
+
 namespace swrenderer
 {
+	// Both return false if the AVX2 drawers are not available, so that the caller can use the SSE2 ones instead.
+	static bool DrawSpanAVX2(const SpanDrawerArgs &args, int blendmode)
+	{
+#ifdef SW_AVX2_DRAWERS
+		if (!r_avx2drawers || !CPU.bAVX2)
+			return false;
+
+		AVX2SpanParams params;
+		params.BlendMode = blendmode;
+		params.Dest = (uint32_t*)args.Viewport()->GetDest(args.DestX1(), args.DestY());
+		params.Count = args.DestX2() - args.DestX1() + 1;
+
+		params.Source = (const uint32_t*)args.TexturePixels();
+		params.Width = args.TextureWidth();
+		params.Height = args.TextureHeight();
+		double lod = args.TextureLOD();
+		bool magnifying = lod < 0.0;
+		if (r_mipmap && args.MipmappedTexture())
+		{
+			int level = (int)lod;
+			while (level > 0 && params.Width > 2 && params.Height > 2)
+			{
+				params.Source += params.Width * params.Height;
+				params.Width = max<uint32_t>(params.Width / 2, 1);
+				params.Height = max<uint32_t>(params.Height / 2, 1);
+				level--;
+			}
+		}
+		params.Linear = !((magnifying && !r_magfilter) || (!magnifying && !r_minfilter));
+		params.XStep = args.TextureUStep();
+		params.YStep = args.TextureVStep();
+		params.XFrac = args.TextureUPos();
+		params.YFrac = args.TextureVPos();
+
+		params.Light = 256 - (args.Light() >> (FRACBITS - 8));
+		params.Shade = args.ColormapConstants();
+		params.SrcAlpha = args.SrcAlpha() >> (FRACBITS - 8);
+		params.DestAlpha = args.DestAlpha() >> (FRACBITS - 8);
+
+		static_assert(AVX2SpanParams::LightTileSize == DrawerLightTiles::TileSize && AVX2SpanParams::MaxTileLights == DrawerLightTiles::MaxLights, "AVX2 light tiles must match DrawerLightTiles");
+		DrawerLightTiles lighttiles(args.dc_lights, args.dc_num_lights, &DrawerLight::x, &DrawerLight::y);
+		params.Lights = args.dc_lights;
+		params.NumLights = args.dc_num_lights;
+		params.LightMin = lighttiles.MinPositions();
+		params.LightMax = lighttiles.MaxPositions();
+		params.ViewPosX = args.dc_viewpos.X;
+		params.ViewPosStepX = args.dc_viewpos_step.X;
+
+		DrawSpan32AVX2(params);
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	static bool DrawColumnAVX2(const SpriteDrawerArgs &args, int blendmode, int sampler)
+	{
+#ifdef SW_AVX2_DRAWERS
+		if (!r_avx2drawers || !CPU.bAVX2)
+			return false;
+
+		AVX2ColumnParams params;
+		params.BlendMode = blendmode;
+		params.Sampler = sampler;
+		params.Dest = (uint32_t*)args.Dest();
+		params.Pitch = args.Viewport()->RenderTarget->GetPitch();
+		params.Count = args.Count();
+
+		bool palettesource = sampler == AVX2ColumnParams::ShadedSampler || sampler == AVX2ColumnParams::Translated;
+		params.Source = (const uint32_t*)args.TexturePixels();
+		params.Source2 = palettesource ? nullptr : (const uint32_t*)args.TexturePixels2();
+		params.Colormap = palettesource ? args.Colormap(args.Viewport()) : nullptr;
+		params.Translation = palettesource ? (const uint32_t*)args.TranslationMap() : nullptr;
+		params.TextureHeight = args.TextureHeight();
+		params.Frac = args.TextureVPos();
+		params.FracStep = args.TextureVStep();
+		params.TextureFracX = args.TextureUPos();
+
+		int light = 256 - (args.Light() >> (FRACBITS - 8));
+		params.Light = light;
+		params.DynamicLight = args.DynamicLight();
+		params.Shade = args.ColormapConstants();
+		params.SrcAlpha = args.SrcAlpha() >> (FRACBITS - 8);
+		params.DestAlpha = args.DestAlpha() >> (FRACBITS - 8);
+		params.SrcColor = args.SrcColorBgra();
+		params.Color = LightBgra::shade_bgra_simple(args.SolidColorBgra(), LightBgra::calc_light_multiplier(light));
+
+		DrawColumn32AVX2(params);
+		return true;
+#else
+		return false;
+#endif
+	}
+
 	void SWTruecolorDrawers::DrawWall(const WallDrawerArgs &args)
 	{
 		DrawWallColumns<DrawWall32Command>(args);
@@ -112,32 +211,38 @@ namespace swrenderer
 	
 	void SWTruecolorDrawers::DrawColumn(const SpriteDrawerArgs &args)
 	{
-		DrawSprite32Command::DrawColumn(args);
+		if (!DrawColumnAVX2(args, AVX2ColumnParams::Opaque, AVX2ColumnParams::Texture))
+			DrawSprite32Command::DrawColumn(args);
 	}
 
 	void SWTruecolorDrawers::FillColumn(const SpriteDrawerArgs &args)
 	{
-		FillSprite32Command::DrawColumn(args);
+		if (!DrawColumnAVX2(args, AVX2ColumnParams::Opaque, AVX2ColumnParams::Fill))
+			FillSprite32Command::DrawColumn(args);
 	}
 
 	void SWTruecolorDrawers::FillAddColumn(const SpriteDrawerArgs &args)
 	{
-		FillSpriteAddClamp32Command::DrawColumn(args);
+		if (!DrawColumnAVX2(args, AVX2ColumnParams::AddClamp, AVX2ColumnParams::Fill))
+			FillSpriteAddClamp32Command::DrawColumn(args);
 	}
 
 	void SWTruecolorDrawers::FillAddClampColumn(const SpriteDrawerArgs &args)
 	{
-		FillSpriteAddClamp32Command::DrawColumn(args);
+		if (!DrawColumnAVX2(args, AVX2ColumnParams::AddClamp, AVX2ColumnParams::Fill))
+			FillSpriteAddClamp32Command::DrawColumn(args);
 	}
 
 	void SWTruecolorDrawers::FillSubClampColumn(const SpriteDrawerArgs &args)
 	{
-		FillSpriteSubClamp32Command::DrawColumn(args);
+		if (!DrawColumnAVX2(args, AVX2ColumnParams::SubClamp, AVX2ColumnParams::Fill))
+			FillSpriteSubClamp32Command::DrawColumn(args);
 	}
 
 	void SWTruecolorDrawers::FillRevSubClampColumn(const SpriteDrawerArgs &args)
 	{
-		FillSpriteRevSubClamp32Command::DrawColumn(args);
+		if (!DrawColumnAVX2(args, AVX2ColumnParams::RevSubClamp, AVX2ColumnParams::Fill))
+			FillSpriteRevSubClamp32Command::DrawColumn(args);
 	}
 
 	void SWTruecolorDrawers::DrawFuzzColumn(const SpriteDrawerArgs &args)
@@ -151,87 +256,104 @@ namespace swrenderer
 
 	void SWTruecolorDrawers::DrawAddColumn(const SpriteDrawerArgs &args)
 	{
-		DrawSpriteAddClamp32Command::DrawColumn(args);
+		if (!DrawColumnAVX2(args, AVX2ColumnParams::AddClamp, AVX2ColumnParams::Texture))
+			DrawSpriteAddClamp32Command::DrawColumn(args);
 	}
 
 	void SWTruecolorDrawers::DrawTranslatedColumn(const SpriteDrawerArgs &args)
 	{
-		DrawSpriteTranslated32Command::DrawColumn(args);
+		if (!DrawColumnAVX2(args, AVX2ColumnParams::Opaque, AVX2ColumnParams::Translated))
+			DrawSpriteTranslated32Command::DrawColumn(args);
 	}
 
 	void SWTruecolorDrawers::DrawTranslatedAddColumn(const SpriteDrawerArgs &args)
 	{
-		DrawSpriteTranslatedAddClamp32Command::DrawColumn(args);
+		if (!DrawColumnAVX2(args, AVX2ColumnParams::AddClamp, AVX2ColumnParams::Translated))
+			DrawSpriteTranslatedAddClamp32Command::DrawColumn(args);
 	}
 
 	void SWTruecolorDrawers::DrawShadedColumn(const SpriteDrawerArgs &args)
 	{
-		DrawSpriteShaded32Command::DrawColumn(args);
+		if (!DrawColumnAVX2(args, AVX2ColumnParams::Shaded, AVX2ColumnParams::ShadedSampler))
+			DrawSpriteShaded32Command::DrawColumn(args);
 	}
 
 	void SWTruecolorDrawers::DrawAddClampShadedColumn(const SpriteDrawerArgs &args)
 	{
-		DrawSpriteAddClampShaded32Command::DrawColumn(args);
+		if (!DrawColumnAVX2(args, AVX2ColumnParams::AddClampShaded, AVX2ColumnParams::ShadedSampler))
+			DrawSpriteAddClampShaded32Command::DrawColumn(args);
 	}
 
 	void SWTruecolorDrawers::DrawAddClampColumn(const SpriteDrawerArgs &args)
 	{
-		DrawSpriteAddClamp32Command::DrawColumn(args);
+		if (!DrawColumnAVX2(args, AVX2ColumnParams::AddClamp, AVX2ColumnParams::Texture))
+			DrawSpriteAddClamp32Command::DrawColumn(args);
 	}
 
 	void SWTruecolorDrawers::DrawAddClampTranslatedColumn(const SpriteDrawerArgs &args)
 	{
-		DrawSpriteTranslatedAddClamp32Command::DrawColumn(args);
+		if (!DrawColumnAVX2(args, AVX2ColumnParams::AddClamp, AVX2ColumnParams::Translated))
+			DrawSpriteTranslatedAddClamp32Command::DrawColumn(args);
 	}
 
 	void SWTruecolorDrawers::DrawSubClampColumn(const SpriteDrawerArgs &args)
 	{
-		DrawSpriteSubClamp32Command::DrawColumn(args);
+		if (!DrawColumnAVX2(args, AVX2ColumnParams::SubClamp, AVX2ColumnParams::Texture))
+			DrawSpriteSubClamp32Command::DrawColumn(args);
 	}
 
 	void SWTruecolorDrawers::DrawSubClampTranslatedColumn(const SpriteDrawerArgs &args)
 	{
-		DrawSpriteTranslatedSubClamp32Command::DrawColumn(args);
+		if (!DrawColumnAVX2(args, AVX2ColumnParams::SubClamp, AVX2ColumnParams::Translated))
+			DrawSpriteTranslatedSubClamp32Command::DrawColumn(args);
 	}
 
 	void SWTruecolorDrawers::DrawRevSubClampColumn(const SpriteDrawerArgs &args)
 	{
-		DrawSpriteRevSubClamp32Command::DrawColumn(args);
+		if (!DrawColumnAVX2(args, AVX2ColumnParams::RevSubClamp, AVX2ColumnParams::Texture))
+			DrawSpriteRevSubClamp32Command::DrawColumn(args);
 	}
 
 	void SWTruecolorDrawers::DrawRevSubClampTranslatedColumn(const SpriteDrawerArgs &args)
 	{
-		DrawSpriteTranslatedRevSubClamp32Command::DrawColumn(args);
+		if (!DrawColumnAVX2(args, AVX2ColumnParams::RevSubClamp, AVX2ColumnParams::Translated))
+			DrawSpriteTranslatedRevSubClamp32Command::DrawColumn(args);
 	}
 
 	void SWTruecolorDrawers::DrawSpan(const SpanDrawerArgs &args)
 	{
-		DrawSpan32Command::DrawColumn(args);
+		if (!DrawSpanAVX2(args, AVX2SpanParams::Opaque))
+			DrawSpan32Command::DrawColumn(args);
 	}
 	
 	void SWTruecolorDrawers::DrawSpanMasked(const SpanDrawerArgs &args)
 	{
-		DrawSpanMasked32Command::DrawColumn(args);
+		if (!DrawSpanAVX2(args, AVX2SpanParams::Masked))
+			DrawSpanMasked32Command::DrawColumn(args);
 	}
 	
 	void SWTruecolorDrawers::DrawSpanTranslucent(const SpanDrawerArgs &args)
 	{
-		DrawSpanTranslucent32Command::DrawColumn(args);
+		if (!DrawSpanAVX2(args, AVX2SpanParams::Translucent))
+			DrawSpanTranslucent32Command::DrawColumn(args);
 	}
 	
 	void SWTruecolorDrawers::DrawSpanMaskedTranslucent(const SpanDrawerArgs &args)
 	{
-		DrawSpanAddClamp32Command::DrawColumn(args);
+		if (!DrawSpanAVX2(args, AVX2SpanParams::AddClamp))
+			DrawSpanAddClamp32Command::DrawColumn(args);
 	}
 	
 	void SWTruecolorDrawers::DrawSpanAddClamp(const SpanDrawerArgs &args)
 	{
-		DrawSpanTranslucent32Command::DrawColumn(args);
+		if (!DrawSpanAVX2(args, AVX2SpanParams::Translucent))
+			DrawSpanTranslucent32Command::DrawColumn(args);
 	}
 	
 	void SWTruecolorDrawers::DrawSpanMaskedAddClamp(const SpanDrawerArgs &args)
 	{
-		DrawSpanAddClamp32Command::DrawColumn(args);
+		if (!DrawSpanAVX2(args, AVX2SpanParams::AddClamp))
+			DrawSpanAddClamp32Command::DrawColumn(args);
 	}
 	
 	void SWTruecolorDrawers::DrawSingleSkyColumn(const SkyDrawerArgs &args)
@@ -1012,10 +1134,19 @@ namespace swrenderer
 			drawerargs.dc_dest_y = block.y;
 			drawerargs.dc_dest = destorig + (block.x + block.y * pitch) * 4;
 
-			for (int j = 0; j < block.width; j++)
+			// The opaque sprite drawer does not depend on x or on what is already on screen,
+			// so only the first column is drawn and then copied to the rest of the block.
+			DrawSprite32Command::DrawColumn(drawerargs);
+			if (block.width > 1)
 			{
-				DrawSprite32Command::DrawColumn(drawerargs);
-				drawerargs.dc_dest += 4;
+				uint32_t *dest = (uint32_t *)drawerargs.dc_dest;
+				for (int y = 0; y < block.height; y++)
+				{
+					uint32_t color = dest[0];
+					for (int j = 1; j < block.width; j++)
+						dest[j] = color;
+					dest += pitch;
+				}
 			}
 		}
 	}
@@ -0,0 +1,704 @@
+/*
+** r_draw_rgba_avx2.cpp
+** AVX2 versions of the truecolor span and sprite column drawers
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 GZDoom Maintainers and Contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+** These process eight pixels per iteration and produce the same results
+** as the SSE2 drawers in r_draw_span32_sse2.h and r_draw_sprite32_sse2.h,
+** except for tiny differences in the dynamic light attenuation of spans
+** caused by computing the view position of each pixel directly.
+**
+** This file must not include anything beyond r_draw_rgba_avx2.h, see
+** the comment there.
+**
+*/
+
+#include "r_draw_rgba_avx2.h"
+
+#ifdef SW_AVX2_DRAWERS
+
+#include <stddef.h>
+#include <immintrin.h>
+
+#if defined(_MSC_VER)
+#define AVX2INLINE __forceinline
+#else
+#define AVX2INLINE __attribute__((always_inline)) inline
+#endif
+
+namespace swrenderer
+{
+	namespace
+	{
+		//==========================================================================
+		//
+		// Eight pixels with 16 bits per channel. Following the in-lane unpack
+		// instructions, lo holds pixels 0, 1, 4, 5 and hi holds pixels 2, 3, 6, 7.
+		//
+		//==========================================================================
+
+		struct Color16
+		{
+			__m256i lo, hi;
+		};
+
+		AVX2INLINE Color16 Unpack(__m256i c)
+		{
+			__m256i zero = _mm256_setzero_si256();
+			return { _mm256_unpacklo_epi8(c, zero), _mm256_unpackhi_epi8(c, zero) };
+		}
+
+		// Packs with unsigned saturation and makes the result opaque.
+		AVX2INLINE __m256i Pack(Color16 c)
+		{
+			return _mm256_or_si256(_mm256_packus_epi16(c.lo, c.hi), _mm256_set1_epi32((int)0xff000000));
+		}
+
+		// Copies a 16 bit value per pixel into all four channels of that pixel.
+		AVX2INLINE Color16 Spread(__m256i v)
+		{
+			v = _mm256_or_si256(_mm256_and_si256(v, _mm256_set1_epi32(0xffff)), _mm256_slli_epi32(v, 16));
+			return { _mm256_unpacklo_epi32(v, v), _mm256_unpackhi_epi32(v, v) };
+		}
+
+		// Same, but leaves the alpha channel at zero.
+		AVX2INLINE Color16 SpreadRGB(__m256i v)
+		{
+			Color16 c = Spread(v);
+			__m256i mask = _mm256_set1_epi64x(0x0000ffffffffffffLL);
+			return { _mm256_and_si256(c.lo, mask), _mm256_and_si256(c.hi, mask) };
+		}
+
+		// The same four channel values for every pixel.
+		AVX2INLINE Color16 Channels(int a, int r, int g, int b)
+		{
+			__m256i c = _mm256_set1_epi64x((int64_t)(((uint64_t)(uint16_t)a << 48) | ((uint64_t)(uint16_t)r << 32) | ((uint64_t)(uint16_t)g << 16) | (uint16_t)b));
+			return { c, c };
+		}
+
+		AVX2INLINE Color16 Channels(uint32_t bgra)
+		{
+			return Channels(bgra >> 24, (bgra >> 16) & 0xff, (bgra >> 8) & 0xff, bgra & 0xff);
+		}
+
+		AVX2INLINE Color16 Add(Color16 a, Color16 b) { return { _mm256_add_epi16(a.lo, b.lo), _mm256_add_epi16(a.hi, b.hi) }; }
+		AVX2INLINE Color16 Mul(Color16 a, Color16 b) { return { _mm256_mullo_epi16(a.lo, b.lo), _mm256_mullo_epi16(a.hi, b.hi) }; }
+		AVX2INLINE Color16 Shr8(Color16 a) { return { _mm256_srli_epi16(a.lo, 8), _mm256_srli_epi16(a.hi, 8) }; }
+		AVX2INLINE Color16 MulShr8(Color16 a, Color16 b) { return Shr8(Mul(a, b)); }
+
+		AVX2INLINE Color16 Min(Color16 a, int value)
+		{
+			__m256i m = _mm256_set1_epi16(value);
+			return { _mm256_min_epi16(a.lo, m), _mm256_min_epi16(a.hi, m) };
+		}
+
+		AVX2INLINE __m256i LaneIndex()
+		{
+			return _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+		}
+
+		//==========================================================================
+		//
+		// Shared by spans and sprites
+		//
+		//==========================================================================
+
+		enum class CombineOp { Add, Sub, RevSub };
+
+		// fg and bg are premultiplied and may each be as large as 255*256, so they get added in 32 bits.
+		template<CombineOp Op>
+		AVX2INLINE __m256i Combine(Color16 fg, Color16 bg)
+		{
+			__m256i zero = _mm256_setzero_si256();
+			__m256i out[2];
+			for (int i = 0; i < 2; i++)
+			{
+				__m256i f = i == 0 ? fg.lo : fg.hi;
+				__m256i b = i == 0 ? bg.lo : bg.hi;
+				__m256i f0 = _mm256_unpacklo_epi16(f, zero);
+				__m256i f1 = _mm256_unpackhi_epi16(f, zero);
+				__m256i b0 = _mm256_unpacklo_epi16(b, zero);
+				__m256i b1 = _mm256_unpackhi_epi16(b, zero);
+				__m256i o0, o1;
+				if (Op == CombineOp::Add)
+				{
+					o0 = _mm256_add_epi32(f0, b0);
+					o1 = _mm256_add_epi32(f1, b1);
+				}
+				else if (Op == CombineOp::Sub)
+				{
+					o0 = _mm256_sub_epi32(f0, b0);
+					o1 = _mm256_sub_epi32(f1, b1);
+				}
+				else
+				{
+					o0 = _mm256_sub_epi32(b0, f0);
+					o1 = _mm256_sub_epi32(b1, f1);
+				}
+				out[i] = _mm256_packs_epi32(_mm256_srai_epi32(o0, 8), _mm256_srai_epi32(o1, 8));
+			}
+			return Pack({ out[0], out[1] });
+		}
+
+		// Blending with the alpha channel of the unshaded texel, as used by the add, sub and revsub styles.
+		template<CombineOp Op>
+		AVX2INLINE __m256i BlendAlpha(Color16 fgcolor, Color16 bgcolor, __m256i texel, uint32_t srcalpha, uint32_t destalpha)
+		{
+			__m256i alpha = _mm256_srli_epi32(texel, 24);
+			alpha = _mm256_add_epi32(alpha, _mm256_srli_epi32(alpha, 7)); // 255->256
+			__m256i inv_alpha = _mm256_sub_epi32(_mm256_set1_epi32(256), alpha);
+			__m256i m128 = _mm256_set1_epi32(128);
+			__m256i bgalpha = _mm256_srli_epi32(_mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(_mm256_set1_epi32(destalpha), alpha), _mm256_slli_epi32(inv_alpha, 8)), m128), 8);
+			__m256i fgalpha = _mm256_srli_epi32(_mm256_add_epi32(_mm256_mullo_epi32(_mm256_set1_epi32(srcalpha), alpha), m128), 8);
+			return Combine<Op>(Mul(fgcolor, Spread(fgalpha)), Mul(bgcolor, Spread(bgalpha)));
+		}
+
+		AVX2INLINE __m256i Intensity(__m256i texel, int desaturate)
+		{
+			__m256i mask = _mm256_set1_epi32(0xff);
+			__m256i red = _mm256_and_si256(_mm256_srli_epi32(texel, 16), mask);
+			__m256i green = _mm256_and_si256(_mm256_srli_epi32(texel, 8), mask);
+			__m256i blue = _mm256_and_si256(texel, mask);
+			__m256i sum = _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(red, _mm256_set1_epi32(77)), _mm256_mullo_epi32(green, _mm256_set1_epi32(143))), _mm256_mullo_epi32(blue, _mm256_set1_epi32(37)));
+			return _mm256_mullo_epi32(_mm256_srli_epi32(sum, 8), _mm256_set1_epi32(desaturate));
+		}
+
+		struct ShadeState
+		{
+			Color16 mlight;
+			Color16 inv_desaturate;
+			Color16 shade_fade;
+			Color16 shade_light;
+			Color16 lightcontrib;
+			int desaturate;
+
+			ShadeState(int light, const ShadeConstants &constants)
+			{
+				mlight = Channels(256, light, light, light);
+				int inv_light = 256 - light;
+				int inv_desat = 256 - constants.desaturate;
+				inv_desaturate = Channels(inv_desat, inv_desat, inv_desat, 256);
+				shade_fade = Mul(Channels(constants.fade_alpha, constants.fade_red, constants.fade_green, constants.fade_blue), Channels(0, inv_light, inv_light, inv_light));
+				shade_light = Channels(constants.light_alpha, constants.light_red, constants.light_green, constants.light_blue);
+				lightcontrib = Channels(0, 0, 0, 0);
+				desaturate = constants.desaturate;
+			}
+
+			AVX2INLINE Color16 Advanced(Color16 fgcolor, __m256i texel) const
+			{
+				fgcolor = Shr8(Add(Mul(fgcolor, inv_desaturate), SpreadRGB(Intensity(texel, desaturate))));
+				fgcolor = Mul(fgcolor, mlight);
+				fgcolor = Shr8(Add(shade_fade, fgcolor));
+				return MulShr8(fgcolor, shade_light);
+			}
+		};
+
+		AVX2INLINE __m256i Gather(const uint32_t *source, __m256i index, __m256i valid)
+		{
+			return _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), (const int *)source, index, valid, 4);
+		}
+
+		// Weights are between 0 and 16, so the 16 bit sums cannot overflow.
+		AVX2INLINE __m256i Bilinear(__m256i p00, __m256i p01, __m256i p10, __m256i p11, __m256i inv_a, __m256i inv_b)
+		{
+			__m256i m16 = _mm256_set1_epi32(16);
+			__m256i a = _mm256_sub_epi32(m16, inv_a);
+			__m256i b = _mm256_sub_epi32(m16, inv_b);
+			Color16 c = Mul(Unpack(p00), Spread(_mm256_mullo_epi32(a, b)));
+			c = Add(c, Mul(Unpack(p01), Spread(_mm256_mullo_epi32(inv_a, b))));
+			c = Add(c, Mul(Unpack(p10), Spread(_mm256_mullo_epi32(a, inv_b))));
+			c = Add(c, Mul(Unpack(p11), Spread(_mm256_mullo_epi32(inv_a, inv_b))));
+			c = Shr8(Add(c, Channels(127, 127, 127, 127)));
+			return _mm256_packus_epi16(c.lo, c.hi);
+		}
+
+		//==========================================================================
+		//
+		// Spans
+		//
+		//==========================================================================
+
+		enum class SpanFilter { Nearest, Nearest64x64, Linear, Linear64x64 };
+
+		template<SpanFilter Filter>
+		AVX2INLINE __m256i SampleSpan(const AVX2SpanParams &p, __m256i xfrac, __m256i yfrac, __m256i xone, __m256i yone, __m256i valid)
+		{
+			__m256i width = _mm256_set1_epi32(p.Width);
+			__m256i height = _mm256_set1_epi32(p.Height);
+
+			if (Filter == SpanFilter::Nearest64x64)
+			{
+				__m256i index = _mm256_add_epi32(_mm256_and_si256(_mm256_srli_epi32(xfrac, 32 - 6 - 6), _mm256_set1_epi32(63 * 64)), _mm256_srli_epi32(yfrac, 32 - 6));
+				return Gather(p.Source, index, valid);
+			}
+			else if (Filter == SpanFilter::Nearest)
+			{
+				__m256i x = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_srli_epi32(xfrac, 16), width), 16);
+				__m256i y = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_srli_epi32(yfrac, 16), height), 16);
+				return Gather(p.Source, _mm256_add_epi32(_mm256_mullo_epi32(x, height), y), valid);
+			}
+			else
+			{
+				__m256i frac_x, frac_y, p00, p01, p10, p11;
+				if (Filter == SpanFilter::Linear64x64)
+				{
+					frac_x = _mm256_slli_epi32(_mm256_srli_epi32(xfrac, 16), 6);
+					frac_y = _mm256_slli_epi32(_mm256_srli_epi32(yfrac, 16), 6);
+					__m256i mask = _mm256_set1_epi32(0x3f);
+					__m256i x0 = _mm256_srli_epi32(frac_x, 16);
+					__m256i y0 = _mm256_srli_epi32(frac_y, 16);
+					__m256i x1 = _mm256_slli_epi32(_mm256_and_si256(_mm256_add_epi32(x0, _mm256_set1_epi32(1)), mask), 6);
+					__m256i y1 = _mm256_and_si256(_mm256_add_epi32(y0, _mm256_set1_epi32(1)), mask);
+					x0 = _mm256_slli_epi32(x0, 6);
+					p00 = Gather(p.Source, _mm256_add_epi32(y0, x0), valid);
+					p01 = Gather(p.Source, _mm256_add_epi32(y1, x0), valid);
+					p10 = Gather(p.Source, _mm256_add_epi32(y0, x1), valid);
+					p11 = Gather(p.Source, _mm256_add_epi32(y1, x1), valid);
+				}
+				else
+				{
+					frac_x = _mm256_mullo_epi32(_mm256_srli_epi32(xfrac, 16), width);
+					frac_y = _mm256_mullo_epi32(_mm256_srli_epi32(yfrac, 16), height);
+					__m256i x0 = _mm256_mullo_epi32(_mm256_srli_epi32(frac_x, 16), height);
+					__m256i y0 = _mm256_srli_epi32(frac_y, 16);
+					__m256i x1 = _mm256_mullo_epi32(_mm256_srli_epi32(_mm256_mullo_epi32(_mm256_srli_epi32(_mm256_add_epi32(xfrac, xone), 16), width), 16), height);
+					__m256i y1 = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_srli_epi32(_mm256_add_epi32(yfrac, yone), 16), height), 16);
+					p00 = Gather(p.Source, _mm256_add_epi32(y0, x0), valid);
+					p01 = Gather(p.Source, _mm256_add_epi32(y1, x0), valid);
+					p10 = Gather(p.Source, _mm256_add_epi32(y0, x1), valid);
+					p11 = Gather(p.Source, _mm256_add_epi32(y1, x1), valid);
+				}
+
+				__m256i mask = _mm256_set1_epi32(15);
+				__m256i inv_b = _mm256_and_si256(_mm256_srli_epi32(frac_x, 12), mask);
+				__m256i inv_a = _mm256_and_si256(_mm256_srli_epi32(frac_y, 12), mask);
+				return Bilinear(p00, p01, p10, p11, inv_a, inv_b);
+			}
+		}
+
+		AVX2INLINE Color16 AddSpanLights(Color16 material, Color16 fgcolor, const DrawerLight *lights, int num_lights, __m256 viewpos_x)
+		{
+			Color16 lit = Channels(0, 0, 0, 0);
+			__m256 m256 = _mm256_set1_ps(256.0f);
+			for (int i = 0; i != num_lights; i++)
+			{
+				__m256 light_x = _mm256_set1_ps(lights[i].x);
+				__m256 light_y = _mm256_set1_ps(lights[i].y);
+				__m256 light_z = _mm256_set1_ps(lights[i].z);
+				__m256 light_radius = _mm256_set1_ps(lights[i].radius);
+
+				// See DrawSpan32T::AddLights for the math.
+				__m256 Lx = _mm256_sub_ps(light_x, viewpos_x);
+				__m256 dist2 = _mm256_add_ps(light_y, _mm256_mul_ps(Lx, Lx));
+				__m256 rcp_dist = _mm256_rsqrt_ps(dist2);
+				__m256 dist = _mm256_mul_ps(dist2, rcp_dist);
+				__m256 distance_attenuation = _mm256_sub_ps(m256, _mm256_min_ps(_mm256_mul_ps(dist, light_radius), m256));
+				__m256 point_attenuation = _mm256_mul_ps(_mm256_mul_ps(light_z, rcp_dist), distance_attenuation);
+				__m256 is_attenuated = _mm256_cmp_ps(light_z, _mm256_setzero_ps(), _CMP_EQ_OQ);
+				__m256i attenuation = _mm256_cvtps_epi32(_mm256_blendv_ps(point_attenuation, distance_attenuation, is_attenuated));
+				attenuation = _mm256_max_epi32(_mm256_min_epi32(attenuation, _mm256_set1_epi32(32767)), _mm256_set1_epi32(-32768));
+
+				lit = Add(lit, MulShr8(Channels(lights[i].color), Spread(attenuation)));
+			}
+			lit = Min(lit, 256);
+			return Min(Add(fgcolor, MulShr8(material, lit)), 255);
+		}
+
+		template<int BlendMode, bool AdvancedShade, SpanFilter Filter>
+		void DrawSpanLoop(const AVX2SpanParams &p)
+		{
+			ShadeState shade(p.Light, p.Shade);
+
+			uint32_t xone = (0x80000000u / p.Width) << 1;
+			uint32_t yone = (0x80000000u / p.Height) << 1;
+			uint32_t xfrac = p.XFrac;
+			uint32_t yfrac = p.YFrac;
+			if (Filter == SpanFilter::Linear || Filter == SpanFilter::Linear64x64)
+			{
+				xfrac -= xone / 2;
+				yfrac -= yone / 2;
+			}
+
+			__m256i lanes = LaneIndex();
+			__m256i xfracv = _mm256_add_epi32(_mm256_set1_epi32(xfrac), _mm256_mullo_epi32(lanes, _mm256_set1_epi32(p.XStep)));
+			__m256i yfracv = _mm256_add_epi32(_mm256_set1_epi32(yfrac), _mm256_mullo_epi32(lanes, _mm256_set1_epi32(p.YStep)));
+			__m256i xstep8 = _mm256_set1_epi32(p.XStep * 8);
+			__m256i ystep8 = _mm256_set1_epi32(p.YStep * 8);
+			__m256i xonev = _mm256_set1_epi32(xone);
+			__m256i yonev = _mm256_set1_epi32(yone);
+
+			__m256 viewpos_x = _mm256_add_ps(_mm256_set1_ps(p.ViewPosX), _mm256_mul_ps(_mm256_cvtepi32_ps(lanes), _mm256_set1_ps(p.ViewPosStepX)));
+			__m256 step_viewpos_x = _mm256_set1_ps(p.ViewPosStepX * 8.0f);
+
+			DrawerLight gathered[AVX2SpanParams::MaxTileLights];
+			const DrawerLight *tilelights = p.Lights;
+			int tilenumlights = p.NumLights;
+			int nexttile = 0;
+
+			uint32_t *dest = p.Dest;
+			for (int index = 0; index < p.Count; index += 8)
+			{
+				if (index == nexttile && p.NumLights > 0 && p.LightMin)
+				{
+					// Same test as DrawerLightTiles::Gather
+					nexttile = index + AVX2SpanParams::LightTileSize;
+					int last = (nexttile < p.Count ? nexttile : p.Count) - 1;
+					float pos0 = p.ViewPosX + index * p.ViewPosStepX;
+					float pos1 = p.ViewPosX + last * p.ViewPosStepX;
+					float pad = p.ViewPosStepX < 0.0f ? -p.ViewPosStepX : p.ViewPosStepX;
+					float lo = (pos0 < pos1 ? pos0 : pos1) - pad;
+					float hi = (pos0 < pos1 ? pos1 : pos0) + pad;
+					tilenumlights = 0;
+					for (int i = 0; i < p.NumLights; i++)
+					{
+						if (p.LightMax[i] >= lo && p.LightMin[i] <= hi)
+							gathered[tilenumlights++] = p.Lights[i];
+					}
+					tilelights = gathered;
+				}
+
+				__m256i valid = _mm256_cmpgt_epi32(_mm256_set1_epi32(p.Count - index), lanes);
+
+				__m256i texel = SampleSpan<Filter>(p, xfracv, yfracv, xonev, yonev, valid);
+				Color16 fgcolor = Unpack(texel);
+				Color16 material = fgcolor;
+				if (AdvancedShade)
+					fgcolor = shade.Advanced(fgcolor, texel);
+				else
+					fgcolor = MulShr8(fgcolor, shade.mlight);
+				if (tilenumlights > 0)
+					fgcolor = AddSpanLights(material, fgcolor, tilelights, tilenumlights, viewpos_x);
+
+				__m256i bg = _mm256_setzero_si256();
+				if (BlendMode != AVX2SpanParams::Opaque)
+					bg = _mm256_maskload_epi32((const int *)(dest + index), valid);
+
+				__m256i outcolor;
+				if (BlendMode == AVX2SpanParams::Opaque)
+				{
+					outcolor = Pack(fgcolor);
+				}
+				else if (BlendMode == AVX2SpanParams::Masked)
+				{
+					__m256i fg = _mm256_packus_epi16(fgcolor.lo, fgcolor.hi);
+					__m256i mask = _mm256_cmpeq_epi32(fg, _mm256_setzero_si256());
+					outcolor = _mm256_or_si256(_mm256_blendv_epi8(fg, bg, mask), _mm256_set1_epi32((int)0xff000000));
+				}
+				else if (BlendMode == AVX2SpanParams::Translucent)
+				{
+					Color16 fgalpha = Channels(p.SrcAlpha, p.SrcAlpha, p.SrcAlpha, p.SrcAlpha);
+					Color16 bgalpha = Channels(p.DestAlpha, p.DestAlpha, p.DestAlpha, p.DestAlpha);
+					outcolor = Combine<CombineOp::Add>(Mul(fgcolor, fgalpha), Mul(Unpack(bg), bgalpha));
+				}
+				else if (BlendMode == AVX2SpanParams::AddClamp)
+				{
+					outcolor = BlendAlpha<CombineOp::Add>(fgcolor, Unpack(bg), texel, p.SrcAlpha, p.DestAlpha);
+				}
+				else if (BlendMode == AVX2SpanParams::SubClamp)
+				{
+					outcolor = BlendAlpha<CombineOp::Sub>(fgcolor, Unpack(bg), texel, p.SrcAlpha, p.DestAlpha);
+				}
+				else
+				{
+					outcolor = BlendAlpha<CombineOp::RevSub>(fgcolor, Unpack(bg), texel, p.SrcAlpha, p.DestAlpha);
+				}
+
+				if (p.Count - index >= 8)
+					_mm256_storeu_si256((__m256i *)(dest + index), outcolor);
+				else
+					_mm256_maskstore_epi32((int *)(dest + index), valid, outcolor);
+
+				xfracv = _mm256_add_epi32(xfracv, xstep8);
+				yfracv = _mm256_add_epi32(yfracv, ystep8);
+				viewpos_x = _mm256_add_ps(viewpos_x, step_viewpos_x);
+			}
+		}
+
+		template<int BlendMode, bool AdvancedShade>
+		void DrawSpanShaded(const AVX2SpanParams &p)
+		{
+			bool is64x64 = p.Width == 64 && p.Height == 64;
+			if (p.Linear)
+			{
+				if (is64x64) DrawSpanLoop<BlendMode, AdvancedShade, SpanFilter::Linear64x64>(p);
+				else DrawSpanLoop<BlendMode, AdvancedShade, SpanFilter::Linear>(p);
+			}
+			else
+			{
+				if (is64x64) DrawSpanLoop<BlendMode, AdvancedShade, SpanFilter::Nearest64x64>(p);
+				else DrawSpanLoop<BlendMode, AdvancedShade, SpanFilter::Nearest>(p);
+			}
+		}
+
+		template<int BlendMode>
+		void DrawSpanBlend(const AVX2SpanParams &p)
+		{
+			if (p.Shade.simple_shade)
+				DrawSpanShaded<BlendMode, false>(p);
+			else
+				DrawSpanShaded<BlendMode, true>(p);
+		}
+
+		//==========================================================================
+		//
+		// Sprite columns
+		//
+		//==========================================================================
+
+		template<int Sampler, bool Linear>
+		AVX2INLINE __m256i SampleColumn(const AVX2ColumnParams &p, __m256i frac, uint32_t one, int n, __m256i valid, __m256i &shade)
+		{
+			if (Sampler == AVX2ColumnParams::Fill)
+			{
+				return _mm256_set1_epi32(p.SrcColor);
+			}
+			else if (Sampler == AVX2ColumnParams::ShadedSampler)
+			{
+				alignas(32) uint32_t fracs[8], shades[8] = {};
+				_mm256_store_si256((__m256i *)fracs, frac);
+				const uint8_t *sourcepal = (const uint8_t *)p.Source;
+				for (int i = 0; i < n; i++)
+				{
+					uint32_t value = p.Colormap[sourcepal[fracs[i] >> 16]];
+					shades[i] = (value < 64 ? value : 64) * 4;
+				}
+				shade = _mm256_load_si256((const __m256i *)shades);
+				return _mm256_set1_epi32(p.Color);
+			}
+			else if (Sampler == AVX2ColumnParams::Translated)
+			{
+				alignas(32) uint32_t fracs[8], colors[8] = {};
+				_mm256_store_si256((__m256i *)fracs, frac);
+				const uint8_t *sourcepal = (const uint8_t *)p.Source;
+				for (int i = 0; i < n; i++)
+				{
+					colors[i] = p.Translation[sourcepal[fracs[i] >> 16]];
+				}
+				return _mm256_load_si256((const __m256i *)colors);
+			}
+			else if (!Linear)
+			{
+				__m256i index = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_srli_epi32(_mm256_slli_epi32(frac, 2), 16), _mm256_set1_epi32(p.TextureHeight)), 16);
+				return Gather(p.Source, index, valid);
+			}
+			else
+			{
+				// Clamp to edge
+				__m256i height = _mm256_set1_epi32(p.TextureHeight);
+				__m256i limit = _mm256_set1_epi32(1 << 30);
+				__m256i frac_y0 = _mm256_mullo_epi32(_mm256_srli_epi32(_mm256_min_epu32(frac, limit), 14), height);
+				__m256i frac_y1 = _mm256_mullo_epi32(_mm256_srli_epi32(_mm256_min_epu32(_mm256_add_epi32(frac, _mm256_set1_epi32(one)), limit), 14), height);
+				__m256i y0 = _mm256_srli_epi32(frac_y0, 16);
+				__m256i y1 = _mm256_srli_epi32(frac_y1, 16);
+
+				__m256i p00 = Gather(p.Source, y0, valid);
+				__m256i p01 = Gather(p.Source, y1, valid);
+				__m256i p10 = Gather(p.Source2, y0, valid);
+				__m256i p11 = Gather(p.Source2, y1, valid);
+
+				__m256i inv_b = _mm256_set1_epi32(p.TextureFracX);
+				__m256i inv_a = _mm256_and_si256(_mm256_srli_epi32(frac_y1, 12), _mm256_set1_epi32(15));
+				return Bilinear(p00, p01, p10, p11, inv_a, inv_b);
+			}
+		}
+
+		template<int BlendMode, int Sampler, bool AdvancedShade, bool Linear>
+		void DrawColumnLoop(const AVX2ColumnParams &p)
+		{
+			int count = p.Count;
+			if (count <= 0) return;
+
+			int textureheight = p.TextureHeight;
+			uint32_t one = Sampler == AVX2ColumnParams::Texture ? ((0x20000000 + textureheight - 1) / textureheight) * 2 + 1 : 0;
+			uint32_t frac = p.Frac;
+			if (Linear)
+				frac -= one / 2;
+
+			ShadeState shade(p.Light, p.Shade);
+			Color16 dynlight = Channels(p.DynamicLight);
+			if (AdvancedShade)
+			{
+				shade.lightcontrib = Min(Add(shade.mlight, dynlight), 256);
+				shade.lightcontrib = { _mm256_sub_epi16(shade.lightcontrib.lo, shade.mlight.lo), _mm256_sub_epi16(shade.lightcontrib.hi, shade.mlight.hi) };
+			}
+			else
+			{
+				shade.mlight = Min(Add(shade.mlight, dynlight), 256);
+			}
+
+			const bool needsbg = BlendMode != AVX2ColumnParams::Opaque && BlendMode != AVX2ColumnParams::Copy;
+			__m256i lanes = LaneIndex();
+			__m256i fracv = _mm256_add_epi32(_mm256_set1_epi32(frac), _mm256_mullo_epi32(lanes, _mm256_set1_epi32(p.FracStep)));
+			__m256i fracstep8 = _mm256_set1_epi32(p.FracStep * 8);
+			int pitch = p.Pitch;
+
+			for (int index = 0; index < count; index += 8)
+			{
+				int n = count - index < 8 ? count - index : 8;
+				__m256i valid = _mm256_cmpgt_epi32(_mm256_set1_epi32(n), lanes);
+				uint32_t *dest = p.Dest + (ptrdiff_t)index * pitch;
+
+				alignas(32) uint32_t pixels[8] = {};
+				if (needsbg)
+				{
+					for (int i = 0; i < n; i++)
+						pixels[i] = dest[i * pitch];
+				}
+
+				__m256i shadealpha = _mm256_setzero_si256();
+				__m256i texel = SampleColumn<Sampler, Linear>(p, fracv, one, n, valid, shadealpha);
+				Color16 fgcolor = Unpack(texel);
+
+				if (BlendMode != AVX2ColumnParams::Copy)
+				{
+					if (AdvancedShade)
+					{
+						Color16 lit_dynlight = MulShr8(fgcolor, shade.lightcontrib);
+						fgcolor = Min(Add(shade.Advanced(fgcolor, texel), lit_dynlight), 255);
+					}
+					else
+					{
+						fgcolor = MulShr8(fgcolor, shade.mlight);
+					}
+				}
+
+				Color16 bgcolor = Unpack(_mm256_load_si256((const __m256i *)pixels));
+				__m256i outcolor;
+				if (BlendMode == AVX2ColumnParams::Opaque || BlendMode == AVX2ColumnParams::Copy)
+				{
+					outcolor = Pack(fgcolor);
+				}
+				else if (BlendMode == AVX2ColumnParams::Shaded)
+				{
+					Color16 alpha = Spread(shadealpha);
+					Color16 inv_alpha = Spread(_mm256_sub_epi32(_mm256_set1_epi32(256), shadealpha));
+					outcolor = Pack(Shr8(Add(Mul(fgcolor, alpha), Mul(bgcolor, inv_alpha))));
+				}
+				else if (BlendMode == AVX2ColumnParams::AddClampShaded)
+				{
+					outcolor = Pack(Add(MulShr8(fgcolor, Spread(shadealpha)), bgcolor));
+				}
+				else if (BlendMode == AVX2ColumnParams::AddClamp)
+				{
+					outcolor = BlendAlpha<CombineOp::Add>(fgcolor, bgcolor, texel, p.SrcAlpha, p.DestAlpha);
+				}
+				else if (BlendMode == AVX2ColumnParams::SubClamp)
+				{
+					outcolor = BlendAlpha<CombineOp::Sub>(fgcolor, bgcolor, texel, p.SrcAlpha, p.DestAlpha);
+				}
+				else
+				{
+					outcolor = BlendAlpha<CombineOp::RevSub>(fgcolor, bgcolor, texel, p.SrcAlpha, p.DestAlpha);
+				}
+
+				_mm256_store_si256((__m256i *)pixels, outcolor);
+				for (int i = 0; i < n; i++)
+					dest[i * pitch] = pixels[i];
+
+				fracv = _mm256_add_epi32(fracv, fracstep8);
+			}
+		}
+
+		template<int BlendMode, int Sampler>
+		void DrawColumnBlend(const AVX2ColumnParams &p)
+		{
+			// Only textures get linear filtering.
+			bool linear = Sampler == AVX2ColumnParams::Texture && p.Source2 != nullptr;
+			if (p.Shade.simple_shade)
+			{
+				if (linear) DrawColumnLoop<BlendMode, Sampler, false, true>(p);
+				else DrawColumnLoop<BlendMode, Sampler, false, false>(p);
+			}
+			else
+			{
+				if (linear) DrawColumnLoop<BlendMode, Sampler, true, true>(p);
+				else DrawColumnLoop<BlendMode, Sampler, true, false>(p);
+			}
+		}
+
+		// The shaded sampler is only used with the shaded styles, the others share the regular ones.
+		template<int Sampler>
+		void DrawColumnSampler(const AVX2ColumnParams &p)
+		{
+			switch (p.BlendMode)
+			{
+			default:
+			case AVX2ColumnParams::Opaque: DrawColumnBlend<AVX2ColumnParams::Opaque, Sampler>(p); break;
+			case AVX2ColumnParams::Copy: DrawColumnBlend<AVX2ColumnParams::Copy, Sampler>(p); break;
+			case AVX2ColumnParams::AddClamp: DrawColumnBlend<AVX2ColumnParams::AddClamp, Sampler>(p); break;
+			case AVX2ColumnParams::SubClamp: DrawColumnBlend<AVX2ColumnParams::SubClamp, Sampler>(p); break;
+			case AVX2ColumnParams::RevSubClamp: DrawColumnBlend<AVX2ColumnParams::RevSubClamp, Sampler>(p); break;
+			}
+		}
+
+		template<>
+		void DrawColumnSampler<AVX2ColumnParams::ShadedSampler>(const AVX2ColumnParams &p)
+		{
+			if (p.BlendMode == AVX2ColumnParams::AddClampShaded)
+				DrawColumnBlend<AVX2ColumnParams::AddClampShaded, AVX2ColumnParams::ShadedSampler>(p);
+			else
+				DrawColumnBlend<AVX2ColumnParams::Shaded, AVX2ColumnParams::ShadedSampler>(p);
+		}
+	}
+
+	//==========================================================================
+	//
+	//
+	//
+	//==========================================================================
+
+	void DrawSpan32AVX2(const AVX2SpanParams &params)
+	{
+		switch (params.BlendMode)
+		{
+		default:
+		case AVX2SpanParams::Opaque: DrawSpanBlend<AVX2SpanParams::Opaque>(params); break;
+		case AVX2SpanParams::Masked: DrawSpanBlend<AVX2SpanParams::Masked>(params); break;
+		case AVX2SpanParams::Translucent: DrawSpanBlend<AVX2SpanParams::Translucent>(params); break;
+		case AVX2SpanParams::AddClamp: DrawSpanBlend<AVX2SpanParams::AddClamp>(params); break;
+		case AVX2SpanParams::SubClamp: DrawSpanBlend<AVX2SpanParams::SubClamp>(params); break;
+		case AVX2SpanParams::RevSubClamp: DrawSpanBlend<AVX2SpanParams::RevSubClamp>(params); break;
+		}
+	}
+
+	void DrawColumn32AVX2(const AVX2ColumnParams &params)
+	{
+		switch (params.Sampler)
+		{
+		default:
+		case AVX2ColumnParams::Texture: DrawColumnSampler<AVX2ColumnParams::Texture>(params); break;
+		case AVX2ColumnParams::Fill: DrawColumnSampler<AVX2ColumnParams::Fill>(params); break;
+		case AVX2ColumnParams::ShadedSampler: DrawColumnSampler<AVX2ColumnParams::ShadedSampler>(params); break;
+		case AVX2ColumnParams::Translated: DrawColumnSampler<AVX2ColumnParams::Translated>(params); break;
+		}
+	}
+}
+
+#endif
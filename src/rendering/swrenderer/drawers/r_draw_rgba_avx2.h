@@ -0,0 +1,109 @@
+/*
+** r_draw_rgba_avx2.h
+** AVX2 versions of the truecolor span and sprite column drawers
+**
+**---------------------------------------------------------------------------
+** Copyright 2026 GZDoom Maintainers and Contributors
+** All rights reserved.
+**
+** Redistribution and use in source and binary forms, with or without
+** modification, are permitted provided that the following conditions
+** are met:
+**
+** 1. Redistributions of source code must retain the above copyright
+**    notice, this list of conditions and the following disclaimer.
+** 2. Redistributions in binary form must reproduce the above copyright
+**    notice, this list of conditions and the following disclaimer in the
+**    documentation and/or other materials provided with the distribution.
+** 3. The name of the author may not be used to endorse or promote products
+**    derived from this software without specific prior written permission.
+**
+** THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+** IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+** OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+** IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+** INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+** NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+** DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+** THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+** (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+** THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**---------------------------------------------------------------------------
+**
+** The drawers live in their own translation unit which is compiled with
+** AVX2 code generation enabled. Everything they need is handed over as
+** plain data so that this unit never instantiates inline code that is
+** shared with the rest of the renderer, which the linker could otherwise
+** pick for CPUs that do not support AVX2.
+**
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include "swrenderer/viewport/r_shadeconstants.h"
+
+#if !defined(NO_SSE) && (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86))
+#define SW_AVX2_DRAWERS
+#endif
+
+namespace swrenderer
+{
+	struct AVX2SpanParams
+	{
+		enum BlendModes { Opaque, Masked, Translucent, AddClamp, SubClamp, RevSubClamp };
+
+		int BlendMode;
+		uint32_t *Dest;
+		int Count;
+
+		const uint32_t *Source;	// already at the right mipmap level
+		uint32_t Width, Height;
+		uint32_t XStep, YStep;
+		uint32_t XFrac, YFrac;
+		bool Linear;
+
+		int Light;		// 0-256
+		ShadeConstants Shade;
+		uint32_t SrcAlpha, DestAlpha;	// 0-256
+
+		// Same tiling as DrawerLightTiles. Its inline code must not be compiled into the AVX2 file,
+		// so the caller computes the reach of the lights (null when all lights are used everywhere).
+		enum { LightTileSize = 16, MaxTileLights = 32 };
+
+		const DrawerLight *Lights;
+		int NumLights;
+		const float *LightMin, *LightMax;
+		float ViewPosX, ViewPosStepX;
+	};
+
+	struct AVX2ColumnParams
+	{
+		enum BlendModes { Copy, Opaque, Shaded, AddClampShaded, AddClamp, SubClamp, RevSubClamp };
+		enum Samplers { Texture, Fill, ShadedSampler, Translated };
+
+		int BlendMode;
+		int Sampler;
+		uint32_t *Dest;
+		int Pitch;
+		int Count;
+
+		const uint32_t *Source;
+		const uint32_t *Source2;	// only set for linear filtering of textures
+		const uint8_t *Colormap;
+		const uint32_t *Translation;
+		int TextureHeight;
+		uint32_t Frac, FracStep;
+		uint32_t TextureFracX;
+
+		int Light;		// 0-256
+		uint32_t DynamicLight;
+		ShadeConstants Shade;
+		uint32_t SrcAlpha, DestAlpha;	// 0-256
+		uint32_t SrcColor;		// for the fill sampler
+		uint32_t Color;			// for the shaded sampler, already lit
+	};
+
+	void DrawSpan32AVX2(const AVX2SpanParams &params);
+	void DrawColumn32AVX2(const AVX2ColumnParams &params);
+}
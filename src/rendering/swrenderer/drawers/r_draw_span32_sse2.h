@@ -24,6 +24,7 @@
 
 #include "swrenderer/drawers/r_draw_rgba.h"
 #include "swrenderer/viewport/r_spandrawer.h"
+#include "swrenderer/drawers/r_draw_lights32.h"
 
 namespace swrenderer
 {
@@ -179,6 +180,11 @@ namespace swrenderer
 			__m128 viewpos_x = _mm_setr_ps(vpx, vpx + stepvpx, 0.0f, 0.0f);
 			__m128 step_viewpos_x = _mm_set1_ps(stepvpx * 2.0f);
 
+			DrawerLightTiles lighttiles(lights, num_lights, &DrawerLight::x, &DrawerLight::y);
+			const DrawerLight *tilelights = lights;
+			int tilenumlights = num_lights;
+			int nexttile = 0;
+
 			int count = args.DestX2() - args.DestX1() + 1;
 			int pitch = args.Viewport()->RenderTarget->GetPitch();
 			uint32_t *dest = (uint32_t*)args.Viewport()->GetDest(args.DestX1(), args.DestY());
@@ -195,6 +201,13 @@ namespace swrenderer
 			int ssecount = count / 2;
 			for (int index = 0; index < ssecount; index++)
 			{
+				if (index == nexttile && num_lights != 0)
+				{
+					nexttile = min(index + DrawerLightTiles::TileSize / 2, ssecount);
+					tilenumlights = lighttiles.Gather(vpx + index * 2 * stepvpx, vpx + (nexttile * 2 - 1) * stepvpx, stepvpx);
+					tilelights = lighttiles.Lights();
+				}
+
 				int offset = index * 2;
 
 				__m128i bgcolor;
@@ -218,7 +231,7 @@ namespace swrenderer
 
 				__m128i fgcolor = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)ifgcolor), _mm_setzero_si128());
 
-				fgcolor = Shade<ShadeModeT>(fgcolor, mlight, ifgcolor[0], ifgcolor[1], desaturate, inv_desaturate, shade_fade, shade_light, lights, num_lights, viewpos_x);
+				fgcolor = Shade<ShadeModeT>(fgcolor, mlight, ifgcolor[0], ifgcolor[1], desaturate, inv_desaturate, shade_fade, shade_light, tilelights, tilenumlights, viewpos_x);
 				__m128i outcolor = Blend(fgcolor, bgcolor, srcalpha, destalpha, ifgcolor[0], ifgcolor[1]);
 
 				_mm_storel_epi64((__m128i*)(dest + offset), outcolor);
@@ -230,6 +243,12 @@ namespace swrenderer
 				int index = ssecount * 2;
 				int offset = index;
 
+				if (num_lights != 0)
+				{
+					tilenumlights = lighttiles.Gather(vpx + index * stepvpx, vpx + index * stepvpx, stepvpx);
+					tilelights = lighttiles.Lights();
+				}
+
 				__m128i bgcolor;
 				if (BlendT::Mode != (int)SpanBlendModes::Opaque)
 				{
@@ -247,7 +266,7 @@ namespace swrenderer
 
 				__m128i fgcolor = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)ifgcolor), _mm_setzero_si128());
 
-				fgcolor = Shade<ShadeModeT>(fgcolor, mlight, ifgcolor[0], ifgcolor[1], desaturate, inv_desaturate, shade_fade, shade_light, lights, num_lights, viewpos_x);
+				fgcolor = Shade<ShadeModeT>(fgcolor, mlight, ifgcolor[0], ifgcolor[1], desaturate, inv_desaturate, shade_fade, shade_light, tilelights, tilenumlights, viewpos_x);
 				__m128i outcolor = Blend(fgcolor, bgcolor, srcalpha, destalpha, ifgcolor[0], ifgcolor[1]);
 
 				dest[offset] = _mm_cvtsi128_si32(outcolor);
@@ -356,40 +375,37 @@ namespace swrenderer
 
 			__m128i lit = _mm_setzero_si128();
 
-			for (int i = 0; i != num_lights; i++)
+			// Two lights at a time: lanes 0 and 1 hold the two pixels for the first light, lanes 2 and 3 for the second.
+			__m128 viewpos_x2 = _mm_movelh_ps(viewpos_x, viewpos_x);
+			int i = 0;
+			for (; i + 1 < num_lights; i += 2)
+			{
+				const DrawerLight &light0 = lights[i];
+				const DrawerLight &light1 = lights[i + 1];
+				__m128 light_x = _mm_setr_ps(light0.x, light0.x, light1.x, light1.x);
+				__m128 light_y = _mm_setr_ps(light0.y, light0.y, light1.y, light1.y);
+				__m128 light_z = _mm_setr_ps(light0.z, light0.z, light1.z, light1.z);
+				__m128 light_radius = _mm_setr_ps(light0.radius, light0.radius, light1.radius, light1.radius);
+
+				__m128i attenuation = CalcAttenuation(light_x, light_y, light_z, light_radius, viewpos_x2);
+				__m128i attenuation0 = _mm_packs_epi32(_mm_shuffle_epi32(attenuation, _MM_SHUFFLE(0, 0, 0, 0)), _mm_shuffle_epi32(attenuation, _MM_SHUFFLE(1, 1, 1, 1)));
+				__m128i attenuation1 = _mm_packs_epi32(_mm_shuffle_epi32(attenuation, _MM_SHUFFLE(2, 2, 2, 2)), _mm_shuffle_epi32(attenuation, _MM_SHUFFLE(3, 3, 3, 3)));
+
+				lit = _mm_add_epi16(lit, _mm_srli_epi16(_mm_mullo_epi16(LightColor(light0.color), attenuation0), 8));
+				lit = _mm_add_epi16(lit, _mm_srli_epi16(_mm_mullo_epi16(LightColor(light1.color), attenuation1), 8));
+			}
+
+			if (i != num_lights)
 			{
 				__m128 light_x = _mm_set1_ps(lights[i].x);
 				__m128 light_y = _mm_set1_ps(lights[i].y);
 				__m128 light_z = _mm_set1_ps(lights[i].z);
 				__m128 light_radius = _mm_set1_ps(lights[i].radius);
-				__m128 m256 = _mm_set1_ps(256.0f);
-
-				// L = light-pos
-				// dist = sqrt(dot(L, L))
-				// distance_attenuation = 1 - min(dist * (1/radius), 1)
-				__m128 Lyz2 = light_y; // L.y*L.y + L.z*L.z
-				__m128 Lx = _mm_sub_ps(light_x, viewpos_x);
-				__m128 dist2 = _mm_add_ps(Lyz2, _mm_mul_ps(Lx, Lx));
-				__m128 rcp_dist = _mm_rsqrt_ps(dist2);
-				__m128 dist = _mm_mul_ps(dist2, rcp_dist);
-				__m128 distance_attenuation = _mm_sub_ps(m256, _mm_min_ps(_mm_mul_ps(dist, light_radius), m256));
-
-				// The simple light type
-				__m128 simple_attenuation = distance_attenuation;
-
-				// The point light type
-				// diffuse = dot(N,L) * attenuation
-				__m128 point_attenuation = _mm_mul_ps(_mm_mul_ps(light_z, rcp_dist), distance_attenuation);
-
-				__m128 is_attenuated = _mm_cmpeq_ps(light_z, _mm_setzero_ps());
-				__m128i attenuation = _mm_cvtps_epi32(_mm_or_ps(_mm_and_ps(is_attenuated, simple_attenuation), _mm_andnot_ps(is_attenuated, point_attenuation)));
-				attenuation = _mm_packs_epi32(_mm_shuffle_epi32(attenuation, _MM_SHUFFLE(0, 0, 0, 0)), _mm_shuffle_epi32(attenuation, _MM_SHUFFLE(1, 1, 1, 1)));
 
-				__m128i light_color = _mm_cvtsi32_si128(lights[i].color);
-				light_color = _mm_unpacklo_epi8(light_color, _mm_setzero_si128());
-				light_color = _mm_shuffle_epi32(light_color, _MM_SHUFFLE(1, 0, 1, 0));
+				__m128i attenuation = CalcAttenuation(light_x, light_y, light_z, light_radius, viewpos_x);
+				attenuation = _mm_packs_epi32(_mm_shuffle_epi32(attenuation, _MM_SHUFFLE(0, 0, 0, 0)), _mm_shuffle_epi32(attenuation, _MM_SHUFFLE(1, 1, 1, 1)));
 
-				lit = _mm_add_epi16(lit, _mm_srli_epi16(_mm_mullo_epi16(light_color, attenuation), 8));
+				lit = _mm_add_epi16(lit, _mm_srli_epi16(_mm_mullo_epi16(LightColor(lights[i].color), attenuation), 8));
 			}
 
 			lit = _mm_min_epi16(lit, _mm_set1_epi16(256));
@@ -399,6 +415,38 @@ namespace swrenderer
 			return fgcolor;
 		}
 
+		FORCEINLINE static __m128i VECTORCALL CalcAttenuation(__m128 light_x, __m128 light_y, __m128 light_z, __m128 light_radius, __m128 viewpos_x)
+		{
+			__m128 m256 = _mm_set1_ps(256.0f);
+
+			// L = light-pos
+			// dist = sqrt(dot(L, L))
+			// distance_attenuation = 1 - min(dist * (1/radius), 1)
+			__m128 Lyz2 = light_y; // L.y*L.y + L.z*L.z
+			__m128 Lx = _mm_sub_ps(light_x, viewpos_x);
+			__m128 dist2 = _mm_add_ps(Lyz2, _mm_mul_ps(Lx, Lx));
+			__m128 rcp_dist = _mm_rsqrt_ps(dist2);
+			__m128 dist = _mm_mul_ps(dist2, rcp_dist);
+			__m128 distance_attenuation = _mm_sub_ps(m256, _mm_min_ps(_mm_mul_ps(dist, light_radius), m256));
+
+			// The simple light type
+			__m128 simple_attenuation = distance_attenuation;
+
+			// The point light type
+			// diffuse = dot(N,L) * attenuation
+			__m128 point_attenuation = _mm_mul_ps(_mm_mul_ps(light_z, rcp_dist), distance_attenuation);
+
+			__m128 is_attenuated = _mm_cmpeq_ps(light_z, _mm_setzero_ps());
+			return _mm_cvtps_epi32(_mm_or_ps(_mm_and_ps(is_attenuated, simple_attenuation), _mm_andnot_ps(is_attenuated, point_attenuation)));
+		}
+
+		FORCEINLINE static __m128i VECTORCALL LightColor(uint32_t color)
+		{
+			__m128i light_color = _mm_cvtsi32_si128(color);
+			light_color = _mm_unpacklo_epi8(light_color, _mm_setzero_si128());
+			return _mm_shuffle_epi32(light_color, _MM_SHUFFLE(1, 0, 1, 0));
+		}
+
 		FORCEINLINE static __m128i VECTORCALL Blend(__m128i fgcolor, __m128i bgcolor, uint32_t srcalpha, uint32_t destalpha, unsigned int ifgcolor0, unsigned int ifgcolor1)
 		{
 			using namespace DrawSpan32TModes;
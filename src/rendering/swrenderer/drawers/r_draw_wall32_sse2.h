@@ -23,6 +23,7 @@
 #pragma once
 
 #include "swrenderer/drawers/r_draw_pal.h"
+#include "swrenderer/drawers/r_draw_lights32.h"
 #include "swrenderer/drawers/r_draw_rgba.h"
 #include "swrenderer/viewport/r_walldrawer.h"
 
@@ -124,6 +125,11 @@ namespace swrenderer
 			__m128 viewpos_z = _mm_setr_ps(vpz, vpz + stepvpz, 0.0f, 0.0f);
 			__m128 step_viewpos_z = _mm_set1_ps(stepvpz * 2.0f);
 
+			DrawerLightTiles lighttiles(lights, num_lights, &DrawerLight::z, &DrawerLight::x);
+			const DrawerLight *tilelights = lights;
+			int tilenumlights = num_lights;
+			int nexttile = 0;
+
 			if (FilterModeT::Mode == (int)FilterModes::Linear)
 			{
 				frac -= one / 2;
@@ -135,6 +141,13 @@ namespace swrenderer
 			int ssecount = count / 2;
 			for (int index = 0; index < ssecount; index++)
 			{
+				if (index == nexttile && num_lights != 0)
+				{
+					nexttile = min(index + DrawerLightTiles::TileSize / 2, ssecount);
+					tilenumlights = lighttiles.Gather(vpz + index * 2 * stepvpz, vpz + (nexttile * 2 - 1) * stepvpz, stepvpz);
+					tilelights = lighttiles.Lights();
+				}
+
 				int offset = index * pitch * 2;
 				uint32_t desttmp[2];
 				desttmp[0] = dest[offset];
@@ -159,7 +172,7 @@ namespace swrenderer
 
 				__m128i fgcolor = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)ifgcolor), _mm_setzero_si128());
 
-				fgcolor = Shade<ShadeModeT>(fgcolor, mlight, ifgcolor[0], ifgcolor[1], desaturate, inv_desaturate, shade_fade, shade_light, lights, num_lights, viewpos_z);
+				fgcolor = Shade<ShadeModeT>(fgcolor, mlight, ifgcolor[0], ifgcolor[1], desaturate, inv_desaturate, shade_fade, shade_light, tilelights, tilenumlights, viewpos_z);
 				__m128i outcolor = Blend(fgcolor, bgcolor, ifgcolor[0], ifgcolor[1], srcalpha, destalpha);
 
 				_mm_storel_epi64((__m128i*)desttmp, outcolor);
@@ -173,6 +186,12 @@ namespace swrenderer
 				int index = ssecount * 2;
 				int offset = index * pitch;
 
+				if (num_lights != 0)
+				{
+					tilenumlights = lighttiles.Gather(vpz + index * stepvpz, vpz + index * stepvpz, stepvpz);
+					tilelights = lighttiles.Lights();
+				}
+
 				__m128i bgcolor;
 				if (BlendT::Mode != (int)WallBlendModes::Opaque)
 				{
@@ -188,7 +207,7 @@ namespace swrenderer
 				ifgcolor[1] = 0;
 				__m128i fgcolor = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)ifgcolor), _mm_setzero_si128());
 
-				fgcolor = Shade<ShadeModeT>(fgcolor, mlight, ifgcolor[0], ifgcolor[1], desaturate, inv_desaturate, shade_fade, shade_light, lights, num_lights, viewpos_z);
+				fgcolor = Shade<ShadeModeT>(fgcolor, mlight, ifgcolor[0], ifgcolor[1], desaturate, inv_desaturate, shade_fade, shade_light, tilelights, tilenumlights, viewpos_z);
 				__m128i outcolor = Blend(fgcolor, bgcolor, ifgcolor[0], ifgcolor[1], srcalpha, destalpha);
 
 				dest[offset] = _mm_cvtsi128_si32(outcolor);
@@ -270,40 +289,37 @@ namespace swrenderer
 
 			__m128i lit = _mm_setzero_si128();
 
-			for (int i = 0; i != num_lights; i++)
+			// Two lights at a time: lanes 0 and 1 hold the two pixels for the first light, lanes 2 and 3 for the second.
+			__m128 viewpos_z2 = _mm_movelh_ps(viewpos_z, viewpos_z);
+			int i = 0;
+			for (; i + 1 < num_lights; i += 2)
+			{
+				const DrawerLight &light0 = lights[i];
+				const DrawerLight &light1 = lights[i + 1];
+				__m128 light_x = _mm_setr_ps(light0.x, light0.x, light1.x, light1.x);
+				__m128 light_y = _mm_setr_ps(light0.y, light0.y, light1.y, light1.y);
+				__m128 light_z = _mm_setr_ps(light0.z, light0.z, light1.z, light1.z);
+				__m128 light_radius = _mm_setr_ps(light0.radius, light0.radius, light1.radius, light1.radius);
+
+				__m128i attenuation = CalcAttenuation(light_x, light_y, light_z, light_radius, viewpos_z2);
+				__m128i attenuation0 = _mm_packs_epi32(_mm_shuffle_epi32(attenuation, _MM_SHUFFLE(0, 0, 0, 0)), _mm_shuffle_epi32(attenuation, _MM_SHUFFLE(1, 1, 1, 1)));
+				__m128i attenuation1 = _mm_packs_epi32(_mm_shuffle_epi32(attenuation, _MM_SHUFFLE(2, 2, 2, 2)), _mm_shuffle_epi32(attenuation, _MM_SHUFFLE(3, 3, 3, 3)));
+
+				lit = _mm_add_epi16(lit, _mm_srli_epi16(_mm_mullo_epi16(LightColor(light0.color), attenuation0), 8));
+				lit = _mm_add_epi16(lit, _mm_srli_epi16(_mm_mullo_epi16(LightColor(light1.color), attenuation1), 8));
+			}
+
+			if (i != num_lights)
 			{
 				__m128 light_x = _mm_set1_ps(lights[i].x);
 				__m128 light_y = _mm_set1_ps(lights[i].y);
 				__m128 light_z = _mm_set1_ps(lights[i].z);
 				__m128 light_radius = _mm_set1_ps(lights[i].radius);
-				__m128 m256 = _mm_set1_ps(256.0f);
-
-				// L = light-pos
-				// dist = sqrt(dot(L, L))
-				// distance_attenuation = 1 - min(dist * (1/radius), 1)
-				__m128 Lxy2 = light_x; // L.x*L.x + L.y*L.y
-				__m128 Lz = _mm_sub_ps(light_z, viewpos_z);
-				__m128 dist2 = _mm_add_ps(Lxy2, _mm_mul_ps(Lz, Lz));
-				__m128 rcp_dist = _mm_rsqrt_ps(dist2);
-				__m128 dist = _mm_mul_ps(dist2, rcp_dist);
-				__m128 distance_attenuation = _mm_sub_ps(m256, _mm_min_ps(_mm_mul_ps(dist, light_radius), m256));
-
-				// The simple light type
-				__m128 simple_attenuation = distance_attenuation;
-
-				// The point light type
-				// diffuse = dot(N,L) * attenuation
-				__m128 point_attenuation = _mm_mul_ps(_mm_mul_ps(light_y, rcp_dist), distance_attenuation);
-
-				__m128 is_attenuated = _mm_cmpeq_ps(light_y, _mm_setzero_ps());
-				__m128i attenuation = _mm_cvtps_epi32(_mm_or_ps(_mm_and_ps(is_attenuated, simple_attenuation), _mm_andnot_ps(is_attenuated, point_attenuation)));
-				attenuation = _mm_packs_epi32(_mm_shuffle_epi32(attenuation, _MM_SHUFFLE(0, 0, 0, 0)), _mm_shuffle_epi32(attenuation, _MM_SHUFFLE(1, 1, 1, 1)));
 
-				__m128i light_color = _mm_cvtsi32_si128(lights[i].color);
-				light_color = _mm_unpacklo_epi8(light_color, _mm_setzero_si128());
-				light_color = _mm_shuffle_epi32(light_color, _MM_SHUFFLE(1, 0, 1, 0));
+				__m128i attenuation = CalcAttenuation(light_x, light_y, light_z, light_radius, viewpos_z);
+				attenuation = _mm_packs_epi32(_mm_shuffle_epi32(attenuation, _MM_SHUFFLE(0, 0, 0, 0)), _mm_shuffle_epi32(attenuation, _MM_SHUFFLE(1, 1, 1, 1)));
 
-				lit = _mm_add_epi16(lit, _mm_srli_epi16(_mm_mullo_epi16(light_color, attenuation), 8));
+				lit = _mm_add_epi16(lit, _mm_srli_epi16(_mm_mullo_epi16(LightColor(lights[i].color), attenuation), 8));
 			}
 
 			lit = _mm_min_epi16(lit, _mm_set1_epi16(256));
@@ -313,6 +329,38 @@ namespace swrenderer
 			return fgcolor;
 		}
 
+		FORCEINLINE static __m128i VECTORCALL CalcAttenuation(__m128 light_x, __m128 light_y, __m128 light_z, __m128 light_radius, __m128 viewpos_z)
+		{
+			__m128 m256 = _mm_set1_ps(256.0f);
+
+			// L = light-pos
+			// dist = sqrt(dot(L, L))
+			// distance_attenuation = 1 - min(dist * (1/radius), 1)
+			__m128 Lxy2 = light_x; // L.x*L.x + L.y*L.y
+			__m128 Lz = _mm_sub_ps(light_z, viewpos_z);
+			__m128 dist2 = _mm_add_ps(Lxy2, _mm_mul_ps(Lz, Lz));
+			__m128 rcp_dist = _mm_rsqrt_ps(dist2);
+			__m128 dist = _mm_mul_ps(dist2, rcp_dist);
+			__m128 distance_attenuation = _mm_sub_ps(m256, _mm_min_ps(_mm_mul_ps(dist, light_radius), m256));
+
+			// The simple light type
+			__m128 simple_attenuation = distance_attenuation;
+
+			// The point light type
+			// diffuse = dot(N,L) * attenuation
+			__m128 point_attenuation = _mm_mul_ps(_mm_mul_ps(light_y, rcp_dist), distance_attenuation);
+
+			__m128 is_attenuated = _mm_cmpeq_ps(light_y, _mm_setzero_ps());
+			return _mm_cvtps_epi32(_mm_or_ps(_mm_and_ps(is_attenuated, simple_attenuation), _mm_andnot_ps(is_attenuated, point_attenuation)));
+		}
+
+		FORCEINLINE static __m128i VECTORCALL LightColor(uint32_t color)
+		{
+			__m128i light_color = _mm_cvtsi32_si128(color);
+			light_color = _mm_unpacklo_epi8(light_color, _mm_setzero_si128());
+			return _mm_shuffle_epi32(light_color, _MM_SHUFFLE(1, 0, 1, 0));
+		}
+
 		FORCEINLINE static __m128i VECTORCALL Blend(__m128i fgcolor, __m128i bgcolor, unsigned int ifgcolor0, unsigned int ifgcolor1, uint32_t srcalpha, uint32_t destalpha)
 		{
 			using namespace DrawWall32TModes;
@@ -51,7 +51,12 @@
 #include "swrenderer/plane/r_visibleplane.h"
 #include "swrenderer/viewport/r_viewport.h"
 #include "r_memory.h"
+#include "r_thread.h"
+#include "workerpool.h"
 #include "swrenderer/r_renderthread.h"
+#include "swrenderer/plane/r_visibleplanelist.h"
+
+CVAR(Bool, r_plane_multithreaded, true, 0);
 
 namespace swrenderer
 {
@@ -146,10 +151,68 @@ namespace swrenderer
 
 		light_list = pl->lights;
 
-		RenderLines(pl);
+		if (r_plane_multithreaded && r_multithreaded != 0)
+		{
+			auto &spans = Thread->PlaneList->Spans;
+			spans.Clear();
+			collectspans = &spans;
+			RenderLines(pl);
+			collectspans = nullptr;
+			DrawSpans(spans);
+		}
+		else
+		{
+			RenderLines(pl);
+		}
+	}
+
+	//==========================================================================
+	//
+	// The spans of a plane never overlap and the drawers only read the
+	// plane's setup, so they can be drawn in any order by any thread. Each
+	// job gets its own drawer args and light list. Planes are still drawn
+	// one after another, which keeps translucent planes in order.
+	//
+	//==========================================================================
+
+	void RenderFlatPlane::DrawSpans(TArray<PlaneSpan> &spans)
+	{
+		enum { MinJobPixels = 8192 };
+
+		int pixels = 0;
+		for (auto &span : spans)
+			pixels += span.x2 - span.x1 + 1;
+
+		int numJobs = min(pixels / MinJobPixels, (WorkerPool.NumThreads() + 1) * 2);
+		if (numJobs < 2)
+		{
+			for (auto &span : spans)
+				DrawLine(drawerargs, span.y, span.x1, span.x2, nullptr);
+			return;
+		}
+
+		auto &lightbuffers = Thread->PlaneList->SpanLights;
+		if ((int)lightbuffers.Size() < numJobs)
+			lightbuffers.Resize(numJobs);
+
+		// Every job takes every numJobs-th span, so that they all get a similar mix of near and far rows.
+		WorkerPool.ParallelFor(numJobs, [&](int job)
+		{
+			SpanDrawerArgs args = drawerargs;
+			for (unsigned i = job; i < spans.Size(); i += numJobs)
+				DrawLine(args, spans[i].y, spans[i].x1, spans[i].x2, &lightbuffers[job]);
+		});
 	}
 
 	void RenderFlatPlane::RenderLine(int y, int x1, int x2)
+	{
+		if (collectspans)
+			collectspans->Push({ y, x1, x2 });
+		else
+			DrawLine(drawerargs, y, x1, x2, nullptr);
+	}
+
+	void RenderFlatPlane::DrawLine(SpanDrawerArgs &args, int y, int x1, int x2, TArray<DrawerLight> *lightbuffer)
 	{
 #ifdef RANGECHECK
 		if (x2 < x1 || x1<0 || x2 >= viewwidth || (unsigned)y >= (unsigned)viewheight)
@@ -167,11 +230,11 @@ namespace swrenderer
 
 		float zbufferdepth = (float)(1.0 / fabs(planeheight / Thread->Viewport->ScreenToViewY(y, 1.0)));
 
-		drawerargs.SetTextureUStep(distance * xstepscale / tex->GetWidth());
-		drawerargs.SetTextureUPos((distance * curxfrac + pviewx) / tex->GetWidth());
+		args.SetTextureUStep(distance * xstepscale / tex->GetWidth());
+		args.SetTextureUPos((distance * curxfrac + pviewx) / tex->GetWidth());
 
-		drawerargs.SetTextureVStep(distance * ystepscale / tex->GetHeight());
-		drawerargs.SetTextureVPos((distance * curyfrac + pviewy) / tex->GetHeight());
+		args.SetTextureVStep(distance * ystepscale / tex->GetHeight());
+		args.SetTextureVPos((distance * curyfrac + pviewy) / tex->GetHeight());
 		
 		if (viewport->RenderTarget->IsBgra())
 		{
@@ -180,13 +243,13 @@ namespace swrenderer
 			double ymagnitude = fabs(xstepscale * (distance2 - distance) * viewport->FocalLengthX);
 			double magnitude = max(ymagnitude, xmagnitude);
 			double min_lod = -1000.0;
-			drawerargs.SetTextureLOD(max(log2(magnitude) + r_lod_bias, min_lod));
+			args.SetTextureLOD(max(log2(magnitude) + r_lod_bias, min_lod));
 		}
 
 		if (plane_shade)
 		{
 			// Determine lighting based on the span's distance from the viewer.
-			drawerargs.SetLight((float)Thread->Light->FlatPlaneVis(y, planeheight, foggy, viewport), lightlevel, foggy, viewport);
+			args.SetLight((float)Thread->Light->FlatPlaneVis(y, planeheight, foggy, viewport), lightlevel, foggy, viewport);
 		}
 
 		if (r_dynlights)
@@ -198,18 +261,18 @@ namespace swrenderer
 
 			// Find row position in view space
 			float zspan = (float)(planeheight / (fabs(y + 0.5 - viewport->CenterY) / viewport->InvZtoScale));
-			drawerargs.dc_viewpos.X = (float)((tx + 0.5 - viewport->CenterX) / viewport->CenterX * zspan);
-			drawerargs.dc_viewpos.Y = zspan;
-			drawerargs.dc_viewpos.Z = (float)((viewport->CenterY - y - 0.5) / viewport->InvZtoScale * zspan);
-			drawerargs.dc_viewpos_step.X = (float)(zspan / viewport->CenterX);
+			args.dc_viewpos.X = (float)((tx + 0.5 - viewport->CenterX) / viewport->CenterX * zspan);
+			args.dc_viewpos.Y = zspan;
+			args.dc_viewpos.Z = (float)((viewport->CenterY - y - 0.5) / viewport->InvZtoScale * zspan);
+			args.dc_viewpos_step.X = (float)(zspan / viewport->CenterX);
 
 			if (mirror)
-				drawerargs.dc_viewpos_step.X = -drawerargs.dc_viewpos_step.X;
+				args.dc_viewpos_step.X = -args.dc_viewpos_step.X;
 
 			// Plane normal
-			drawerargs.dc_normal.X = 0.0f;
-			drawerargs.dc_normal.Y = 0.0f;
-			drawerargs.dc_normal.Z = (y >= viewport->CenterY) ? 1.0f : -1.0f;
+			args.dc_normal.X = 0.0f;
+			args.dc_normal.Y = 0.0f;
+			args.dc_normal.Z = (y >= viewport->CenterY) ? 1.0f : -1.0f;
 
 			// Calculate max lights that can touch the row so we can allocate memory for the list
 			int max_lights = 0;
@@ -221,8 +284,17 @@ namespace swrenderer
 				cur_node = cur_node->next;
 			}
 
-			drawerargs.dc_num_lights = 0;
-			drawerargs.dc_lights = Thread->FrameMemory->AllocMemory<DrawerLight>(max_lights);
+			args.dc_num_lights = 0;
+			if (lightbuffer)
+			{
+				if ((int)lightbuffer->Size() < max_lights)
+					lightbuffer->Resize(max_lights);
+				args.dc_lights = lightbuffer->Data();
+			}
+			else
+			{
+				args.dc_lights = Thread->FrameMemory->AllocMemory<DrawerLight>(max_lights);
+			}
 
 			// Setup lights for row
 			cur_node = light_list;
@@ -233,13 +305,13 @@ namespace swrenderer
 				double lightZ = cur_node->lightsource->Z() - Thread->Viewport->viewpoint.Pos.Z;
 
 				float lx = (float)(lightX * Thread->Viewport->viewpoint.Sin - lightY * Thread->Viewport->viewpoint.Cos);
-				float ly = (float)(lightX * Thread->Viewport->viewpoint.TanCos + lightY * Thread->Viewport->viewpoint.TanSin) - drawerargs.dc_viewpos.Y;
-				float lz = (float)lightZ - drawerargs.dc_viewpos.Z;
+				float ly = (float)(lightX * Thread->Viewport->viewpoint.TanCos + lightY * Thread->Viewport->viewpoint.TanSin) - args.dc_viewpos.Y;
+				float lz = (float)lightZ - args.dc_viewpos.Z;
 
 				// Precalculate the constant part of the dot here so the drawer doesn't have to.
 				bool is_point_light = cur_node->lightsource->IsAttenuated();
 				float lconstant = ly * ly + lz * lz;
-				float nlconstant = is_point_light ? lz * drawerargs.dc_normal.Z : 0.0f;
+				float nlconstant = is_point_light ? lz * args.dc_normal.Z : 0.0f;
 
 				// Include light only if it touches this row
 				float radius = cur_node->lightsource->GetRadius();
@@ -249,7 +321,7 @@ namespace swrenderer
 					uint32_t green = cur_node->lightsource->GetGreen();
 					uint32_t blue = cur_node->lightsource->GetBlue();
 
-					auto &light = drawerargs.dc_lights[drawerargs.dc_num_lights++];
+					auto &light = args.dc_lights[args.dc_num_lights++];
 					light.x = lx;
 					light.y = lconstant;
 					light.z = nlconstant;
@@ -262,14 +334,14 @@ namespace swrenderer
 		}
 		else
 		{
-			drawerargs.dc_num_lights = 0;
+			args.dc_num_lights = 0;
 		}
 
-		drawerargs.SetDestY(viewport, y);
-		drawerargs.SetDestX1(x1);
-		drawerargs.SetDestX2(x2);
+		args.SetDestY(viewport, y);
+		args.SetDestX1(x1);
+		args.SetDestX2(x2);
 
-		drawerargs.DrawSpan(Thread);
+		args.DrawSpan(Thread);
 	}
 
 	/////////////////////////////////////////////////////////////////////////
@@ -40,7 +40,10 @@ namespace swrenderer
 
 	private:
 		void RenderLine(int y, int x1, int x2) override;
+		void DrawLine(SpanDrawerArgs &args, int y, int x1, int x2, TArray<DrawerLight> *lightbuffer);
+		void DrawSpans(TArray<PlaneSpan> &spans);
 
+		TArray<PlaneSpan> *collectspans = nullptr;
 		int minx;
 		double planeheight;
 		bool plane_shade;
@@ -29,6 +29,11 @@ namespace swrenderer
 {
 	struct VisiblePlane;
 
+	struct PlaneSpan
+	{
+		int y, x1, x2;
+	};
+
 	class PlaneRenderer
 	{
 	public:
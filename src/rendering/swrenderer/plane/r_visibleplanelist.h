@@ -24,6 +24,8 @@
 
 #include <stddef.h>
 #include "r_defs.h"
+#include "swrenderer/plane/r_planerenderer.h"
+#include "swrenderer/viewport/r_shadeconstants.h"
 
 struct FSectorPortal;
 
@@ -52,6 +54,10 @@ namespace swrenderer
 
 		RenderThread *Thread = nullptr;
 
+		// Working buffers for drawing the spans of a flat plane on the worker pool
+		TArray<PlaneSpan> Spans;
+		TArray<TArray<DrawerLight>> SpanLights;
+
 	private:
 		VisiblePlaneList();
 		VisiblePlane *Add(unsigned hash);
@@ -22,8 +22,11 @@ struct FRenderer
 	// precache one texture
 	virtual void Precache(uint8_t *texhitlist, TMap<PClassActor*, bool> &actorhitlist) = 0;
 
-	// render 3D view
-	virtual void RenderView(player_t *player, DCanvas *target, void *videobuffer, int bufferpitch) = 0;
+	// render 3D view. A pipelined view is still being copied to the video buffer when this returns.
+	virtual void RenderView(player_t *player, DCanvas *target, void *videobuffer, int bufferpitch, bool pipelined) = 0;
+
+	// waits until the last pipelined view has arrived in its video buffer
+	virtual void WaitForView() = 0;
 
 	// renders view to a savegame picture
 	virtual void WriteSavePic(player_t *player, FileWriter *file, int width, int height) = 0;
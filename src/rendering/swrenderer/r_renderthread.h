@@ -60,6 +60,7 @@ namespace swrenderer
 		int X1 = 0;
 		int X2 = MAXWIDTH;
 		bool MainThread = false;
+		uint64_t SliceTime = 0;	// time in ns it took to render the slice in the last frame
 
 		std::unique_ptr<RenderMemory> FrameMemory;
 		std::unique_ptr<RenderOpaquePass> OpaquePass;
@@ -184,11 +184,11 @@ void FSoftwareRenderer::Precache(uint8_t *texhitlist, TMap<PClassActor*, bool> &
 	FImageSource::EndPrecaching();
 }
 
-void FSoftwareRenderer::RenderView(player_t *player, DCanvas *target, void *videobuffer, int bufferpitch)
+void FSoftwareRenderer::RenderView(player_t *player, DCanvas *target, void *videobuffer, int bufferpitch, bool pipelined)
 {
 	mScene.MainThread()->Viewport->viewpoint = r_viewpoint;
 	mScene.MainThread()->Viewport->viewwindow = r_viewwindow;
-	mScene.RenderView(player, target, videobuffer, bufferpitch);
+	mScene.RenderView(player, target, videobuffer, bufferpitch, pipelined);
 	r_viewpoint = mScene.MainThread()->Viewport->viewpoint;
 	r_viewwindow = mScene.MainThread()->Viewport->viewwindow;
 
@@ -198,6 +198,11 @@ void FSoftwareRenderer::RenderView(player_t *player, DCanvas *target, void *vide
 	});
 }
 
+void FSoftwareRenderer::WaitForView()
+{
+	mScene.WaitForView();
+}
+
 void DoWriteSavePic(FileWriter *file, ESSType ssformat, uint8_t *scr, int width, int height, sector_t *viewsector, bool upsidedown);
 
 void FSoftwareRenderer::WriteSavePic (player_t *player, FileWriter *file, int width, int height)
@@ -12,7 +12,8 @@ struct FSoftwareRenderer : public FRenderer
 	void Precache(uint8_t *texhitlist, TMap<PClassActor*, bool> &actorhitlist) override;
 
 	// render 3D view
-	void RenderView(player_t *player, DCanvas *target, void *videobuffer, int bufferpitch) override;
+	void RenderView(player_t *player, DCanvas *target, void *videobuffer, int bufferpitch, bool pipelined) override;
+	void WaitForView() override;
 
 	// renders view to a savegame picture
 	void WriteSavePic (player_t *player, FileWriter *file, int width, int height) override;
@@ -39,6 +39,10 @@
 #include "d_main.h"
 #include "v_draw.h"
 
+// Show the previous frame while the current one is still being copied
+CVAR(Bool, r_pipelineframes, false, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+EXTERN_CVAR(Int, r_multithreaded)
+
 class FSWPaletteTexture : public FImageSource
 {
 public:
@@ -80,22 +84,68 @@ SWSceneDrawer::SWSceneDrawer()
 
 SWSceneDrawer::~SWSceneDrawer()
 {
+	if (PendingFrame && SWRenderer) SWRenderer->WaitForView();
+}
+
+//==========================================================================
+//
+// With r_pipelineframes the view is copied to its buffer by the drawer
+// threads while the main thread goes on with the next frame, and the
+// previous view is shown instead. This adds a frame of latency.
+//
+//==========================================================================
+
+void SWSceneDrawer::FinishPendingFrame()
+{
+	if (PendingFrame)
+	{
+		auto fbtex = FBTexture[FBTextureIndex].get();
+		SWRenderer->WaitForView();
+		fbtex->GetTexture()->GetHardwareTexture(0, 0)->CreateTexture(nullptr, fbtex->GetTexelWidth(), fbtex->GetTexelHeight(), 0, false, "swbuffer");
+		PendingFrame = false;
+	}
+}
+
+//==========================================================================
+//
+// Called for frames that do not render the view. The pending view gets
+// unmapped, and since it is outdated by the time the view is rendered
+// again, the next frame does not show it.
+//
+//==========================================================================
+
+void SWSceneDrawer::SkipFrame()
+{
+	FinishPendingFrame();
+	LastFrameValid = false;
 }
 
 sector_t *SWSceneDrawer::RenderView(player_t *player)
 {
+	FinishPendingFrame();
+
 	if (!V_IsTrueColor() || !screen->IsPoly())
 	{
+		auto IsUsable = [&](int index)
+		{
+			auto &fbtex = FBTexture[index];
+			return fbtex != nullptr && fbtex->GetTexture()->GetHardwareTexture(0, 0) != nullptr &&
+				fbtex->GetTexelWidth() == screen->GetWidth() &&
+				fbtex->GetTexelHeight() == screen->GetHeight() &&
+				(V_IsTrueColor() ? 1:0) == static_cast<FWrapperTexture*>(fbtex->GetTexture())->GetColorFormat();
+		};
+
+		int lastIndex = FBTextureIndex;
+		bool pipelined = r_pipelineframes && r_multithreaded != 0 && LastFrameValid && IsUsable(lastIndex);
+
 		// Avoid using the pixel buffer from the last frame
 		FBTextureIndex = (FBTextureIndex + 1) % 2;
 		auto &fbtex = FBTexture[FBTextureIndex];
+		auto &canvas = Canvas[FBTextureIndex];
 
 		auto GetSystemTexture = [&]() { return fbtex->GetTexture()->GetHardwareTexture(0, 0); };
 
-		if (fbtex == nullptr || GetSystemTexture() == nullptr ||
-			fbtex->GetTexelWidth() != screen->GetWidth() || 
-			fbtex->GetTexelHeight() != screen->GetHeight() || 
-			(V_IsTrueColor() ? 1:0) != static_cast<FWrapperTexture*>(fbtex->GetTexture())->GetColorFormat())
+		if (!IsUsable(FBTextureIndex))
 		{
 			// This manually constructs its own material here.
 			fbtex.reset();
@@ -103,19 +153,32 @@ sector_t *SWSceneDrawer::RenderView(player_t *player)
 			GetSystemTexture()->AllocateBuffer(screen->GetWidth(), screen->GetHeight(), V_IsTrueColor() ? 4 : 1);
 			auto mat = FMaterial::ValidateTexture(fbtex.get(), false);
 			mat->AddTextureLayer(PaletteTexture, false);
-
-			Canvas.reset();
-			Canvas.reset(new DCanvas(screen->GetWidth(), screen->GetHeight(), V_IsTrueColor()));
+		}
+		if (canvas == nullptr || canvas->GetWidth() != screen->GetWidth() || canvas->GetHeight() != screen->GetHeight() || canvas->IsBgra() != V_IsTrueColor())
+		{
+			canvas.reset();
+			canvas.reset(new DCanvas(screen->GetWidth(), screen->GetHeight(), V_IsTrueColor()));
 		}
 
 		IHardwareTexture *systemTexture = GetSystemTexture();
 		auto buf = systemTexture->MapBuffer();
 		if (!buf) I_FatalError("Unable to map buffer for software rendering");
-		SWRenderer->RenderView(player, Canvas.get(), buf, systemTexture->GetBufferPitch());
-		systemTexture->CreateTexture(nullptr, screen->GetWidth(), screen->GetHeight(), 0, false, "swbuffer");
+		SWRenderer->RenderView(player, canvas.get(), buf, systemTexture->GetBufferPitch(), pipelined);
+		Colormap[FBTextureIndex] = swrenderer::CameraLight::Instance()->ShaderColormap();
+		LastFrameValid = true;
 
-		auto map = swrenderer::CameraLight::Instance()->ShaderColormap();
-		DrawTexture(twod, fbtex.get(), 0, 0, DTA_SpecialColormap, map, TAG_DONE);
+		int shownIndex = FBTextureIndex;
+		if (pipelined)
+		{
+			PendingFrame = true;
+			shownIndex = lastIndex;
+		}
+		else
+		{
+			systemTexture->CreateTexture(nullptr, screen->GetWidth(), screen->GetHeight(), 0, false, "swbuffer");
+		}
+
+		DrawTexture(twod, FBTexture[shownIndex].get(), 0, 0, DTA_SpecialColormap, Colormap[shownIndex], TAG_DONE);
 		screen->Draw2D();
 		twod->Clear();
 		screen->PostProcessScene(true, CM_DEFAULT, 1.f, [&]() {
@@ -127,9 +190,10 @@ sector_t *SWSceneDrawer::RenderView(player_t *player)
 	else
 	{
 		// With softpoly truecolor we render directly to the target framebuffer
+		LastFrameValid = false;
 
 		DCanvas *canvas = screen->GetCanvas();
-		SWRenderer->RenderView(player, canvas, canvas->GetPixels(), canvas->GetPitch());
+		SWRenderer->RenderView(player, canvas, canvas->GetPixels(), canvas->GetPitch(), false);
 
 		int cm = CM_DEFAULT;
 		auto map = swrenderer::CameraLight::Instance()->ShaderColormap();
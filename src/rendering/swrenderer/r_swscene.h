@@ -10,19 +10,26 @@
 
 class FWrapperTexture;
 class DCanvas;
+struct FSpecialColormap;
 
 class SWSceneDrawer
 {
 	FTexture *PaletteTexture;
 	std::unique_ptr<FGameTexture> FBTexture[2];
+	std::unique_ptr<DCanvas> Canvas[2];
+	FSpecialColormap *Colormap[2] = {};
 	int FBTextureIndex = 0;
 	bool FBIsTruecolor = false;
-	std::unique_ptr<DCanvas> Canvas;
+	bool LastFrameValid = false;
+	bool PendingFrame = false;	// FBTexture[FBTextureIndex] is still being copied to
+
+	void FinishPendingFrame();
 
 public:
 	SWSceneDrawer();
 	~SWSceneDrawer();
 
 	sector_t *RenderView(player_t *player);
+	void SkipFrame();
 };
 
@@ -57,25 +57,40 @@
 #include "r_memory.h"
 #include "swrenderer/r_renderthread.h"
 #include "swrenderer/things/r_playersprite.h"
+#include "i_time.h"
 #include <chrono>
 
 EXTERN_CVAR(Int, r_clearbuffer)
 EXTERN_CVAR(Int, r_debug_draw)
 
 CVAR(Int, r_scene_multithreaded, 1, 0);
+CVAR(Bool, r_scene_balance, true, 0);
 CVAR(Bool, r_models, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG);
 
 namespace swrenderer
 {
 	cycle_t WallCycles, PlaneCycles, MaskedCycles;
+
+	// Width and render time of each slice in the last frame, for stat swfps.
+	static TArray<std::pair<int, double>> SliceStats;
+
+	// Frame memory of each thread, for stat swmemory.
+	struct FrameMemoryStats
+	{
+		size_t Used, Peak, Reserved;
+		int Blocks;
+	};
+	static TArray<FrameMemoryStats> MemoryStats;
 	
 	RenderScene::RenderScene()
 	{
 		Threads.push_back(std::unique_ptr<RenderThread>(new RenderThread(this)));
+		CopyMemory.reset(new RenderMemory());
 	}
 
 	RenderScene::~RenderScene()
 	{
+		WaitForView();
 		StopThreads();
 	}
 
@@ -84,8 +99,10 @@ namespace swrenderer
 		clearcolor = color;
 	}
 
-	void RenderScene::RenderView(player_t *player, DCanvas *target, void *videobuffer, int bufferpitch)
+	void RenderScene::RenderView(player_t *player, DCanvas *target, void *videobuffer, int bufferpitch, bool pipelined)
 	{
+		WaitForView();
+
 		auto viewport = MainThread()->Viewport.get();
 		viewport->RenderTarget = target;
 		viewport->RenderingToCanvas = false;
@@ -119,10 +136,24 @@ namespace swrenderer
 
 		if (videobuffer != target->GetPixels())
 		{
-			auto copyqueue = std::make_shared<DrawerCommandQueue>(MainThread()->FrameMemory.get());
+			// The frame memory of the main thread gets reused by camera textures, so the command can't live there.
+			CopyMemory->Clear();
+			auto copyqueue = std::make_shared<DrawerCommandQueue>(CopyMemory.get());
 			copyqueue->Push<MemcpyCommand>(videobuffer, bufferpitch, target->GetPixels(), target->GetWidth(), target->GetHeight(), target->GetPitch(), target->IsBgra() ? 4 : 1);
 			DrawerThreads::Execute(copyqueue);
+			if (pipelined)
+				CopyPending = true;
+			else
+				DrawerThreads::WaitForWorkers();
+		}
+	}
+
+	void RenderScene::WaitForView()
+	{
+		if (CopyPending)
+		{
 			DrawerThreads::WaitForWorkers();
+			CopyPending = false;
 		}
 	}
 
@@ -186,16 +217,25 @@ namespace swrenderer
 			StartThreads(numThreads);
 		}
 
+		// Camera textures are rendered in between and must not disturb the layout of the main view.
+		bool balance = r_scene_balance && numThreads > 1 && !MainThread()->Viewport->RenderingToCanvas;
+		if (balance) UpdateSliceEdges(numThreads);
+
 		// Setup threads:
 		std::unique_lock<std::mutex> start_lock(start_mutex);
 		for (int i = 0; i < numThreads; i++)
 		{
 			*Threads[i]->Viewport = *MainThread()->Viewport;
 			*Threads[i]->Light = *MainThread()->Light;
-			Threads[i]->X1 = viewwidth * i / numThreads;
-			Threads[i]->X2 = viewwidth * (i + 1) / numThreads;
+			Threads[i]->X1 = balance ? SliceEdges[i] : viewwidth * i / numThreads;
+			Threads[i]->X2 = balance ? SliceEdges[i + 1] : viewwidth * (i + 1) / numThreads;
 		}
+		// Camera textures are rendered in between main view passes, so only the main view trims the
+		// texture cache. It keeps everything used since its own last pass, camera passes included.
+		bool mainview = !MainThread()->Viewport->RenderingToCanvas;
+		if (mainview) FSoftwareTexture::TrimCache(main_run_id);
 		run_id++;
+		if (mainview) main_run_id = run_id;
 		FSoftwareTexture::CurrentUpdate = run_id;
 		start_lock.unlock();
 
@@ -221,13 +261,85 @@ namespace swrenderer
 			finished_threads = 0;
 		}
 
+		if (!MainThread()->Viewport->RenderingToCanvas)
+		{
+			SliceStats.Resize(numThreads);
+			MemoryStats.Resize(numThreads);
+			for (int i = 0; i < numThreads; i++)
+			{
+				SliceStats[i] = { Threads[i]->X2 - Threads[i]->X1, Threads[i]->SliceTime / 1e6 };
+				auto memory = Threads[i]->FrameMemory.get();
+				MemoryStats[i] = { memory->UsedBytes(), memory->PeakBytes(), memory->ReservedBytes(), memory->BlockCount() };
+			}
+		}
+
 		// Change main thread back to covering the whole screen for player sprites
 		MainThread()->X1 = 0;
 		MainThread()->X2 = viewwidth;
 	}
 
+	//==========================================================================
+	//
+	// Moves the slice edges so that each thread gets the same share of the
+	// work, assuming that the cost of a column is the same as in the last
+	// frame. The render time of each slice is spread evenly over its columns.
+	// Only half of the correction gets applied per frame so that the edges
+	// do not oscillate when the view moves.
+	//
+	//==========================================================================
+
+	void RenderScene::UpdateSliceEdges(int numThreads)
+	{
+		double total = 0;
+		if (SliceEdges.size() == (size_t)numThreads + 1 && SliceViewWidth == viewwidth)
+		{
+			for (int i = 0; i < numThreads; i++) total += Threads[i]->SliceTime;
+		}
+
+		if (total <= 0)
+		{
+			SliceEdges.resize(numThreads + 1);
+			for (int i = 0; i <= numThreads; i++) SliceEdges[i] = viewwidth * i / numThreads;
+			SliceViewWidth = viewwidth;
+			return;
+		}
+
+		auto &edges = NextSliceEdges;
+		edges.resize(numThreads + 1);
+		edges[0] = 0;
+		edges[numThreads] = viewwidth;
+
+		int slice = 0;
+		double before = 0;	// cost of all slices left of 'slice'
+		for (int i = 1; i < numThreads; i++)
+		{
+			double target = total * i / numThreads;
+			while (slice < numThreads - 1 && before + Threads[slice]->SliceTime < target)
+			{
+				before += Threads[slice]->SliceTime;
+				slice++;
+			}
+			double cost = (double)Threads[slice]->SliceTime;
+			double frac = cost > 0 ? std::clamp((target - before) / cost, 0., 1.) : 0.5;
+			double x = SliceEdges[slice] + frac * (SliceEdges[slice + 1] - SliceEdges[slice]);
+			edges[i] = int(SliceEdges[i] + (x - SliceEdges[i]) * 0.5 + 0.5);
+		}
+
+		// Keep every slice at least a few columns wide so that a slice which got very expensive can recover.
+		int minwidth = max(viewwidth / (numThreads * 8), 1);
+		if (minwidth * numThreads <= viewwidth)
+		{
+			for (int i = 1; i < numThreads; i++)
+			{
+				edges[i] = clamp(edges[i], edges[i - 1] + minwidth, viewwidth - (numThreads - i) * minwidth);
+			}
+		}
+		SliceEdges.swap(edges);
+	}
+
 	void RenderScene::RenderThreadSlice(RenderThread *thread)
 	{
+		uint64_t start = I_nsTime();
 		thread->FrameMemory->Clear();
 		thread->Clip3D->Cleanup();
 		thread->Clip3D->ResetClip(); // reset clips (floor/ceiling)
@@ -259,6 +371,9 @@ namespace swrenderer
 
 			thread->TranslucentPass->Render();
 		}
+		// Camera textures must not feed their timings into the slice layout of the main view
+		if (!thread->Viewport->RenderingToCanvas)
+			thread->SliceTime = I_nsTime() - start;
 
 #if 0 // shows the render slice edges
 		if (thread->Viewport->RenderTarget->IsBgra())
@@ -393,6 +508,30 @@ namespace swrenderer
 		FString out;
 		out.Format("frame=%04.1f ms  walls=%04.1f ms  planes=%04.1f ms  masked=%04.1f ms",
 			FrameCycles.TimeMS(), WallCycles.TimeMS(), PlaneCycles.TimeMS(), MaskedCycles.TimeMS());
+		if (SliceStats.Size() > 1)
+		{
+			double total = 0, longest = 0;
+			out += "\nslices:";
+			for (auto &slice : SliceStats)
+			{
+				out.AppendFormat(" %d:%.1f", slice.first, slice.second);
+				total += slice.second;
+				longest = max(longest, slice.second);
+			}
+			if (longest > 0) out.AppendFormat("  (utilization %d%%)", int(total * 100 / (longest * SliceStats.Size())));
+		}
+		return out;
+	}
+
+	ADD_STAT(swmemory)
+	{
+		FString out;
+		for (unsigned i = 0; i < MemoryStats.Size(); i++)
+		{
+			auto &stats = MemoryStats[i];
+			if (i > 0) out += "\n";
+			out.AppendFormat("thread %d: %zu KB used, %zu KB peak, %d blocks (%zu KB)", i, stats.Used >> 10, stats.Peak >> 10, stats.Blocks, stats.Reserved >> 10);
+		}
 		return out;
 	}
 
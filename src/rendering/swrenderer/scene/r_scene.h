@@ -30,6 +30,8 @@
 #include "r_defs.h"
 #include "d_player.h"
 
+class RenderMemory;
+
 extern cycle_t FrameCycles;
 
 namespace swrenderer
@@ -48,7 +50,8 @@ namespace swrenderer
 
 		void SetClearColor(int color);
 		
-		void RenderView(player_t *player, DCanvas *target, void *videobuffer, int bufferpitch);
+		void RenderView(player_t *player, DCanvas *target, void *videobuffer, int bufferpitch, bool pipelined);
+		void WaitForView();
 		void RenderViewToCanvas(AActor *actor, DCanvas *canvas, int x, int y, int width, int height, bool dontmaplines = false);
 	
 		bool DontMapLines() const { return dontmaplines; }
@@ -58,6 +61,7 @@ namespace swrenderer
 	private:
 		void RenderActorView(AActor *actor,bool renderplayersprite, bool dontmaplines);
 		void RenderThreadSlices();
+		void UpdateSliceEdges(int numThreads);
 		void RenderThreadSlice(RenderThread *thread);
 		void RenderPSprites();
 
@@ -72,8 +76,17 @@ namespace swrenderer
 		std::condition_variable start_condition;
 		bool shutdown_flag = false;
 		int run_id = 0;
+		int main_run_id = 0;
 		std::mutex end_mutex;
 		std::condition_variable end_condition;
 		size_t finished_threads = 0;
+
+		// Slice layout of the last frame, used to balance the next one.
+		std::vector<int> SliceEdges, NextSliceEdges;
+		int SliceViewWidth = 0;
+
+		// Holds the copy command of a pipelined view until it has been waited for.
+		std::unique_ptr<RenderMemory> CopyMemory;
+		bool CopyPending = false;
 	};
 }
@@ -39,8 +39,15 @@
 #include "m_alloc.h"
 #include "imagehelpers.h"
 #include "texturemanager.h"
+#include "c_cvars.h"
+#include "stats.h"
 #include <mutex>
 
+CUSTOM_CVAR(Int, r_swtexturebudget, 512, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+{
+	if (self < 0) self = 0;
+}
+
 inline EUpscaleFlags scaleFlagFromUseType(ETextureType useType)
 {
 	switch (useType)
@@ -199,6 +206,7 @@ void FSoftwareTexture::UpdatePixels(int index)
 	std::unique_lock<std::mutex> lock(swrenderer::loadmutex);
 	if (Unlockeddata[index].LastUpdate != CurrentUpdate)
 	{
+		bool hit = index == 2 ? PixelsBgra.Size() > 0 : Pixels.Size() > 0;
 		if (index != 2)
 		{
 			const uint8_t* Pixeldata = GetPixelsLocked(index);
@@ -215,9 +223,90 @@ void FSoftwareTexture::UpdatePixels(int index)
 			Unlockeddata[index].Pixels = Pixeldata;
 			Unlockeddata[index].LastUpdate = CurrentUpdate;
 		}
+		if (Cacheable) CacheTouch(hit);
 	}
 }
 
+//==========================================================================
+//
+// Texture cache. The list is ordered from the most to the least recently
+// used texture and is only modified with the load mutex held, or while
+// nothing is being rendered.
+//
+//==========================================================================
+
+FSoftwareTexture *FSoftwareTexture::CacheHead;
+FSoftwareTexture *FSoftwareTexture::CacheTail;
+size_t FSoftwareTexture::CacheTotal;
+unsigned FSoftwareTexture::CacheCount;
+unsigned FSoftwareTexture::CacheHits;
+unsigned FSoftwareTexture::CacheMisses;
+unsigned FSoftwareTexture::CacheEvictions;
+
+void FSoftwareTexture::CacheTouch(bool hit)
+{
+	if (hit) CacheHits++;
+	else CacheMisses++;
+
+	CacheUnlink();
+	CacheSize = Pixels.Size() + PixelsBgra.Size() * sizeof(uint32_t) + SpanSize;
+	CacheTotal += CacheSize;
+	CacheCount++;
+	CacheLastUse = CurrentUpdate;
+
+	CachePrev = nullptr;
+	CacheNext = CacheHead;
+	if (CacheHead) CacheHead->CachePrev = this;
+	else CacheTail = this;
+	CacheHead = this;
+}
+
+void FSoftwareTexture::CacheUnlink()
+{
+	if (CachePrev == nullptr && CacheHead != this)
+		return;
+
+	if (CachePrev) CachePrev->CacheNext = CacheNext;
+	else CacheHead = CacheNext;
+	if (CacheNext) CacheNext->CachePrev = CachePrev;
+	else CacheTail = CachePrev;
+	CachePrev = CacheNext = nullptr;
+
+	CacheTotal -= CacheSize;
+	CacheCount--;
+	CacheSize = 0;
+}
+
+void FSoftwareTexture::TrimCache(int keepfrom)
+{
+	std::unique_lock<std::mutex> lock(swrenderer::loadmutex);
+	size_t budget = size_t(r_swtexturebudget) << 20;
+	if (budget == 0) return;
+
+	// If the last frame alone needed more than the budget the cache is allowed to exceed it,
+	// because evicting those textures would only make the next frame load them again.
+	while (CacheTail != nullptr && CacheTotal > budget && CacheTail->CacheLastUse < keepfrom)
+	{
+		FSoftwareTexture *tex = CacheTail;
+		tex->Unload();
+		tex->FreeAllSpans();
+		CacheEvictions++;
+	}
+}
+
+FString FSoftwareTexture::CacheStats()
+{
+	std::unique_lock<std::mutex> lock(swrenderer::loadmutex);
+	FString out;
+	out.Format("%u textures, %.1f of %d MB, %u hits, %u misses, %u evicted", CacheCount, CacheTotal / 1048576., *r_swtexturebudget, CacheHits, CacheMisses, CacheEvictions);
+	return out;
+}
+
+ADD_STAT(swtextures)
+{
+	return FSoftwareTexture::CacheStats();
+}
+
 //==========================================================================
 //
 // 
@@ -242,6 +331,7 @@ FSoftwareTextureSpan **FSoftwareTexture::CreateSpans (const T *pixels)
 	if (!mTexture->isMasked())
 	{ // Texture does not have holes, so it can use a simpler span structure
 		spans = (FSoftwareTextureSpan **)M_Malloc (sizeof(FSoftwareTextureSpan*)*GetPhysicalWidth() + sizeof(FSoftwareTextureSpan)*2);
+		SpanSize += sizeof(FSoftwareTextureSpan*)*GetPhysicalWidth() + sizeof(FSoftwareTextureSpan)*2;
 		span = (FSoftwareTextureSpan *)&spans[GetPhysicalWidth()];
 		for (int x = 0; x < GetPhysicalWidth(); ++x)
 		{
@@ -287,6 +377,7 @@ FSoftwareTextureSpan **FSoftwareTexture::CreateSpans (const T *pixels)
 
 		// Allocate space for the spans
 		spans = (FSoftwareTextureSpan **)M_Malloc (sizeof(FSoftwareTextureSpan*)*numcols + sizeof(FSoftwareTextureSpan)*numspans);
+		SpanSize += sizeof(FSoftwareTextureSpan*)*numcols + sizeof(FSoftwareTextureSpan)*numspans;
 
 		// Fill in the spans
 		for (x = 0, span = (FSoftwareTextureSpan *)&spans[numcols], data_p = pixels; x < numcols; ++x)
@@ -525,6 +616,7 @@ void FSoftwareTexture::FreeAllSpans()
 			Spandata[i] = nullptr;
 		}
 	}
+	SpanSize = 0;
 }
 
 // Note: this function needs to be thread safe
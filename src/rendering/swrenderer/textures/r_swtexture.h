@@ -33,6 +33,21 @@ protected:
 	int mPhysicalScale;
 	int mBufferFlags;
 
+	// Converted pixel data is kept in a size limited LRU list. Textures which generate their pixels
+	// themselves (warped and canvas textures) are not part of it.
+	FSoftwareTexture *CachePrev = nullptr, *CacheNext = nullptr;
+	size_t CacheSize = 0;
+	size_t SpanSize = 0;
+	int CacheLastUse = -1;
+	bool Cacheable = true;
+
+	static FSoftwareTexture *CacheHead, *CacheTail;
+	static size_t CacheTotal;
+	static unsigned CacheCount, CacheHits, CacheMisses, CacheEvictions;
+
+	void CacheTouch(bool hit);
+	void CacheUnlink();
+
 	void FreeAllSpans();
 	template<class T> FSoftwareTextureSpan **CreateSpans(const T *pixels);
 	void FreeSpans(FSoftwareTextureSpan **spans);
@@ -43,6 +58,7 @@ public:
 	
 	virtual ~FSoftwareTexture()
 	{
+		CacheUnlink();
 		FreeAllSpans();
 	}
 
@@ -97,6 +113,7 @@ public:
 	
 	virtual void Unload()
 	{
+		CacheUnlink();
 		Pixels.Reset();
 		PixelsBgra.Reset();
 		for (auto& d : Unlockeddata) d = {};
@@ -201,6 +218,11 @@ public:
 	static int CurrentUpdate;
 	void UpdatePixels(int style);
 
+	// Unloads the least recently used textures until the cache fits into r_swtexturebudget again.
+	// Must be called in between render passes. Textures used since the pass numbered keepfrom are kept.
+	static void TrimCache(int keepfrom);
+	static FString CacheStats();
+
 	virtual const uint32_t* GetPixelsBgraLocked();
 	virtual const uint8_t* GetPixelsLocked(int style);
 };
@@ -52,6 +52,7 @@ FSWCanvasTexture::FSWCanvasTexture(FGameTexture* source) : FSoftwareTexture(sour
 	// The SW renderer needs to link the canvas textures, but let's do that outside the texture manager.
 	auto camtex = static_cast<FCanvasTexture*>(source->GetTexture());
 	canvasMap.Insert(camtex, this);
+	Cacheable = false;
 }
 
 
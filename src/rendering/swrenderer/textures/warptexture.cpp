@@ -50,6 +50,7 @@ FWarpTexture::FWarpTexture (FGameTexture *source, int warptype)
 	if (warptype == 2) SetupMultipliers(256, 128); 
 	SetupMultipliers(128, 128); // [mxd]
 	bWarped = warptype;
+	Cacheable = false;
 }
 
 bool FWarpTexture::CheckModified (int style)
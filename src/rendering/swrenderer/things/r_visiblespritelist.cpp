@@ -69,10 +69,17 @@ namespace swrenderer
 		if (count == 0)
 			return;
 
+		SortItems.Resize(count);
+		SortTemp.Resize(count);
+
+		// Farthest sprites come first, so the distance key gets inverted.
 		if (!(thread->Viewport->Level()->i_compatflags & COMPATF_SPRITESORT))
 		{
 			for (unsigned int i = 0; i < count; i++)
-				SortedSprites[i] = Sprites[first + i];
+			{
+				VisibleSprite *sprite = Sprites[first + i];
+				SortItems[i] = { ~RadixFloatKey(sprite->SortDist()), sprite };
+			}
 		}
 		else
 		{
@@ -80,15 +87,16 @@ namespace swrenderer
 			// be sorted in inverse order. This is most easily achieved by
 			// filling the sort array backwards before the sort.
 			for (unsigned int i = 0; i < count; i++)
-				SortedSprites[i] = Sprites[first + count - i - 1];
-		}
-
-		{
-			std::stable_sort(&SortedSprites[0], &SortedSprites[count], [](VisibleSprite *a, VisibleSprite *b) -> bool
 			{
-				return a->SortDist() > b->SortDist();
-			});
+				VisibleSprite *sprite = Sprites[first + count - i - 1];
+				SortItems[i] = { ~RadixFloatKey(sprite->SortDist()), sprite };
+			}
 		}
+
+		RadixSort(&SortItems[0], &SortTemp[0], count);
+
+		for (unsigned int i = 0; i < count; i++)
+			SortedSprites[i] = SortItems[i].Item;
 	}
 
 	uint32_t VisibleSpriteList::FindSubsectorDepth(RenderThread *thread, const DVector2 &worldPos)
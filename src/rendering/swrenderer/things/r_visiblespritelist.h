@@ -1,5 +1,7 @@
 #pragma once
 
+#include "radixsort.h"
+
 namespace swrenderer
 {
 	struct DrawSegment;
@@ -22,5 +24,6 @@ namespace swrenderer
 
 		TArray<VisibleSprite *> Sprites;
 		TArray<unsigned int> StartIndices;
+		TArray<FRadixSortItem<uint32_t, VisibleSprite *>> SortItems, SortTemp;
 	};
 }
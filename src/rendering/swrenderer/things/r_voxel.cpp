@@ -461,13 +461,31 @@ namespace swrenderer
 
 			for (x = xs; x != xe; x += xi)
 			{
+				// Only walk the part of this row that has any slabs in it.
+				int cy1 = mip->ColumnsY1[x], cy2 = mip->ColumnsY2[x];
+				if (cy1 >= cy2) continue;
+				int ystart = ys, yend = ye;
+				if (yi == 1)
+				{
+					ystart = max(ys, cy1);
+					yend = min(ye, cy2);
+					if (ystart >= yend) continue;
+				}
+				else if (yi == -1)
+				{
+					ystart = min(ys, cy2 - 1);
+					yend = max(ye, cy1 - 1);
+					if (ystart <= yend) continue;
+				}
+				int skipped = abs(ystart - ys);
+
 				auto SlabData = mip->GetSlabData(true);
 				uint8_t *slabxoffs = &SlabData[mip->OffsetX[x]];
 				short *xyoffs = &mip->OffsetXY[x * (mip->SizeY + 1)];
 
-				nx = MulScale(ggxstart + ggxinc[x], viewport->viewingrangerecip, 16) + x1;
-				ny = ggystart + ggyinc[x];
-				for (y = ys; y != ye; y += yi, nx += dagyinc, ny -= dagxinc)
+				nx = MulScale(ggxstart + ggxinc[x], viewport->viewingrangerecip, 16) + x1 + skipped * dagyinc;
+				ny = ggystart + ggyinc[x] - skipped * dagxinc;
+				for (y = ystart; y != yend; y += yi, nx += dagyinc, ny -= dagxinc)
 				{
 					if ((ny <= nytooclose) || (ny >= nytoofar)) continue;
 					voxptr = (kvxslab_t *)(slabxoffs + xyoffs[y]);
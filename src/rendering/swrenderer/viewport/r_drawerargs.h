@@ -10,6 +10,7 @@
 #include "r_data/colormaps.h"
 #include "r_data/r_translate.h"
 #include "swrenderer/scene/r_light.h"
+#include "r_shadeconstants.h"
 
 struct FSWColormap;
 struct FLightNode;
@@ -19,14 +20,6 @@ namespace swrenderer
 	class ColormapLight;
 	class SWPixelFormatDrawers;
 	class DrawerArgs;
-	struct ShadeConstants;
-
-	struct DrawerLight
-	{
-		uint32_t color;
-		float x, y, z;
-		float radius;
-	};
 
 	class DrawerArgs
 	{
@@ -55,18 +48,4 @@ namespace swrenderer
 		int mShade = 0;
 		uint8_t *mTranslation = nullptr;
 	};
-
-	struct ShadeConstants
-	{
-		uint16_t light_alpha;
-		uint16_t light_red;
-		uint16_t light_green;
-		uint16_t light_blue;
-		uint16_t fade_alpha;
-		uint16_t fade_red;
-		uint16_t fade_green;
-		uint16_t fade_blue;
-		uint16_t desaturate;
-		bool simple_shade;
-	};
 }
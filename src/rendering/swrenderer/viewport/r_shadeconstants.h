@@ -0,0 +1,28 @@
+
+#pragma once
+
+#include <stdint.h>
+
+namespace swrenderer
+{
+	struct DrawerLight
+	{
+		uint32_t color;
+		float x, y, z;
+		float radius;
+	};
+
+	struct ShadeConstants
+	{
+		uint16_t light_alpha;
+		uint16_t light_red;
+		uint16_t light_green;
+		uint16_t light_blue;
+		uint16_t fade_alpha;
+		uint16_t fade_red;
+		uint16_t fade_green;
+		uint16_t fade_blue;
+		uint16_t desaturate;
+		bool simple_shade;
+	};
+}
@@ -574,6 +574,44 @@ float spotLightAttenuation(vec4 lightpos, vec3 spotdir, float lightCosInnerAngle
 	return smoothstep(lightCosOuterAngle, lightCosInnerAngle, cosDir);
 }
 
+//===========================================================================
+//
+// Dynamic light lists
+//
+// A surface either has its own light list or, if its light index is the
+// light grid's, uses the list of the cluster the fragment is in.
+// The range counts lights; getLightOffset returns where the light's data
+// starts in the light buffer.
+//
+//===========================================================================
+
+ivec4 getLightRange()
+{
+	if (uLightIndex < 0)
+		return ivec4(0);
+
+	if (uLightIndex == uLightGridIndex)
+	{
+		vec4 clippos = ProjectionMatrix * ViewMatrix * vec4(pixelpos.xyz, 1.0);
+		ivec2 tile = ivec2((clippos.xy / clippos.w * 0.5 + 0.5) * vec2(uLightGridWidth, uLightGridHeight));
+		tile = clamp(tile, ivec2(0), ivec2(uLightGridWidth - 1, uLightGridHeight - 1));
+		int slice = clamp(int(log(max(pixelpos.w, uLightGridNear) / uLightGridNear) * uLightGridScale), 0, uLightGridSlices - 1);
+
+		vec4 cluster = lights[uLightGridIndex + (slice * uLightGridHeight + tile.y) * uLightGridWidth + tile.x];
+		return ivec4(cluster.x) + ivec4(0, cluster.yzw);
+	}
+
+	return ivec4(lights[uLightIndex]) / 4;
+}
+
+int getLightOffset(int entry)
+{
+	if (uLightIndex == uLightGridIndex)
+		return uLightGridIndex + int(lights[uLightGridIndex + (entry >> 2)][entry & 3]);
+
+	return uLightIndex + 1 + entry * 4;
+}
+
 //===========================================================================
 //
 // Adjust normal vector according to the normal map
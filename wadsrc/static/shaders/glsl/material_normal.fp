@@ -39,21 +39,23 @@ vec3 ProcessMaterialLight(Material material, vec3 color)
 {
 	vec4 dynlight = uDynLightColor;
 	vec3 normal = material.Normal;
+	ivec4 lightRange = getLightRange();
 
 	if (uLightIndex >= 0)
 	{
-		ivec4 lightRange = ivec4(lights[uLightIndex]) + ivec4(uLightIndex + 1);
 		if (lightRange.z > lightRange.x)
 		{
 			// modulated lights
-			for(int i=lightRange.x; i<lightRange.y; i+=4)
+			for(int n=lightRange.x; n<lightRange.y; n++)
 			{
+				int i = getLightOffset(n);
 				dynlight.rgb += lightContribution(i, normal);
 			}
 
 			// subtractive lights
-			for(int i=lightRange.y; i<lightRange.z; i+=4)
+			for(int n=lightRange.y; n<lightRange.z; n++)
 			{
+				int i = getLightOffset(n);
 				dynlight.rgb -= lightContribution(i, normal);
 			}
 		}
@@ -77,14 +79,14 @@ vec3 ProcessMaterialLight(Material material, vec3 color)
 
 	if (uLightIndex >= 0)
 	{
-		ivec4 lightRange = ivec4(lights[uLightIndex]) + ivec4(uLightIndex + 1);
 		if (lightRange.w > lightRange.z)
 		{
 			vec4 addlight = vec4(0.0,0.0,0.0,0.0);
 
 			// additive lights
-			for(int i=lightRange.z; i<lightRange.w; i+=4)
+			for(int n=lightRange.z; n<lightRange.w; n++)
 			{
+				int i = getLightOffset(n);
 				addlight.rgb += lightContribution(i, normal);
 			}
 
@@ -79,17 +79,18 @@ vec3 ProcessMaterialLight(Material material, vec3 ambientLight)
 	vec3 F0 = mix(vec3(0.04), albedo, metallic);
 
 	vec3 Lo = uDynLightColor.rgb;
+	ivec4 lightRange = getLightRange();
 
 	if (uLightIndex >= 0)
 	{
-		ivec4 lightRange = ivec4(lights[uLightIndex]) + ivec4(uLightIndex + 1);
 		if (lightRange.z > lightRange.x)
 		{
 			//
 			// modulated lights
 			//
-			for(int i=lightRange.x; i<lightRange.y; i+=4)
+			for(int n=lightRange.x; n<lightRange.y; n++)
 			{
+				int i = getLightOffset(n);
 				vec4 lightpos = lights[i];
 				vec4 lightcolor = lights[i+1];
 				vec4 lightspot1 = lights[i+2];
@@ -128,8 +129,9 @@ vec3 ProcessMaterialLight(Material material, vec3 ambientLight)
 			//
 			// subtractive lights
 			//
-			for(int i=lightRange.y; i<lightRange.z; i+=4)
+			for(int n=lightRange.y; n<lightRange.z; n++)
 			{
+				int i = getLightOffset(n);
 				vec4 lightpos = lights[i];
 				vec4 lightcolor = lights[i+1];
 				vec4 lightspot1 = lights[i+2];
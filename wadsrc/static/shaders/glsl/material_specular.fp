@@ -41,15 +41,16 @@ vec3 ProcessMaterialLight(Material material, vec3 color)
 
 	vec3 normal = material.Normal;
 	vec3 viewdir = normalize(uCameraPos.xyz - pixelpos.xyz);
+	ivec4 lightRange = getLightRange();
 
 	if (uLightIndex >= 0)
 	{
-		ivec4 lightRange = ivec4(lights[uLightIndex]) + ivec4(uLightIndex + 1);
 		if (lightRange.z > lightRange.x)
 		{
 			// modulated lights
-			for(int i=lightRange.x; i<lightRange.y; i+=4)
+			for(int n=lightRange.x; n<lightRange.y; n++)
 			{
+				int i = getLightOffset(n);
 				vec4 lightcolor = lights[i+1];
 				vec2 attenuation = lightAttenuation(i, normal, viewdir, lightcolor.a);
 				dynlight.rgb += lightcolor.rgb * attenuation.x;
@@ -57,8 +58,9 @@ vec3 ProcessMaterialLight(Material material, vec3 color)
 			}
 
 			// subtractive lights
-			for(int i=lightRange.y; i<lightRange.z; i+=4)
+			for(int n=lightRange.y; n<lightRange.z; n++)
 			{
+				int i = getLightOffset(n);
 				vec4 lightcolor = lights[i+1];
 				vec2 attenuation = lightAttenuation(i, normal, viewdir, lightcolor.a);
 				dynlight.rgb -= lightcolor.rgb * attenuation.x;
@@ -90,14 +92,14 @@ vec3 ProcessMaterialLight(Material material, vec3 color)
 
 	if (uLightIndex >= 0)
 	{
-		ivec4 lightRange = ivec4(lights[uLightIndex]) + ivec4(uLightIndex + 1);
 		if (lightRange.w > lightRange.z)
 		{
 			vec4 addlight = vec4(0.0,0.0,0.0,0.0);
 
 			// additive lights
-			for(int i=lightRange.z; i<lightRange.w; i+=4)
+			for(int n=lightRange.z; n<lightRange.w; n++)
 			{
+				int i = getLightOffset(n);
 				vec4 lightcolor = lights[i+1];
 				vec2 attenuation = lightAttenuation(i, normal, viewdir, lightcolor.a);
 				addlight.rgb += lightcolor.rgb * attenuation.x;